@@ -10,6 +10,7 @@ from spdm.core.sp_tree import annotation
 from spdm.core.sp_object import SpObject
 from spdm.core.geo_object import GeoObject
 from spdm.numlib.interpolate import interpolate
+from spdm.numlib.spatial import BBoxTree, points_in_polygon
 from spdm.geometry.vector import Vector
 
 
@@ -196,4 +197,113 @@ class WithDomain(abc.ABC):
 
 
 class MultiDomains(Domain, plugin_name="multiblock"):
+    """多块定义域，由若干子域拼接而成 （例如，偏滤器区域的多块网格）
+
+    - 子域包围盒上的 R-tree 给出候选子域，所有点一次向量化分类
+    - 曲线子域 (结构网格点 [nu, nv, 2]) 再以其边界多边形精确判定；矩形子域的包围盒即是精确的
+    - 仍有多个子域包含该点时 (共享的边界上)，点归属于序号最小的子域
+    """
+
     sub_domains: List[Domain] = annotation()
+
+    @property
+    def points(self) -> array_type:
+        return np.concatenate([np.asarray(d.points).reshape(-1, self.ndim) for d in self.sub_domains])
+
+    @property
+    def ndim(self) -> int:
+        return np.shape(self.sub_domains[0].points)[-1]
+
+    @property
+    def block_tree(self) -> BBoxTree:
+        tree = getattr(self, "_block_tree", None)
+        if tree is None:
+            bounds = []
+            for d in self.sub_domains:
+                points = np.asarray(d.points).reshape(-1, self.ndim)
+                bounds.append((points.min(axis=0), points.max(axis=0)))
+            tree = BBoxTree(*map(np.stack, zip(*bounds)))
+            self._block_tree = tree
+        return tree
+
+    @property
+    def block_boundaries(self) -> typing.List[ArrayType | None]:
+        """各子域的边界多边形 [n, 2]，包围盒即为精确边界的子域为 None"""
+        boundaries = getattr(self, "_block_boundaries", None)
+        if boundaries is None:
+            boundaries = []
+            for d in self.sub_domains:
+                points = np.asarray(d.points)
+                dims = getattr(d, "dims", None)
+                is_rect = (
+                    isinstance(dims, (tuple, list))
+                    and all(np.ndim(v) == 1 for v in dims)
+                    and getattr(d, "is_tensor_grid", True)
+                )
+                if is_rect or points.ndim != 3 or points.shape[-1] != 2:
+                    boundaries.append(None)
+                else:
+                    # 结构网格的外圈: u=0, v=-1, u=-1 (反向), v=0 (反向)
+                    boundaries.append(
+                        np.concatenate(
+                            [points[0, :-1], points[:-1, -1], points[-1, :0:-1], points[:0:-1, 0]],
+                            axis=0,
+                        )
+                    )
+            self._block_boundaries = boundaries
+        return boundaries
+
+    def locate(self, *x) -> ArrayType:
+        """子域序号，形状与 x 相同，定义域外为 -1"""
+        x = np.broadcast_arrays(*x)
+        points = np.stack([np.asarray(d, dtype=float).ravel() for d in x], axis=-1)
+
+        # R-tree 只作候选过滤，再对曲线子域做精确的点在多边形内判定
+        p_idx, block = self.block_tree.query_pairs(points)
+        keep = np.ones(p_idx.shape, dtype=bool)
+        for b in np.unique(block):
+            boundary = self.block_boundaries[b]
+            if boundary is not None:
+                sel = np.flatnonzero(block == b)
+                keep[sel] = points_in_polygon(boundary, points[p_idx[sel]])
+
+        n = len(self.sub_domains)
+        res = np.full(points.shape[0], n, dtype=int)
+        np.minimum.at(res, p_idx[keep], block[keep])
+        res[res == n] = -1
+        return res.reshape(x[0].shape)
+
+    def check(self, *x) -> bool | np_tp.NDArray[np.bool_]:
+        return self.locate(*x) >= 0
+
+    def mask(self, *args) -> bool | np_tp.NDArray[np.bool_]:
+        return self.check(*args)
+
+    def interpolate(self, func: typing.Callable | typing.Sequence[ArrayType], **kwargs) -> typing.Callable[..., ArrayType]:
+        """func 为函数，或各子域上数值的列表"""
+        if callable(func):
+            interps = [d.interpolate(func, **kwargs) for d in self.sub_domains]
+        elif len(func) == len(self.sub_domains):
+            interps = [d.interpolate(v, **kwargs) for d, v in zip(self.sub_domains, func)]
+        else:
+            raise ValueError(f"Expect {len(self.sub_domains)} blocks, got {len(func)}")
+
+        def _eval(*x) -> ArrayType:
+            x = np.broadcast_arrays(*[np.asarray(v, dtype=float) for v in x])
+            shape = x[0].shape
+            x = [v.ravel() for v in x]
+            block = self.locate(*x)
+            res = np.full(block.shape, np.nan)
+            # 按子域分桶，每个子域只调用一次插值
+            order = np.argsort(block, kind="stable")
+            start = np.searchsorted(block[order], np.arange(len(interps) + 1))
+            for b, op in enumerate(interps):
+                idx = order[start[b] : start[b + 1]]
+                if idx.size > 0:
+                    res[idx] = op(*[v[idx] for v in x])
+            return res.reshape(shape)
+
+        return _eval
+
+    def eval(self, func, *xargs, **kwargs) -> ArrayType:
+        return self.interpolate(func, **kwargs)(*xargs)
@@ -10,6 +10,8 @@ from spdm.core.entry import Entry
 from spdm.core.htree import HTreeNode, HTree
 from spdm.core.domain import Domain
 from spdm.core.functor import Functor
+from spdm.numlib.quadrature import integrate_gauss_kronrod
+from spdm.numlib.roots import find_roots
 
 
 class Expression(HTreeNode):
@@ -332,7 +334,26 @@ class Expression(HTreeNode):
         return self.partial_derivative(*order, **kwargs)
 
     def integral(self, *args, **kwargs) -> float:
-        raise NotImplementedError()
+        """定积分 definite integral
+
+        - integral(a, b, epsabs=, epsrel=, limit=) : 在 [a,b] 上自适应 Gauss-Kronrod 积分
+        - integral()                                : 在整个定义域上积分
+        """
+        if len(args) == 0:
+            domain = self.domain
+            if callable(getattr(domain, "integrate", None)):
+                return domain.integrate(self, **kwargs)
+
+            x = domain.coordinates if domain is not None else ()
+            if len(x) != 1:
+                raise RuntimeError(f"Can not integrate {self} on domain {domain}!")
+
+            args = (np.min(x[0]), np.max(x[0]))
+
+        if len(args) != 2:
+            raise RuntimeError(f"Illegal integral range {args}")
+
+        return integrate_gauss_kronrod(self, *args, **kwargs)
 
     @property
     def d(self) -> typing.Self:
@@ -355,7 +376,12 @@ class Expression(HTreeNode):
         return self.derivative(1) / self
 
     def find_roots(self, *args, **kwargs) -> typing.Generator[float, None, None]:
-        raise NotImplementedError("TODO: find_roots")
+        """求根 f(x)=y, 按从小到大的顺序返回
+
+        - find_roots(y=0.0, x=None, refine=None, xtol=1e-12)
+        直接在编译后的分段多项式 (_ppoly) 上逐区间求根; 对由算符定义的表达式，再在原表达式上做有界迭代修正。
+        """
+        yield from find_roots(self, *args, **kwargs)
 
     def fetch(self, *args, _parent=None, **kwargs):
         if len(args) + len(kwargs) == 0:
@@ -129,48 +129,41 @@ class Field(Expression):
     def _eval(self, *args, **kwargs) -> typing.Callable[..., ArrayType]:
         return self.__compile__()(*args, **kwargs)
 
-    def grad(self, n=1) -> typing.Self:
-        ppoly = self.__functor__()
-
-        if isinstance(ppoly, tuple):
-            ppoly, opts = ppoly
-        else:
-            opts = {}
-
-        if self.mesh.ndim == 2 and n == 1:
-            return Field(
-                (ppoly.partial_derivative(1, 0), ppoly.partial_derivative(0, 1)),
-                mesh=self.mesh,
-                name=f"\\nabla({self.__str__()})",
-                **opts,
-            )
-        elif self.mesh.ndim == 3 and n == 1:
-            return Field(
-                (
-                    ppoly.partial_derivative(1, 0, 0),
-                    ppoly.partial_derivative(0, 1, 0),
-                    ppoly.partial_derivative(0, 0, 1),
-                ),
-                mesh=self.mesh,
-                name=f"\\nabla({self.__str__()})",
-                **opts,
-            )
-        elif self.mesh.ndim == 2 and n == 2:
-            return Field(
-                (ppoly.partial_derivative(2, 0), ppoly.partial_derivative(0, 2), ppoly.partial_derivative(1, 1)),
-                mesh=self.mesh,
-                name=f"\\nabla^{n}({self.__str__()})",
-                **opts,
-            )
+    def regrid(self, mesh: Mesh, method: str = "bilinear", **kwargs) -> typing.Self:
+        """将 Field 插值到另一个网格 mesh 上
+        method: "bilinear", "bicubic", "conservative"
+        权重矩阵按网格缓存，重复调用只需一次稀疏矩阵乘法
+        """
+        from spdm.numlib.regrid import regrid
+
+        if not isinstance(mesh, Mesh):
+            mesh = Mesh(mesh)
+
+        return Field(regrid(self.__array__(), self.mesh, mesh, method=method, **kwargs), mesh=mesh, **self._kwargs)
+
+    def grad(self, n=1) -> typing.Tuple[typing.Self, ...]:
+        """梯度的各分量 (n=1), 或 Hessian 的上三角分量 (n=2, 顺序 (0,0),(0,1),...,(1,1),...)"""
+        ndim = self.mesh.ndim
+        if n == 1:
+            orders = [tuple(int(i == j) for j in range(ndim)) for i in range(ndim)]
+        elif n == 2:
+            orders = [
+                tuple((j == i) + (j == k) for j in range(ndim)) for i in range(ndim) for k in range(i, ndim)
+            ]
         else:
-            raise NotImplemented(f"TODO: ndim={self.mesh.ndim} n={n}")
+            raise NotImplementedError(f"TODO: ndim={ndim} n={n}")
+        return tuple(self.partial_derivative(*order) for order in orders)
 
     def derivative(self, order: int | typing.Tuple[int], **kwargs) -> typing.Self:
         if isinstance(order, int) and order < 0:
             func = self.__compile__().antiderivative(*order)
             return Field(func, mesh=self.mesh, label=f"I_{{{order}}}{{{self._render_latex_()}}}")
         elif isinstance(order, collections.abc.Sequence):
-            func = self.__compile__().partial_derivative(*order)
+            try:
+                # 网格上的有限差分
+                func = self.mesh.partial_derivative(order, self.__array__(), **kwargs)
+            except NotImplementedError:
+                func = self.__compile__().partial_derivative(*order)
             return Field(func, mesh=self.mesh, label=f"d_{{{order}}}{{{self._render_latex_()}}}")
         else:
             func = self.__compile__().derivative(order)
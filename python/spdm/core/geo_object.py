@@ -12,6 +12,7 @@ from spdm.utils.logger import logger
 from spdm.core.htree import List, HTree
 from spdm.core.sp_tree import annotation, sp_property, SpTree
 from spdm.core.pluggable import Pluggable
+from spdm.numlib import coordinates
 
 
 class BBox:
@@ -50,21 +51,22 @@ class BBox:
     def is_null(self) -> bool:
         return np.allclose(self._dimensions, 0)
 
-    # def __equal__(self, other: BBox) -> bool:
-    #     return np.allclose(self._xmin, other._xmin) and np.allclose(self._xmax, other._xmax)
+    def __eq__(self, other: typing.Self) -> bool:
+        if not isinstance(other, BBox):
+            return NotImplemented
+        return (
+            np.shape(self._origin) == np.shape(other._origin)
+            and np.allclose(self._origin, other._origin)
+            and np.allclose(self._dimensions, other._dimensions)
+        )
 
-    # def __or__(self, other: BBox) -> BBox:
-    #     if other is None:
-    #         return self
-    #     else:
-    #         return BBox(np.min(self._xmin, other._xmin), np.max(self._xmax, other._xmax))
+    __hash__ = None  # 按数值近似相等, 无一致的 hash
 
-    # def __and__(self, other: BBox) -> BBox | None:
-    #     if other is None:
-    #         return None
-    #     else:
-    #         res = BBox(np.max(self._xmin, other._xmin), np.min(self._xmax, other._xmax))
-    #         return res if res.is_valid else None
+    def __or__(self, other: typing.Self | None) -> typing.Self:
+        return self if other is None else self.union(other)
+
+    def __and__(self, other: typing.Self | None) -> typing.Self | None:
+        return None if other is None else self.intersection(other)
 
     @property
     def ndim(self) -> int:
@@ -122,13 +124,17 @@ class BBox:
             raise TypeError(f"args has wrong type {type(args[0])} {args}")
 
     def union(self, other: typing.Self) -> typing.Self:
-        """Return the union of self with other."""
+        """Return the union of self with other. 包含两者的最小 BBox"""
+        xmin = np.minimum(self._origin, other._origin)
+        xmax = np.maximum(self._origin + self._dimensions, other._origin + other._dimensions)
+        return BBox(xmin, xmax - xmin)
 
-        raise NotImplementedError(f"intersection")
-
-    def intersection(self, other: typing.Self):
-        """Return the intersection of self with other."""
-        raise NotImplementedError(f"intersection")
+    def intersection(self, other: typing.Self) -> typing.Self | None:
+        """Return the intersection of self with other, None if they do not overlap.
+        仅接触 (边界重合) 时返回退化的 BBox"""
+        xmin = np.maximum(self._origin, other._origin)
+        xmax = np.minimum(self._origin + self._dimensions, other._origin + other._dimensions)
+        return BBox(xmin, xmax - xmin) if np.all(xmax >= xmin) else None
 
     def reflect(self, point0, pointt1):
         """reflect  by line"""
@@ -314,6 +320,23 @@ class GeoObject(Pluggable, SpTree, plugin_prefix="spdm/geometry/"):
     def __array__(self) -> ArrayType:
         return self.points
 
+    def to_cartesian(self, phi: ArrayType = None) -> ArrayType:
+        """Cartesian (x, y, z) of the points
+
+        ndim=3 : points are (R, phi, Z)
+        ndim=2 : points are (R, Z), revolved by the toroidal angles phi -> [*shape, *phi.shape, 3]
+        """
+        if self.points.shape[-1] == 2:
+            return coordinates.sweep(self.points, 0.0 if phi is None else phi)
+        elif self.points.shape[-1] == 3 and phi is None:
+            return coordinates.cylindrical_to_cartesian(self.points)
+        else:
+            raise ValueError(f"Can not convert {self.points.shape[-1]}D points to Cartesian")
+
+    def to_cylindrical(self) -> ArrayType:
+        """Cylindrical (R, phi, Z) of the Cartesian points (x, y, z)"""
+        return coordinates.cartesian_to_cylindrical(self.points)
+
     def __getitem__(self, idx) -> ArrayType | float:
         return self.points[idx]
 
@@ -1,6 +1,7 @@
 import collections.abc
 import typing
 import abc
+import hashlib
 from functools import cache
 from enum import Enum
 
@@ -13,6 +14,7 @@ from spdm.utils.tags import _not_found_
 from spdm.utils.misc import group_dict_by_prefix
 
 from spdm.core.domain import Domain
+from spdm.core.geo_object import GeoObject
 from spdm.core.path import Path
 from spdm.core.sp_tree import annotation
 
@@ -20,6 +22,7 @@ from spdm.geometry.vector import Vector
 
 from spdm.numlib.numeric import float_nan, bitwise_and
 from spdm.numlib.interpolate import interpolate
+from spdm.numlib.spatial import points_in_polygon
 
 # from spdm.numlib.numeric import float_nan, meshgrid, bitwise_and
 
@@ -107,6 +110,17 @@ class Mesh(Domain, plugin_prefix="spdm.mesh.mesh_"):
     def coordinates(self) -> typing.Tuple[ArrayType, ...]:
         return tuple([self.points[..., i] for i in range(self.ndim)])
 
+    @property
+    def fingerprint(self) -> str:
+        """网格内容的哈希值，用作与网格相关的算子（插值权重等）的缓存键"""
+        coordinates = self.coordinates
+        h = hashlib.sha1(f"{self.__class__.__name__}:{len(coordinates)};".encode())
+        for c in coordinates:
+            # 形状不同而展平后相同的坐标不能得到相同的键
+            h.update(f"{np.shape(c)};".encode())
+            h.update(np.ascontiguousarray(c, dtype=float).tobytes())
+        return h.hexdigest()
+
     @property
     def cells(self) -> typing.Any:
         """refer to the individual units that make up the mesh"""
@@ -124,6 +138,13 @@ class Mesh(Domain, plugin_prefix="spdm.mesh.mesh_"):
         return interpolate(*xargs, value)
 
     def mask(self, *args) -> bool | np_tp.NDArray[np.bool_]:
+        """坐标是否在网格定义域内。 若给定 boundary (闭曲线/多边形, 或顶点数组 [n,2]), 返回其内部的 mask"""
+        boundary = self.get("boundary", None)
+        if isinstance(boundary, GeoObject):
+            return boundary.enclose(*args)
+        elif isinstance(boundary, array_type):
+            return points_in_polygon(boundary, *args)
+
         # or self._metadata.get("extrapolate", 0) != 1:
         if self.shape is None or len(self.shape) == 0 or self._metadata.get("extrapolate", 0) != "raise":
             return True
@@ -8,6 +8,8 @@ from scipy.interpolate import CubicSpline, PPoly
 from spdm.utils.logger import logger
 from spdm.utils.type_hint import ArrayLike, ArrayType, NumericType, array_type, nTupleType
 from spdm.core.geo_object import GeoObject, BBox
+from spdm.numlib.polyline import Polylines
+from spdm.numlib.spatial import polygon_index
 
 
 class Curve(GeoObject, plugin_name="curve", rank=1):
@@ -20,7 +22,7 @@ class Curve(GeoObject, plugin_name="curve", rank=1):
         self._uv = uv if uv is not None else np.linspace(0, 1.0, self.points.shape[0])
 
     def __copy__(self) -> typing.Self:
-        other: Curve = super().__copy__()  # type:ignore
+        other: Curve = super().__copy__()  # type: ignore
         other._uv = self._uv
         return other
 
@@ -29,33 +31,21 @@ class Curve(GeoObject, plugin_name="curve", rank=1):
         return np.allclose(self.points[0], self.points[-1]) or self._metadata.get("closed", False)
 
     @functools.cached_property
-    def dl(self) -> array_type:
-        x, y = self.coordinates
-        a, b = self.derivative
-
-        # a = a[:-1]
-        # b = b[:-1]
-        dx = x[1:] - x[:-1]
-        dy = y[1:] - y[:-1]
-
-        m1 = (-a[:-1] * dy + b[:-1] * dx) / (a[:-1] * dx + b[:-1] * dy)
-
-        # a = np.roll(a, 1, axis=0)
-        # b = np.roll(b, 1, axis=0)
+    def _polyline(self) -> Polylines:
+        return Polylines(self.points, closed=self.is_closed)
 
-        m2 = (-a[1:] * dy + b[1:] * dx) / (a[1:] * dx + b[1:] * dy)
-
-        return np.sqrt(dx**2 + dy**2) * (1 + (2.0 * m1**2 + 2.0 * m2**2 - m1 * m2) / 30)
+    @functools.cached_property
+    def dl(self) -> array_type:
+        """各段弧长 arc length of every segment"""
+        return self._polyline.arc_lengths
 
     @functools.cached_property
     def measure(self) -> float:
-        return np.sum(self.dl)
+        return float(self._polyline.length[0])
 
-    def integral(self, func: typing.Callable) -> float:
-        x, y = self.coordinates
-        val = func(x, y)
-        # c_pts = self.points((self._mesh[0][1:] + self._mesh[0][:-1])*0.5)
-        return np.sum(0.5 * (val[:-1] + val[1:]) * self.dl)
+    def integral(self, func: typing.Callable | array_type) -> float:
+        """∫ func dl, func 为坐标函数或节点上的值"""
+        return float(self._polyline.integral(func)[0])
 
     @functools.cached_property
     def _spl(self) -> PPoly:
@@ -70,14 +60,29 @@ class Curve(GeoObject, plugin_name="curve", rank=1):
         res = self._derivative(self._uv)
         return res[:, 0], res[:, 1]
 
-    def enclose(self, *args) -> bool:
+    def enclose(self, *args) -> bool | array_type:
+        """点是否在闭曲线内, 返回与坐标数组同形状的 mask"""
         if not self.is_closed:
             return False
-        return super().enclose(*args)
+        if self.ndim != 2:
+            return super().enclose(*args)
+        if len(args) == 1 and isinstance(args[0], GeoObject):
+            return bool(np.all(self.enclose(args[0].points)))
+        return polygon_index(self.points)(*args)
 
     def remesh(self, u) -> typing.Self:
+        """u: 新的参数 (array/callable)
+        或 int n, 按弧长等距重采样为 n 个点;  "arc_length", 以归一化弧长为参数
+        """
+        if isinstance(u, (int, np.integer)):
+            points = self._polyline.resample(u).points
+            return self.__class__(points, uv=np.linspace(0, 1.0, points.shape[0]), **self._metadata)
+
         other: Curve = copy(self)
-        if isinstance(u, array_type):
+        if isinstance(u, str) and u == "arc_length":
+            s = self._polyline.cumulative_length
+            other._uv = s / s[-1]
+        elif isinstance(u, array_type):
             other._uv = u
         elif callable(u):
             other._uv = u(*self.points)
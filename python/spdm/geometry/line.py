@@ -28,7 +28,7 @@ class Line(GeoObject, plugin_name="line", rank=1):
 
     @property
     def direction(self) -> Vector:
-        return Vector(self.p1 - self.p0)
+        return Vector(self.points[1] - self.points[0])
 
     @property
     def boundary(self) -> typing.List[Point]:
@@ -1,10 +1,14 @@
 import typing
 
+import numpy as np
+
 from spdm.core.sp_tree import annotation
 from spdm.core.geo_object import GeoObject
 from spdm.geometry.line import Segment
 from spdm.geometry.point import Point
 from spdm.geometry.polyline import Polyline
+from spdm.numlib.spatial import polygon_index
+from spdm.utils.type_hint import ArrayType
 
 
 class Rectangle(GeoObject, plugin_name="rectangle"):
@@ -12,7 +16,7 @@ class Rectangle(GeoObject, plugin_name="rectangle"):
 
 
 RectangleRZ = Rectangle["RZ"]
-RectangleXY= Rectangle["XY"]
+RectangleXY = Rectangle["XY"]
 
 
 class Polygon(GeoObject, plugin_name="polygon", rank=2):
@@ -48,6 +52,14 @@ class Polygon(GeoObject, plugin_name="polygon", rank=2):
     def boundary(self) -> Polyline:
         return Polyline(self._points, is_closed=True)
 
+    def enclose(self, *args) -> bool | ArrayType:
+        """点是否在多边形内, 返回与坐标数组同形状的 mask"""
+        if self.ndim != 2:
+            return super().enclose(*args)
+        if len(args) == 1 and isinstance(args[0], GeoObject):
+            return bool(np.all(self.enclose(args[0].points)))
+        return polygon_index(self.points)(*args)
+
 
 class RegularPolygon(Polygon, plugin_name="regular_polygon"):
     """Regular Polygon
@@ -1,5 +1,43 @@
+import typing
+
+import numpy as np
+
+from spdm.utils.type_hint import ArrayType
 from spdm.core.geo_object import GeoObject
+from spdm.numlib.spatial import segment_index
 
 
 class Polyline(GeoObject, plugin_name="polyline", rank=1):
-    pass
+    """Polyline 折线, 例如第一壁、限制器"""
+
+    @property
+    def is_closed(self) -> bool:
+        return bool(np.allclose(self.points[0], self.points[-1])) or self._metadata.get("closed", False)
+
+    def intersect(self, *args, t_min: float = 0.0, t_max: float = np.inf) -> typing.Tuple[ArrayType, ...]:
+        """与射线/线段的交点
+
+        args: (origin[n,2], direction[n,2]) 射线 origin + t*direction, t in [t_min,t_max]
+              或 Line/Ray/Segment (及其列表), Segment 取 t in [0,1], Line 取 t in (-inf,inf)
+
+        Returns:
+            t_in, t_out, seg_in, seg_out : 每条射线的进入/离开参数 (未相交为 nan) 和折线段序号 (-1)
+        """
+        from spdm.geometry.line import Line, Segment, Ray
+
+        if len(args) == 1:
+            lines = args[0] if isinstance(args[0], (list, tuple)) else [args[0]]
+            if not all(isinstance(l, Line) for l in lines):
+                raise TypeError(f"Illegal arguments {args}")
+            origin = np.asarray([np.asarray(l.points[0], dtype=float) for l in lines])
+            direction = np.asarray([np.asarray(l.points[1], dtype=float) for l in lines]) - origin
+            t_min = np.asarray([0.0 if isinstance(l, (Segment, Ray)) else -np.inf for l in lines])
+            t_max = np.asarray([1.0 if isinstance(l, Segment) else np.inf for l in lines])
+        elif len(args) == 2:
+            origin, direction = args
+        else:
+            raise TypeError(f"Illegal arguments {args}")
+
+        return segment_index(self.points, closed=self._metadata.get("closed", False)).intersect(
+            origin, direction, t_min, t_max
+        )
@@ -1,3 +1,7 @@
+import numpy as np
+
+from spdm.utils.type_hint import ArrayType
+from spdm.numlib import coordinates
 from spdm.geometry.surface import Surface
 from spdm.geometry.solid import Solid
 from spdm.geometry.plane import Plane
@@ -6,16 +10,39 @@ from spdm.geometry.circle import Circle
 
 
 class ToroidalSurface(Surface, plugin_name="toroidal_surface"):
-    def __init__(self, cross_section: Curve, circle: Circle, **kwargs) -> None:
-        super().__init__(**kwargs)
+    """Toroidal surface, the (R, Z) cross section revolved about the Z axis
+
+    points [*cross_section.shape, nphi, 3] in Cartesian (x, y, z)
+    """
+
+    def __init__(self, cross_section: Curve, circle: Circle = None, *args, phi: ArrayType | int = 64, **kwargs):
+        phi = np.linspace(0, 2.0 * np.pi, phi, endpoint=False) if isinstance(phi, int) else np.asarray(phi)
+        section = np.asarray(cross_section.points if isinstance(cross_section, Curve) else cross_section)
+        super().__init__(coordinates.sweep(section, phi), *args, **kwargs)
+        self._cross_section = cross_section
+        self._circle = circle
+        self._phi = phi
+
+    @property
+    def cross_section(self) -> Curve:
+        return self._cross_section
+
+    @property
+    def phi(self) -> ArrayType:
+        return self._phi
+
+    def basis(self) -> ArrayType:
+        """e_R, e_phi, e_Z (columns) at every point, [*shape, 3, 3]"""
+        return np.broadcast_to(coordinates.cylindrical_basis(self._phi), self.points.shape + (3,))
 
 
 @Surface.register("toroidal")
 class Toroidal(Solid, plugin_name="toroidal"):
-    def __init__(self, cross_section: Plane, circle: Circle, *args, **kwargs) -> None:
-        super().__init__(**kwargs)
-        self._boundary = ToroidalSurface(
-            cross_section.boundary,
-            circle,
-            *args,
-        )
+    def __init__(self, cross_section: Plane, circle: Circle = None, *args, phi: ArrayType | int = 64, **kwargs):
+        boundary = ToroidalSurface(cross_section.boundary, circle, phi=phi)
+        super().__init__(boundary.points, *args, **kwargs)
+        self._boundary = boundary
+
+    @property
+    def boundary(self) -> ToroidalSurface:
+        return self._boundary
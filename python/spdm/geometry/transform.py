@@ -1,12 +1,42 @@
+import numpy as np
+
+from spdm.utils.type_hint import ArrayType
+from spdm.numlib import coordinates
+from spdm.core.geo_object import GeoObject
 from spdm.geometry.solid import Solid
 from spdm.geometry.plane import Plane
 from spdm.geometry.point import Point
 from spdm.geometry.line import Line
 
 
+def _sweep_points(shape: GeoObject | ArrayType, axis: Point | Line | None, phi: ArrayType) -> ArrayType:
+    """Cartesian points of shape revolved about axis by the angles phi, [*shape.points.shape[:-1], nphi, 3]
+
+    axis: None -> Z axis, (R, Z) cross sections are revolved about the Z axis
+          Line -> the line through p0 along direction
+          Point-> the axis parallel to Z through the point
+    """
+    points = np.asarray(shape.points if isinstance(shape, GeoObject) else shape, dtype=float)
+    phi = np.linspace(0, 2.0 * np.pi, phi, endpoint=False) if isinstance(phi, int) else np.asarray(phi, dtype=float)
+
+    if axis is None and points.shape[-1] == 2:
+        return coordinates.sweep(points, phi)
+    elif points.shape[-1] == 2:  # (R,Z) 截面置于 xz 平面
+        points = np.stack([points[..., 0], np.zeros_like(points[..., 0]), points[..., 1]], axis=-1)
+
+    if axis is None:
+        return coordinates.sweep(points, phi)
+    elif isinstance(axis, Line):
+        return coordinates.sweep(points, phi, origin=np.asarray(axis.p0), direction=np.asarray(axis.direction))
+    else:
+        return coordinates.sweep(points, phi, origin=np.asarray(axis))
+
+
 class Sweep(Solid):
-    def __init__(self, shape: Plane | Line, axis: Point | Line, *args, **kwargs) -> None:
-        super().__init__(*args, **kwargs)
+    """Sweep a cross section about an axis, the points are evaluated at all angles phi at once"""
+
+    def __init__(self, shape: Plane | Line, axis: Point | Line = None, *args, phi: ArrayType | int = 64, **kwargs):
+        super().__init__(_sweep_points(shape, axis, phi), *args, **kwargs)
         self._section = shape
         self._axis = axis
 
@@ -20,13 +50,15 @@ class Sweep(Solid):
 
 
 class SweepSurface(Solid):
-    def __init__(self, *args, **kwargs) -> None:
+    def __init__(self, shape: GeoObject = None, axis: Point | Line = None, *args, phi: ArrayType | int = 64, **kwargs):
+        if shape is not None:
+            args = (_sweep_points(shape, axis, phi), *args)
         super().__init__(*args, **kwargs)
 
 
 class SweepSolid(Solid):
     Boundary = SweepSurface
 
-    def __init__(self, shape: Plane, axis: Line, *args, **kwargs) -> None:
-        super().__init__(shape, axis, *args, **kwargs)
-        self._boundary = self.__class__.Boundary(shape.boundary, axis, *args)
+    def __init__(self, shape: Plane, axis: Line, *args, phi: ArrayType | int = 64, **kwargs) -> None:
+        super().__init__(_sweep_points(shape, axis, phi), *args, **kwargs)
+        self._boundary = self.__class__.Boundary(shape.boundary, axis, phi=phi)
@@ -1,10 +1,29 @@
 import typing
 import numpy as np
 
+from spdm.numlib import coordinates
 
 _T = typing.TypeVar("_T", bool, int, float, complex)
 
 
 class Vector(np.ndarray[_T]):
-    def __init__(self, *args):
-        super().__init__(list(args))
+    """矢量, 分量在最后一维 [..., ndim]
+
+    Vector(1, 2, 3) or Vector(array)
+    """
+
+    def __new__(cls, *args, dtype=None):
+        value = args[0] if len(args) == 1 else args
+        return np.asarray(value, dtype=dtype).view(cls)
+
+    @property
+    def norm(self) -> np.ndarray:
+        return np.linalg.norm(self.view(np.ndarray), axis=-1)
+
+    def to_cartesian(self, phi) -> typing.Self:
+        """(v_R, v_phi, v_Z) at toroidal angle phi -> (v_x, v_y, v_z)"""
+        return coordinates.vector_to_cartesian(self.view(np.ndarray), phi).view(self.__class__)
+
+    def to_cylindrical(self, phi) -> typing.Self:
+        """(v_x, v_y, v_z) -> (v_R, v_phi, v_Z) at toroidal angle phi"""
+        return coordinates.vector_to_cylindrical(self.view(np.ndarray), phi).view(self.__class__)
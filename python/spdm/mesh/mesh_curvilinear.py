@@ -7,6 +7,7 @@ from functools import cached_property
 
 from spdm.utils.type_hint import ArrayType
 from spdm.core.geo_object import GeoObject
+from spdm.core.mesh import Mesh
 from spdm.geometry.point import Point
 
 
@@ -41,14 +42,43 @@ class CurvilinearMesh(RectilinearMesh, plugin_name="curvilinear"):
 
     @property
     def points(self) -> ArrayType:
+        """网格点的空间坐标 [*shape, ndim]"""
+        points = self._cache.get("points", None)
+        if points is not None:
+            return np.asarray(points)
         if not isinstance(self.geometry, GeoObject):
             raise RuntimeError(f"Unknown type {type(self.geometry)}")
         return self.geometry.points
 
+    @property
+    def coordinates(self) -> typing.Tuple[ArrayType, ...]:
+        points = self.points
+        return tuple([points[..., i] for i in range(points.shape[-1])])
+
+    @property
+    def is_tensor_grid(self) -> bool:
+        # dims 是逻辑坐标, 空间坐标为 points
+        return False
+
+    @property
+    def fingerprint(self) -> str:
+        return Mesh.fingerprint.fget(self)
+
     @cached_property
     def volume_element(self) -> ArrayType:
         raise NotImplementedError()
 
+    def partial_derivative(self, order, y, *args, **kwargs):
+        # 逻辑坐标上的差分不是物理坐标上的偏导数
+        raise NotImplementedError(f"{self.__class__.__name__}.partial_derivative")
+
+    def integrate(self, y, *args, **kwargs) -> float:
+        # 逻辑坐标上的积分缺少 Jacobian, 不是物理空间的积分
+        raise NotImplementedError(f"{self.__class__.__name__}.integrate")
+
+    def antiderivative(self, y, *args, **kwargs):
+        raise NotImplementedError(f"{self.__class__.__name__}.antiderivative")
+
     def interpolator(self, value, **kwargs):
         if value.shape != self.shape:
             raise ValueError(f"{value.shape} {self.shape}")
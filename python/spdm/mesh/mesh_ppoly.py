@@ -1,7 +1,11 @@
 from __future__ import annotations
 
-
+import typing
+import numpy as np
 from scipy.interpolate import CubicSpline, PPoly
+
+from spdm.utils.type_hint import ArrayType
+from spdm.numlib.quadrature import integrate_spline
 from spdm.mesh.mesh_rectilinear import RectilinearMesh
 
 
@@ -14,6 +18,21 @@ class PPolyMesh(RectilinearMesh, plugin_name="ppoly"):
         # return interp1d(*self.points, y, **kwargs)
         return CubicSpline(*self.xyz, y, bc_type=bc_type, **kwargs)
 
+    def _values(self, y: ArrayType | typing.Callable) -> ArrayType:
+        return np.asarray(y(*self.coordinates) if callable(y) else y, dtype=float)
+
+    def integrate(self, y: ArrayType | typing.Callable, *args, **kwargs) -> float:
+        """样条插值函数的精确积分"""
+        bc_type = self._metadata.get("bc_type", "not-a-knot")
+        return integrate_spline(self._values(y), *self.dims, bc_type=bc_type)
+
+    def antiderivative(self, y: ArrayType | typing.Callable, *args, axis: int = 0, **kwargs):
+        """沿 axis 的原函数，由样条插值函数精确积分得到"""
+        bc_type = self._metadata.get("bc_type", "not-a-knot")
+        x = self.dims[axis]
+        value = CubicSpline(x, self._values(y), bc_type=bc_type, axis=axis).antiderivative()(x)
+        return self.interpolate(value, **kwargs)
+
 
 # class Function1D(Function[_T]):
 #     """
@@ -2,15 +2,19 @@
 
 import typing
 import functools
+import hashlib
 
 import numpy as np
 
+from spdm.utils.logger import logger
 from spdm.utils.tags import _not_found_
 from spdm.utils.type_hint import ArrayType, array_type
 from spdm.core.function import Function
 
 from spdm.geometry.box import Box, Box2D
 from spdm.numlib.interpolate import interpolate
+from spdm.numlib.quadrature import integrate_gauss_legendre, cumulative_gauss_legendre
+from spdm.numlib.stencil import partial_derivative
 from spdm.mesh.mesh_structured import StructuredMesh
 
 
@@ -70,6 +74,27 @@ class RectilinearMesh(StructuredMesh, plugin_name=["rectilinear", "rectangular",
     def coordinates(self) -> typing.Tuple[ArrayType, ...]:
         return tuple(np.meshgrid(*self.dims, indexing="ij"))
 
+    @property
+    def is_tensor_grid(self) -> bool:
+        """网格点是 dims 的张量积, 即 dims 是空间坐标 (单元边界)"""
+        return True
+
+    @property
+    def fingerprint(self) -> str:
+        h = hashlib.sha1(f"{self.__class__.__name__}:{len(self.dims)};".encode())
+        for d in self.dims:
+            h.update(f"{np.shape(d)};".encode())
+            h.update(np.ascontiguousarray(d, dtype=float).tobytes())
+        return h.hexdigest()
+
+    @property
+    def _periods(self) -> typing.List[float | None]:
+        """周期长度，非周期维度为 None"""
+        periods = self.periods
+        if not isinstance(periods, (list, tuple, np.ndarray)):
+            return [None] * len(self.dims)
+        return [(float(p) if p is not None and p is not False and p > 0 else None) for p in periods]
+
     def interpolate(self, func: ArrayType | typing.Callable[..., array_type], **kwargs):
         """生成插值器
         method: "linear",   "nearest", "slinear", "cubic", "quintic" and "pchip"
@@ -91,3 +116,35 @@ class RectilinearMesh(StructuredMesh, plugin_name=["rectilinear", "rectangular",
             raise ValueError(f"{value} {self.shape}")
 
         return interpolate(*self.dims, value, periods=self.periods, **kwargs)
+
+    def partial_derivative(
+        self,
+        order: typing.Sequence[int],
+        y: ArrayType | typing.Callable[..., array_type],
+        *args,
+        accuracy: int = 2,
+        **kwargs,
+    ) -> typing.Callable[..., array_type]:
+        """偏导数，有限差分模板
+        order   : 每个维度的求导阶数，例如 (1,0), (1,1)
+        accuracy: 差分格式精度阶数
+        """
+        value = y(*self.coordinates) if callable(y) else np.asarray(y)
+        value = partial_derivative(value, *self.dims, order=order, accuracy=accuracy, periods=self._periods)
+        return self.interpolate(value, **kwargs)
+
+    def integrate(self, y: ArrayType | typing.Callable[..., array_type], *args, n: int = 3, **kwargs) -> float:
+        """定积分，张量积 Gauss-Legendre 求积，每个网格单元每个维度 n 个节点
+        y 为数组时，对其插值函数积分
+        """
+        if len(args) + len(kwargs) > 0:
+            logger.warning(f"Ignore {args} {kwargs}")
+        func = y if callable(y) else self.interpolate(y)
+        return integrate_gauss_legendre(func, *self.dims, n=n)
+
+    def antiderivative(
+        self, y: ArrayType | typing.Callable[..., array_type], *args, axis: int = 0, n: int = 3, **kwargs
+    ) -> typing.Callable[..., array_type]:
+        """沿 axis 的原函数，网格点上的值由逐单元 Gauss-Legendre 求积累加得到"""
+        func = y if callable(y) else self.interpolate(y)
+        return self.interpolate(cumulative_gauss_legendre(func, *self.dims, axis=axis, n=n), **kwargs)
@@ -9,6 +9,7 @@ from spdm.core.htree import List, Set
 from spdm.core.sp_tree import SpProperty, SpTree
 from spdm.model.entity import Entity
 from spdm.model.process import Process
+from spdm.model.scheduler import Scheduler, port_graph, refresh_process
 from spdm.model.component import Component
 
 
@@ -54,6 +55,8 @@ class Context(Process):
                 if attr is not _not_found_:
                     self._out_ports[name] = attr
 
+        return self.out_ports
+
     @property
     def context(self) -> typing.Self:
         """获取当前 Actor 所在的 Context。"""
@@ -70,7 +73,14 @@ class Context(Process):
         """
         if type_hint is None:
             type_hint = Entity
-        for k in getattr(self, "__properties__", []):
+        # 按类定义中的顺序 (基类在前), 包括没有类型注解的 sp_property
+        properties = getattr(self, "__properties__", set())
+        names = {}
+        for cls in reversed(self.__class__.__mro__):
+            for k in vars(cls):
+                if k in properties:
+                    names.setdefault(k, None)
+        for k in names:
             entity: Entity = getattr(self, k, _not_found_)  # type:ignore
             if isinstance(entity, type_hint):
                 yield k, entity
@@ -96,11 +106,42 @@ class Context(Process):
         yield from self.entities(Component)  # type:ignore
 
     def execute(self, *args, **kwargs) -> dict:
-        """执行 Context"""
-        return super().execute(*args, **kwargs)
-        #      | {
-        #     k: entity.execute(*args, **kwargs) for k, entity in self.processes()
-        # }
+        """执行 Context: 按端口依赖刷新其中的 Processes, 相互独立的并行执行 (见 model.scheduler)
+
+        Returns:
+            dict: out ports 的值
+        """
+        super().execute(*args, **kwargs)
+
+        processes = dict(self.processes())
+        values = dict(kwargs)
+
+        scheduler = Scheduler(
+            port_graph(processes),
+            cost=getattr(self, "_schedule_cost", None),
+            max_workers=self.max_workers,
+            executor=self.executor,
+        )
+
+        def submit(name):
+            process = processes[name]
+            inputs = {k: values[k] for k in sorted(process.InPorts.__properties__) if k in values}
+            return refresh_process, (process, inputs)
+
+        def done(name, res):
+            outputs, in_ports_hash = res
+            values.update(outputs)
+            if scheduler.executor == "process":
+                # 在工作进程中刷新, 同步 out ports
+                processes[name].out_ports.__setstate__(outputs)
+                processes[name]._in_ports_hash = in_ports_hash
+
+        scheduler.run(submit, done)
+
+        # 本次的运行时间作为下次关键路径的估计
+        self._schedule_cost = scheduler.elapsed
+
+        return {k: values[k] for k in self.OutPorts.__properties__ if k in values}
 
     def __view__(self, **styles) -> dict:
         """生成 Context 的视图。
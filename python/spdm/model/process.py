@@ -2,12 +2,15 @@
 
 import typing
 import abc
+import functools
 from spdm.utils.logger import logger
 from spdm.utils.tags import _not_found_
 from spdm.core.sp_tree import SpProperty, SpTree
 from spdm.core.htree import Set
 from spdm.core.sp_tree import annotation
 from spdm.model.port import Ports
+from spdm.model.scheduler import Scheduler
+from spdm.model.result_store import ResultStore, default_store
 
 
 class Process(abc.ABC):
@@ -21,6 +24,16 @@ class Process(abc.ABC):
 
     """
 
+    # 子 Process 的调度 (Context, ProcessBundle): 并发数, 1 为顺序执行; 执行器 "thread" | "process"
+    # None 时取 SP_MAX_WORKERS (缺省 1), SP_EXECUTOR。不加类型注解, 以免成为 SpTree 的属性。
+    max_workers = None
+    executor = None
+
+    # 结果缓存 (model.result_store): True 使用 default_store(), 或指定 ResultStore;
+    # 改变 execute 的算法时应改变 cache_version, 使旧结果失效。
+    memoize = False
+    cache_version = 0
+
     class InPorts(Ports, final=False):
         """输入端口集合。"""
 
@@ -46,6 +59,14 @@ class Process(abc.ABC):
     def __hash__(self) -> int:
         return hash(tuple([super().__hash__(), self._in_ports_hash]))
 
+    def __setstate__(self, *args, **kwargs) -> None:
+        super().__setstate__(*args, **kwargs)
+        if "_in_ports" not in self.__dict__:
+            # unpickle (如 "process" 执行器的工作进程中) 不调用 __init__, 重建端口
+            self._in_ports_hash = 0
+            self._in_ports = self.InPorts(_parent=self)
+            self._out_ports = self.OutPorts(_parent=self)
+
     def refresh(self, *args, **kwargs) -> OutPorts:
         """刷新 Processor 的状态，将执行结果更新的out_ports"""
 
@@ -58,7 +79,25 @@ class Process(abc.ABC):
 
         if in_ports_hash != self._in_ports_hash:
             # 只有在 input hash 改变时才执行 execute。
-            res = self.execute(**self.in_ports.pull())
+            inputs = self.in_ports.pull()
+
+            store = None
+            key = None
+            res = _not_found_
+            if self.memoize:
+                # 相同 (类, 版本, 参数, 输入) 的结果直接取自缓存
+                store = self.memoize if isinstance(self.memoize, ResultStore) else default_store()
+                key = store.key(self, inputs)
+                if key is not None:
+                    res = store.get(key, _not_found_)
+
+            if res is _not_found_:
+                res = self.execute(**inputs)
+                if key is not None:
+                    store.put(key, res)
+            else:
+                logger.debug(f"{self}: result from cache {key}")
+
             self.out_ports.__setstate__(res)
             self._in_ports_hash = in_ports_hash
 
@@ -82,7 +121,13 @@ class ProcessBundle(Process, Set[_T]):
         self._out_ports = self
 
     def execute(self, *args, **kwargs):
-        return [process.execute(*args, **kwargs) for process in self]
+        """各 process 以相同的输入并行执行, 结果按原顺序"""
+        processes = [process for process in self]
+        scheduler = Scheduler(
+            {i: () for i in range(len(processes))}, max_workers=self.max_workers, executor=self.executor
+        )
+        res = scheduler.run(lambda i: (functools.partial(processes[i].execute, *args, **kwargs), ()))
+        return list(res.values())
 
     # @sp_property
     # def name(self) -> str:
@@ -0,0 +1,263 @@
+""" ResultStore: 按内容寻址的 Process 结果缓存
+
+The result of `Process.execute` is stored under the digest of
+
+    (process class, process.cache_version, parameters of the process, inputs)
+
+so identical inputs (scans, restarts, repeated time slices) are computed once. The results
+are kept pickled, in memory (LRU, bounded by bytes) and in files under the cache directory
+(<cache_dir>/<key[:2]>/<key>.pkl, written atomically, the least recently used files are
+removed when the directory exceeds its size), so they are shared between runs and between
+processes. Objects that can not be fingerprinted or pickled are not cached.
+
+    >>> store = ResultStore("/tmp/spdm_cache", max_disk=1 << 30)
+    >>> key = store.key(process, inputs)
+    >>> res = store.get(key, _not_found_)
+"""
+
+import collections
+import hashlib
+import os
+import pathlib
+import pickle
+import tempfile
+import threading
+import typing
+
+import numpy as np
+
+from spdm.utils.logger import logger
+from spdm.utils.tags import _not_found_
+from spdm.utils.envs import SP_LABEL, SP_CACHE_DIR
+from spdm.core.htree import HTreeNode
+
+
+def fingerprint(obj: typing.Any, h=None) -> str:
+    """与进程无关的内容哈希 (sha1), 不能确定内容时 raise TypeError
+
+    支持 None, 标量, str, bytes, ndarray, dict, list, tuple, set, HTreeNode, 以及有 str 属性
+    `fingerprint` 的对象 (如 Mesh)
+    """
+    top = h is None
+    if top:
+        h = hashlib.sha1()
+
+    if obj is None or obj is _not_found_ or isinstance(obj, (bool, int, float, complex, str, bytes)):
+        h.update(f"{type(obj).__name__}:{obj!r};".encode())
+    elif isinstance(obj, (np.ndarray, np.generic)):
+        obj = np.asarray(obj)
+        if obj.dtype.hasobject:
+            fingerprint(obj.tolist(), h)
+        else:
+            h.update(f"ndarray:{obj.dtype.str}:{obj.shape};".encode())
+            h.update(np.ascontiguousarray(obj).tobytes())
+    elif isinstance(obj, dict):
+        h.update(b"dict{")
+        for k in sorted(obj, key=str):
+            fingerprint(k, h)
+            fingerprint(obj[k], h)
+        h.update(b"}")
+    elif isinstance(obj, (list, tuple)):
+        h.update(f"{type(obj).__name__}[".encode())
+        for v in obj:
+            fingerprint(v, h)
+        h.update(b"]")
+    elif isinstance(obj, (set, frozenset)):
+        # 集合的迭代顺序依赖于进程的 hash 种子
+        h.update(f"{type(obj).__name__}{{{','.join(sorted(fingerprint(v) for v in obj))}}};".encode())
+    elif isinstance(getattr(obj, "fingerprint", None), str):
+        # 如 Mesh.fingerprint
+        h.update(f"{obj.__class__.__qualname__}:{obj.fingerprint};".encode())
+    elif isinstance(obj, HTreeNode):
+        fingerprint(obj.__getstate__(), h)
+    else:
+        # pickle 的字节不是内容哈希 (依赖对象标识, 函数只记名字), 未知类型不缓存
+        raise TypeError(f"Can not fingerprint {type(obj)}, define a str `fingerprint` attribute to opt in")
+
+    return h.hexdigest() if top else None
+
+
+class ResultStore:
+    """内存 + 磁盘的结果缓存
+
+    Args:
+        cache_dir  : 磁盘缓存目录, 缺省为 SP_CACHE_DIR 或 $XDG_CACHE_HOME/spdm/results, False 不使用磁盘
+        max_memory : 内存中 pickled 结果的总字节数上限
+        max_disk   : 磁盘缓存的总字节数上限
+    """
+
+    def __init__(self, cache_dir: str | bool = None, max_memory: int = 1 << 28, max_disk: int = 1 << 32):
+        if cache_dir is None:
+            cache_dir = SP_CACHE_DIR or (
+                pathlib.Path(os.environ.get("XDG_CACHE_HOME", "~/.cache")).expanduser() / SP_LABEL / "results"
+            )
+        self._cache_dir = pathlib.Path(cache_dir) if cache_dir is not False else None
+        self._max_memory = max_memory
+        self._max_disk = max_disk
+
+        self._memory: typing.OrderedDict[str, bytes] = collections.OrderedDict()
+        self._memory_size = 0
+        self._disk_size = None  # 首次写入时统计
+        self._lock = threading.RLock()
+
+    @property
+    def cache_dir(self) -> pathlib.Path | None:
+        return self._cache_dir
+
+    def key(self, process, inputs: dict) -> str | None:
+        """结果的键, process 的参数或输入不能确定时返回 None (不缓存)"""
+        cls = process.__class__
+        try:
+            h = hashlib.sha1(f"{cls.__module__}.{cls.__qualname__}:{getattr(process, 'cache_version', None)};".encode())
+            fingerprint(_parameters(process), h)
+            fingerprint(inputs, h)
+        except TypeError as error:
+            logger.debug(f"Do not cache {cls.__name__}: {error}")
+            return None
+        return h.hexdigest()
+
+    def _path(self, key: str) -> pathlib.Path:
+        return self._cache_dir / key[:2] / f"{key}.pkl"
+
+    def get(self, key: str, default_value: typing.Any = _not_found_) -> typing.Any:
+        with self._lock:
+            data = self._memory.get(key, None)
+            if data is not None:
+                self._memory.move_to_end(key)
+
+        if data is None and self._cache_dir is not None:
+            path = self._path(key)
+            try:
+                data = path.read_bytes()
+            except OSError:
+                data = None
+            else:
+                self._remember(key, data)
+                try:
+                    os.utime(path)  # LRU
+                except OSError:
+                    pass
+
+        if data is None:
+            return default_value
+
+        try:
+            return pickle.loads(data)
+        except Exception as error:
+            logger.warning(f"Drop broken cache entry {key}: {error}")
+            self.discard(key)
+            return default_value
+
+    def put(self, key: str, value: typing.Any) -> bool:
+        """存入结果, 不能 pickle 时返回 False"""
+        try:
+            data = pickle.dumps(value, protocol=pickle.HIGHEST_PROTOCOL)
+        except Exception as error:
+            logger.debug(f"Do not cache {type(value)}: {error}")
+            return False
+
+        self._remember(key, data)
+
+        if self._cache_dir is not None:
+            path = self._path(key)
+            tmp = None
+            try:
+                path.parent.mkdir(parents=True, exist_ok=True)
+                # 先写临时文件再改名, 其他进程不会读到不完整的文件
+                fd, tmp = tempfile.mkstemp(dir=path.parent, suffix=".tmp")
+                with os.fdopen(fd, "wb") as fp:
+                    fp.write(data)
+                os.replace(tmp, path)
+            except OSError as error:
+                # 磁盘缓存不可用时只保留在内存中
+                logger.warning(f"Can not write cache {path}: {error}")
+                if tmp is not None and os.path.exists(tmp):
+                    os.remove(tmp)
+            else:
+                self._evict_disk(len(data))
+
+        return True
+
+    def discard(self, key: str) -> None:
+        with self._lock:
+            data = self._memory.pop(key, None)
+            if data is not None:
+                self._memory_size -= len(data)
+        if self._cache_dir is not None:
+            self._path(key).unlink(missing_ok=True)
+
+    def clear(self) -> None:
+        with self._lock:
+            self._memory.clear()
+            self._memory_size = 0
+            if self._cache_dir is not None:
+                for path in self._cache_dir.glob("??/*.pkl"):
+                    path.unlink(missing_ok=True)
+                self._disk_size = 0
+
+    def __contains__(self, key: str) -> bool:
+        return key in self._memory or (self._cache_dir is not None and self._path(key).exists())
+
+    def _remember(self, key: str, data: bytes) -> None:
+        if len(data) > self._max_memory:
+            return
+        with self._lock:
+            old = self._memory.pop(key, None)
+            if old is not None:
+                self._memory_size -= len(old)
+            self._memory[key] = data
+            self._memory_size += len(data)
+            while self._memory_size > self._max_memory:
+                _, old = self._memory.popitem(last=False)
+                self._memory_size -= len(old)
+
+    def _evict_disk(self, added: int) -> None:
+        with self._lock:
+            if self._disk_size is None:
+                self._disk_size = sum(p.stat().st_size for p in self._cache_dir.glob("??/*.pkl"))
+            else:
+                self._disk_size += added
+
+            if self._disk_size <= self._max_disk:
+                return
+
+            # 其他进程也可能写入, 重新统计后按访问时间删除
+            files = []
+            for path in self._cache_dir.glob("??/*.pkl"):
+                try:
+                    stat = path.stat()
+                except OSError:
+                    continue
+                files.append((stat.st_mtime, stat.st_size, path))
+            files.sort()
+            total = sum(f[1] for f in files)
+            for _, size, path in files:
+                if total <= self._max_disk:
+                    break
+                path.unlink(missing_ok=True)
+                total -= size
+            self._disk_size = total
+
+
+def _parameters(process) -> typing.Any:
+    """process 的参数: 其状态树中除 out ports 以外的部分"""
+    if not isinstance(process, HTreeNode):
+        return None
+    state = process.__getstate__()
+    if isinstance(state, dict):
+        out_ports = getattr(process.OutPorts, "__properties__", ())
+        state = {k: v for k, v in state.items() if k not in out_ports}
+    return state
+
+
+_default_store = None
+_default_lock = threading.Lock()
+
+
+def default_store() -> ResultStore:
+    """进程内共享的 ResultStore"""
+    global _default_store
+    with _default_lock:
+        if _default_store is None:
+            _default_store = ResultStore()
+    return _default_store
@@ -0,0 +1,229 @@
+""" Scheduler: 按端口依赖并行执行 Process
+
+The dependency graph of a group of processes is built from their ports (port links
+Q.OutPorts -> P.InPorts with the same name):
+
+- P reads a port written by Q                    : Q precedes P
+- several processes write the same port           : they run in declaration order and the
+  readers get the value of the last one; a process that reads and writes a port
+  (an update) follows the previous writer
+
+so the values do not depend on the schedule. By default the processes run one after another;
+with max_workers > 1 (opt-in, Process.max_workers or SP_MAX_WORKERS) independent processes
+run concurrently on a thread (or process) pool. Among the ready processes the one on the
+longest remaining path (critical path, by the measured run time of the processes) is
+started first. Results are returned in declaration order.
+
+    >>> scheduler = Scheduler(port_graph(processes), cost=..., max_workers=4)
+    >>> results = scheduler.run(submit, done)
+"""
+
+import concurrent.futures
+import heapq
+import os
+import time
+import typing
+
+from spdm.utils.logger import logger
+from spdm.utils.tags import _not_found_
+from spdm.utils.envs import SP_MAX_WORKERS, SP_EXECUTOR
+
+_TKey = typing.TypeVar("_TKey")
+
+
+def port_graph(processes: typing.Dict[str, typing.Any]) -> typing.Dict[str, typing.Tuple[str, ...]]:
+    """{name: 前驱 names}, processes 按声明顺序"""
+    writers = {}  # port -> 写入者, 按声明顺序
+    for name, process in processes.items():
+        for k in getattr(process.OutPorts, "__properties__", ()):
+            writers.setdefault(k, []).append(name)
+
+    graph = {}
+    for name, process in processes.items():
+        deps = set()
+        for k in getattr(process.InPorts, "__properties__", ()):
+            chain = writers.get(k, [])
+            if name in chain:
+                # 读写同一端口: 接在前一个写入者之后
+                deps.update(chain[: chain.index(name)][-1:])
+            else:
+                deps.update(chain[-1:])
+        for k in getattr(process.OutPorts, "__properties__", ()):
+            chain = writers[k]
+            deps.update(chain[: chain.index(name)][-1:])
+        graph[name] = tuple(p for p in processes if p in deps)
+    return graph
+
+
+class Scheduler(typing.Generic[_TKey]):
+    """DAG 调度器
+
+    Args:
+        graph       : {key: 前驱 keys}, 按声明顺序 (决定输出顺序与同优先级的启动顺序)
+        cost        : {key: 估计运行时间}, 缺省为 1
+        max_workers : 并发数, 1 在当前线程中顺序执行, 缺省取 SP_MAX_WORKERS (1)
+        executor    : "thread" | "process"
+    """
+
+    def __init__(
+        self,
+        graph: typing.Dict[_TKey, typing.Iterable[_TKey]],
+        cost: typing.Dict[_TKey, float] = None,
+        max_workers: int = None,
+        executor: str = None,
+    ):
+        self._graph = {k: tuple(v) for k, v in graph.items()}
+        self._index = {k: i for i, k in enumerate(self._graph)}
+        self._successors = {k: [] for k in self._graph}
+        for k, deps in self._graph.items():
+            for d in deps:
+                if d not in self._graph:
+                    raise KeyError(f"Unknown dependency {d} of {k}")
+                self._successors[d].append(k)
+
+        self._cost = {k: (cost or {}).get(k, None) or 1.0 for k in self._graph}
+        self._max_workers = max_workers if max_workers is not None else SP_MAX_WORKERS
+        self._executor = executor or SP_EXECUTOR
+        if self._executor not in ("thread", "process"):
+            raise ValueError(f"Unknown executor {self._executor}")
+
+        self._priority = self._upward_rank()
+
+    @property
+    def graph(self) -> typing.Dict[_TKey, typing.Tuple[_TKey, ...]]:
+        return self._graph
+
+    @property
+    def executor(self) -> str:
+        return self._executor
+
+    @property
+    def priority(self) -> typing.Dict[_TKey, float]:
+        """节点到出口的最长路径 (含自身)"""
+        return self._priority
+
+    def _upward_rank(self) -> typing.Dict[_TKey, float]:
+        rank = {}
+        for k in reversed(self.order()):
+            rank[k] = self._cost[k] + max((rank[s] for s in self._successors[k]), default=0.0)
+        return {k: rank[k] for k in self._graph}
+
+    def order(self) -> typing.List[_TKey]:
+        """拓扑序, 同层按声明顺序"""
+        indegree = {k: len(v) for k, v in self._graph.items()}
+        ready = [self._index[k] for k, d in indegree.items() if d == 0]
+        heapq.heapify(ready)
+        keys = list(self._graph)
+        order = []
+        while ready:
+            k = keys[heapq.heappop(ready)]
+            order.append(k)
+            for s in self._successors[k]:
+                indegree[s] -= 1
+                if indegree[s] == 0:
+                    heapq.heappush(ready, self._index[s])
+        if len(order) != len(keys):
+            raise RuntimeError(f"Cycle in the dependency graph: {[k for k in keys if indegree[k] > 0]}")
+        return order
+
+    def critical_path(self) -> typing.List[_TKey]:
+        """最长 (按 cost) 的依赖链"""
+        sources = [k for k, d in self._graph.items() if len(d) == 0]
+        if len(sources) == 0:
+            return []
+        path = [max(sources, key=lambda k: (self._priority[k], -self._index[k]))]
+        while self._successors[path[-1]]:
+            path.append(max(self._successors[path[-1]], key=lambda k: (self._priority[k], -self._index[k])))
+        return path
+
+    def run(
+        self,
+        submit: typing.Callable[[_TKey], typing.Tuple[typing.Callable, tuple]],
+        done: typing.Callable[[_TKey, typing.Any], None] = None,
+    ) -> typing.Dict[_TKey, typing.Any]:
+        """执行所有节点
+
+        Args:
+            submit : submit(key) -> (func, args), 在调度线程中于节点就绪时调用, 由工作线程执行 func(*args)
+            done   : done(key, result), 在调度线程中于节点完成后调用 (先于其后继的 submit)
+
+        Returns:
+            {key: result} 按声明顺序
+        """
+        results = {}
+        elapsed = {}
+
+        def _finish(key, res):
+            results[key] = res
+            if done is not None:
+                done(key, res)
+
+        if self._max_workers == 1:
+            for key in self.order():
+                func, args = submit(key)
+                start = time.perf_counter()
+                res = func(*args)
+                elapsed[key] = time.perf_counter() - start
+                _finish(key, res)
+        else:
+            pool_cls = (
+                concurrent.futures.ThreadPoolExecutor
+                if self._executor == "thread"
+                else concurrent.futures.ProcessPoolExecutor
+            )
+            indegree = {k: len(v) for k, v in self._graph.items()}
+            ready = [(-self._priority[k], self._index[k], k) for k, d in indegree.items() if d == 0]
+            heapq.heapify(ready)
+            running = {}
+
+            # 缺省并发数同 concurrent.futures
+            if self._max_workers is not None:
+                capacity = self._max_workers
+            elif self._executor == "thread":
+                capacity = min(32, (os.cpu_count() or 1) + 4)
+            else:
+                capacity = os.cpu_count() or 1
+            with pool_cls(max_workers=capacity) as pool:
+                while ready or running:
+                    # 关键路径优先: 就绪节点按最长剩余路径启动
+                    while ready and len(running) < capacity:
+                        *_, key = heapq.heappop(ready)
+                        func, args = submit(key)
+                        running[pool.submit(func, *args)] = (key, time.perf_counter())
+
+                    finished, _ = concurrent.futures.wait(running, return_when=concurrent.futures.FIRST_COMPLETED)
+                    # 同时完成的节点按声明顺序处理
+                    for future in sorted(finished, key=lambda f: self._index[running[f][0]]):
+                        key, start = running.pop(future)
+                        elapsed[key] = time.perf_counter() - start
+                        try:
+                            res = future.result()
+                        except Exception as error:
+                            for f in running:
+                                f.cancel()
+                            raise RuntimeError(f"Failed to execute {key}") from error
+                        _finish(key, res)
+                        for s in self._successors[key]:
+                            indegree[s] -= 1
+                            if indegree[s] == 0:
+                                heapq.heappush(ready, (-self._priority[s], self._index[s], s))
+
+        self._elapsed = elapsed
+        logger.debug(f"Scheduler: {len(results)} tasks, critical path {self.critical_path()}")
+        return {k: results[k] for k in self._graph}
+
+    @property
+    def elapsed(self) -> typing.Dict[_TKey, float]:
+        """上次 run 中各节点的运行时间, 可作为下次的 cost"""
+        return getattr(self, "_elapsed", {})
+
+
+def refresh_process(process, inputs: dict) -> typing.Tuple[dict, int]:
+    """在工作线程/进程中刷新 process, 返回 (out ports 的值, in ports hash)"""
+    out_ports = process.refresh(**inputs)
+    outputs = {}
+    for k in sorted(getattr(process.OutPorts, "__properties__", ())):
+        v = out_ports.get(k, _not_found_)
+        if v is not _not_found_:
+            outputs[k] = v
+    return outputs, process._in_ports_hash
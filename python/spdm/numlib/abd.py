@@ -0,0 +1,179 @@
+""" 几乎块对角 Almost block diagonal (ABD) linear systems of two point boundary value problems
+
+The collocation Jacobian of `bvp.solve_bvp` has the structure (m-1 interval blocks, two point
+boundary conditions and k unknown parameters)
+
+    A_0 C_0                 P_0
+        A_1 C_1             P_1
+            ...  ...        ...
+                A_m2 C_m2   P_m2
+    Ba                Bb    Bp
+
+ABDFactor factorizes it (or a batch of such matrices of the same size) by block cyclic reduction: at every level the rows of neighbouring
+intervals are paired and their shared node is eliminated by Gaussian elimination with row
+pivoting inside the 2n x n block, for all pairs at once. After log2(m) levels one interval
+row (y_0, y_{m-1}, p) is left, it is solved together with the boundary conditions as a dense
+(2n+k) system. The work is O(m n^2 (n+k)), the elimination order depends only on m and
+is cached, the factor is reused for any number of right hand sides.
+"""
+
+import functools
+import typing
+
+import numpy as np
+
+from spdm.utils.type_hint import ArrayType
+
+
+@functools.lru_cache(maxsize=64)
+def _levels(m: int) -> typing.Tuple[typing.Tuple[int, bool], ...]:
+    """(number of rows, has an unpaired last row) of every reduction level for m-1 interval rows"""
+    levels = []
+    q = m - 1
+    while q > 1:
+        levels.append((q, q % 2 == 1))
+        q = (q + 1) // 2
+    return tuple(levels)
+
+
+def _eliminate(w: ArrayType, n: int) -> ArrayType:
+    """Gaussian elimination with partial pivoting of the first n columns of w[rows, :, b], in place
+
+    The batch is the last (contiguous) axis, so that every row operation is one vector operation.
+    Returns the mask of singular batch members (their zero pivots are replaced by 1).
+    """
+    b = np.arange(w.shape[-1])
+    singular = np.zeros(w.shape[-1], dtype=bool)
+    for j in range(n):
+        piv = j + np.argmax(np.abs(w[j:, j]), axis=0)
+        row = w[j].copy()
+        w[j] = w[piv, :, b].T
+        w[piv, :, b] = row.T
+        zero = w[j, j] == 0
+        if np.any(zero):
+            singular |= zero
+            w[j, j, zero] = 1.0
+        lower = w[j + 1 :, j] / w[j, j]
+        w[j + 1 :, j:] -= lower[:, None] * w[j, None, j:]
+    return singular
+
+
+class ABDFactor:
+    """Factorization of the ABD matrix, see module doc
+
+    Args:
+        a, c  : [*batch, m-1, n, n] derivative of the interval residual i on y_i and y_{i+1}
+        p     : [*batch, m-1, n, k] on the parameters, or None
+        ba, bb: [*batch, n+k, n]    derivative of the boundary conditions on y_0, y_{m-1}
+        bp    : [*batch, n+k, k]    or None
+
+    A batch of problems with the same mesh size is factorized together, `singular` marks the
+    singular members. Without batch a singular matrix raises RuntimeError (as splu).
+    """
+
+    def __init__(self, a: ArrayType, c: ArrayType, p: ArrayType, ba: ArrayType, bb: ArrayType, bp: ArrayType):
+        *batch, m1, n, _ = a.shape
+        k = 0 if p is None else p.shape[-1]
+        dtype = np.result_type(a, c, ba, bb, *([] if k == 0 else [p, bp]))
+        nb = int(np.prod(batch, dtype=int))
+        a = np.reshape(a, (nb, m1, n, n))
+        c = np.reshape(c, (nb, m1, n, n))
+        ba = np.reshape(ba, (nb, n + k, n))
+        bb = np.reshape(bb, (nb, n + k, n))
+        p = np.zeros((nb, m1, n, 0), dtype=dtype) if k == 0 else np.reshape(p, (nb, m1, n, k))
+        bp = np.zeros((nb, n + k, 0), dtype=dtype) if k == 0 else np.reshape(bp, (nb, n + k, k))
+
+        self._n, self._k, self._m = n, k, m1 + 1
+        self._batch = tuple(batch)
+        self._nb = nb
+        self._dtype = dtype
+        self._stages = []
+        singular = np.zeros(nb, dtype=bool)
+
+        left, right, par = a, c, p
+        for q, odd in _levels(self._m):
+            pairs = q // 2
+            # [2n, mid | left | right | p | I, batch * pairs]
+            w = np.zeros((2 * n, 5 * n + k, nb, pairs), dtype=dtype)
+            w[:n, :n] = right[:, 0 : 2 * pairs : 2].transpose(2, 3, 0, 1)
+            w[n:, :n] = left[:, 1 : 2 * pairs : 2].transpose(2, 3, 0, 1)
+            w[:n, n : 2 * n] = left[:, 0 : 2 * pairs : 2].transpose(2, 3, 0, 1)
+            w[n:, 2 * n : 3 * n] = right[:, 1 : 2 * pairs : 2].transpose(2, 3, 0, 1)
+            w[:n, 3 * n : 3 * n + k] = par[:, 0 : 2 * pairs : 2].transpose(2, 3, 0, 1)
+            w[n:, 3 * n : 3 * n + k] = par[:, 1 : 2 * pairs : 2].transpose(2, 3, 0, 1)
+            w[:, 3 * n + k :] = np.identity(2 * n)[:, :, None, None]
+            w = w.reshape(2 * n, 5 * n + k, nb * pairs)
+
+            singular |= _eliminate(w, n).reshape(nb, pairs).any(axis=1)
+            w = w.transpose(2, 0, 1).reshape(nb, pairs, 2 * n, 5 * n + k)
+
+            u_inv = np.linalg.inv(np.triu(w[..., :n, :n]))
+            # 回代: y_mid = u_inv t1 - x [y_left, y_right, p]
+            self._stages.append(
+                (
+                    odd,
+                    np.ascontiguousarray(w[..., 3 * n + k :]),  # T = M^-1 P, applied to the pair of right hand sides
+                    u_inv,
+                    u_inv @ w[..., :n, n : 3 * n + k],
+                )
+            )
+
+            reduced = w[..., n:, n : 3 * n + k]
+            if odd:
+                left = np.concatenate([reduced[..., :n], left[:, -1:]], axis=1)
+                right = np.concatenate([reduced[..., n : 2 * n], right[:, -1:]], axis=1)
+                par = np.concatenate([reduced[..., 2 * n :], par[:, -1:]], axis=1)
+            else:
+                left, right, par = reduced[..., :n], reduced[..., n : 2 * n], reduced[..., 2 * n :]
+
+        # 最后一行与边界条件: 未知量 (y_0, y_{m-1}, p), 稠密 (2n+k) 消元
+        size = 2 * n + k
+        top = np.concatenate([left[:, 0], right[:, 0], par[:, 0]], axis=-1)
+        bottom = np.concatenate([ba, bb, bp], axis=-1)
+        w = np.zeros((size, 2 * size, nb), dtype=dtype)
+        w[:, :size] = np.concatenate([top, bottom], axis=1).transpose(1, 2, 0)
+        w[:, size:] = np.identity(size)[:, :, None]
+        singular |= _eliminate(w, size)
+        w = w.transpose(2, 0, 1)
+        self._dense_inv = np.linalg.inv(np.triu(w[:, :, :size])) @ w[:, :, size:]
+
+        self._singular = singular.reshape(self._batch)
+        if len(self._batch) == 0 and np.any(singular):
+            raise RuntimeError("Factor is exactly singular")
+
+    @property
+    def singular(self) -> ArrayType:
+        return self._singular
+
+    def solve(self, rhs: ArrayType) -> ArrayType:
+        """x of J x = rhs[*batch, (m-1)*n + n+k], rhs is ordered as (interval residuals, boundary conditions)"""
+        n, k, m, nb = self._n, self._k, self._m, self._nb
+        rhs = np.asarray(rhs)
+        shape = rhs.shape
+        rhs = rhs.reshape(nb, -1)
+        r = rhs[:, : (m - 1) * n].reshape(nb, m - 1, n)
+
+        pivots = []
+        for odd, t, *_ in self._stages:
+            pairs = t.shape[1]
+            r2 = (t @ r[:, : 2 * pairs].reshape(nb, pairs, 2 * n, 1))[..., 0]
+            pivots.append(r2[..., :n])
+            r = np.concatenate([r2[..., n:], r[:, -1:]], axis=1) if odd else r2[..., n:]
+
+        z = (self._dense_inv @ np.concatenate([r[:, 0], rhs[:, (m - 1) * n :]], axis=-1)[..., None])[..., 0]
+        p = z[:, 2 * n :]
+
+        # 节点链 y[batch, nodes, n], 逐层回代中间节点
+        y = z[:, : 2 * n].reshape(nb, 2, n)
+        for (odd, _, u_inv, x), t1 in zip(reversed(self._stages), reversed(pivots)):
+            pairs = t1.shape[1]
+            border = np.concatenate([y[:, :pairs], y[:, 1 : pairs + 1], np.repeat(p[:, None], pairs, axis=1)], axis=-1)
+            y_mid = (u_inv @ t1[..., None] - x @ border[..., None])[..., 0]
+            merged = np.empty((nb, 2 * pairs + (2 if odd else 1), n), dtype=y_mid.dtype)
+            merged[:, 0 : 2 * pairs + 1 : 2] = y[:, : pairs + 1]
+            merged[:, 1 : 2 * pairs : 2] = y_mid
+            if odd:
+                merged[:, -1] = y[:, -1]
+            y = merged
+
+        return np.concatenate([y.reshape(nb, -1), p], axis=-1).reshape(shape)
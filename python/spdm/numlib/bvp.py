@@ -12,15 +12,61 @@ from scipy.sparse import coo_matrix, csc_matrix
 from scipy.sparse.linalg import splu
 from spdm.utils.logger import logger
 
+from ..numlib.abd import ABDFactor
 from ..numlib.spline import create_spline_for_bvp
 
 EPS = np.finfo(float).eps
 
 
-def estimate_fun_jac(fun, x, y, p, f0=None):
+def color_columns(sparsity):
+    """
+        Group the columns of a sparsity pattern so that no two columns of a
+        group have a nonzero in the same row (greedy coloring).
+
+        Parameters
+        ----------
+        sparsity : array_like, shape (n, n) or None
+            Nonzero pattern of df/dy, an element (i, j) is True if f_i depends
+            on y_j.
+
+        Returns
+        -------
+        groups : list of ndarray
+            Column indices of every group. All columns of a group are
+            perturbed together, so that a Jacobian estimate needs one rhs
+            evaluation per group instead of per column.
+    """
+    sparsity = np.asarray(sparsity, dtype=bool)
+    groups = []
+    rows = []
+    for j in range(sparsity.shape[1]):
+        for g, used in enumerate(rows):
+            if not np.any(used & sparsity[:, j]):
+                groups[g].append(j)
+                used |= sparsity[:, j]
+                break
+        else:
+            groups.append([j])
+            rows.append(sparsity[:, j].copy())
+    return [np.asarray(g) for g in groups]
+
+
+def _scatter_columns(df, diff, group, hi, sparsity):
+    """df[:, j, :] = diff / hi[j] on the rows of column j, for j in group."""
+    if sparsity is None:
+        df[:, group[0], :] = diff / hi[0]
+    else:
+        for j, h in zip(group, hi):
+            df[:, j, :] = np.where(sparsity[:, j, np.newaxis], diff / h, 0)
+
+
+def estimate_fun_jac(fun, x, y, p, f0=None, sparsity=None):
     """
         Estimate derivatives of an ODE system rhs with forward differences.
 
+        If the nonzero pattern `sparsity` (n, n) of df/dy is given, the
+        columns are colored (see `color_columns`) and perturbed together.
+
         Returns
         -------
         df_dy : ndarray, shape (n, n, m)
@@ -38,12 +84,13 @@ def estimate_fun_jac(fun, x, y, p, f0=None):
 
     df_dy = np.empty((n, n, m), dtype=dtype)
     h = EPS**0.5 * (1 + np.abs(y))
-    for i in range(n):
+    groups = [[i] for i in range(n)] if sparsity is None else color_columns(sparsity)
+    for group in groups:
         y_new = y.copy()
-        y_new[i] += h[i]
-        hi = y_new[i] - y[i]
+        y_new[group] += h[group]
+        hi = y_new[group] - y[group]
         f_new = fun(x, y_new, p)
-        df_dy[:, i, :] = (f_new - f0) / hi
+        _scatter_columns(df_dy, f_new - f0, group, hi, sparsity)
 
     k = p.shape[0]
     if k == 0:
@@ -61,6 +108,87 @@ def estimate_fun_jac(fun, x, y, p, f0=None):
     return df_dy, df_dp
 
 
+def complex_step_fun_jac(fun, x, y, p, sparsity=None, h=1e-30):
+    """
+        Derivatives of an ODE system rhs by the complex step
+        df/dy_j = Im f(y + i h e_j) / h, exact to round-off for rhs which are
+        real analytic and accept complex y and p (no abs, comparisons or
+        casts to float in `fun`). Columns are colored as in
+        `estimate_fun_jac`.
+
+        Returns df_dy (n, n, m) and df_dp (n, k, m) or None.
+    """
+    n, m = y.shape
+    y = np.asarray(y, dtype=float)
+    p = np.asarray(p, dtype=float)
+
+    df_dy = np.empty((n, n, m))
+    groups = [[i] for i in range(n)] if sparsity is None else color_columns(sparsity)
+    for group in groups:
+        y_new = y.astype(complex)
+        y_new[group] += 1j * h
+        f_new = np.asarray(fun(x, y_new, p))
+        _scatter_columns(df_dy, f_new.imag, group, np.full(len(group), h), sparsity)
+
+    k = p.shape[0]
+    if k == 0:
+        df_dp = None
+    else:
+        df_dp = np.empty((n, k, m))
+        for i in range(k):
+            p_new = p.astype(complex)
+            p_new[i] += 1j * h
+            df_dp[:, i, :] = np.asarray(fun(x, y, p_new)).imag / h
+
+    return df_dy, df_dp
+
+
+def complex_step_bc_jac(bc, ya, yb, p, h=1e-30):
+    """
+        Derivatives of the boundary conditions by the complex step, see
+        `complex_step_fun_jac`. Returns dbc_dya, dbc_dyb (n + k, n) and
+        dbc_dp (n + k, k) or None.
+    """
+    z = np.concatenate([ya, yb, p]).astype(float)
+    n, k = ya.shape[0], p.shape[0]
+    jac = np.empty((n + k, z.size))
+    for i in range(z.size):
+        z_new = z.astype(complex)
+        z_new[i] += 1j * h
+        jac[:, i] = np.asarray(bc(z_new[:n], z_new[n:2 * n], z_new[2 * n:])).imag / h
+    return jac[:, :n], jac[:, n:2 * n], (jac[:, 2 * n:] if k > 0 else None)
+
+
+def complex_step_jacobians(fun, bc, fun_jac, bc_jac, k, sparsity=None):
+    """
+        Replace `fun_jac` / `bc_jac` given as "complex_step" by functions with
+        the user calling signature (``fun_jac(x, y)`` or ``fun_jac(x, y, p)``,
+        see `solve_bvp`), which evaluate the exact derivatives of the user
+        `fun` and `bc` by the complex step.
+    """
+    for name, value in (("fun_jac", fun_jac), ("bc_jac", bc_jac)):
+        if isinstance(value, str) and value != "complex_step":
+            raise ValueError(f"Unknown `{name}` method {value}")
+
+    if fun_jac == "complex_step":
+        if k == 0:
+            def fun_jac(x, y):
+                return complex_step_fun_jac(lambda x, y, _: fun(x, y), x, y, np.empty(0), sparsity)[0]
+        else:
+            def fun_jac(x, y, p):
+                return complex_step_fun_jac(fun, x, y, p, sparsity)
+
+    if bc_jac == "complex_step":
+        if k == 0:
+            def bc_jac(ya, yb):
+                return complex_step_bc_jac(lambda ya, yb, _: bc(ya, yb), ya, yb, np.empty(0))[:2]
+        else:
+            def bc_jac(ya, yb, p):
+                return complex_step_bc_jac(bc, ya, yb, p)
+
+    return fun_jac, bc_jac
+
+
 def estimate_bc_jac(bc, ya, yb, p, bc0=None):
     """
         Estimate derivatives of boundary conditions with forward differences.
@@ -151,17 +279,15 @@ def stacked_matmul(a, b):
     """
         Stacked matrix multiply: out[i,:,:] = np.dot(a[i,:,:], b[i,:,:]).
 
-        In our case a[i, :, :] and b[i, :, :] are always square.
+        In our case a[i, :, :] is always square.
     """
-    # Empirical optimization. Use outer Python loop and BLAS for large
-    # matrices, otherwise use a single einsum call.
-    if a.shape[1] > 50:
-        out = np.empty_like(a)
-        for i in range(a.shape[0]):
-            out[i] = np.dot(a[i], b[i])
-        return out
-    else:
+    # Empirical optimization. The arrays of the solver are transposed views
+    # of (n, n, m) arrays. For m = 20000 einsum is as fast as or faster than
+    # the batched matmul up to n = 5, and matmul wins from n = 6 on.
+    if a.shape[1] <= 5:
         return np.einsum('...ij,...jk->...ik', a, b)
+    else:
+        return np.matmul(a, b)
 
 
 def construct_global_jac(n, m, k, i_jac, j_jac, h, df_dy, df_dy_middle, df_dp,
@@ -247,6 +373,35 @@ def construct_global_jac(n, m, k, i_jac, j_jac, h, df_dy, df_dy_middle, df_dp,
         Control and the Maltab PSE", ACM Trans. Math. Softw., Vol. 27,
         Number 3, pp. 299-316, 2001.
     """
+    dPhi_dy_0, dPhi_dy_1, dPhi_dp, dbc_dya, dbc_dyb, dbc_dp = \
+        construct_abd_jac(n, m, k, h, df_dy, df_dy_middle, df_dp,
+                          df_dp_middle, dbc_dya, dbc_dyb, dbc_dp)
+
+    values = np.hstack((dPhi_dy_0.ravel(), dPhi_dy_1.ravel(), dbc_dya.ravel(),
+                        dbc_dyb.ravel()))
+
+    if k > 0:
+        values = np.hstack((values, dPhi_dp.ravel(), dbc_dp.ravel()))
+
+    J = coo_matrix((values, (i_jac, j_jac)))
+    return csc_matrix(J)
+
+
+def construct_abd_jac(n, m, k, h, df_dy, df_dy_middle, df_dp, df_dp_middle,
+                      dbc_dya, dbc_dyb, dbc_dp):
+    """
+        Blocks of the collocation Jacobian in the almost block diagonal form,
+        see `construct_global_jac` for the structure and `abd.ABDFactor`.
+
+        Returns
+        -------
+        dPhi_dy_0, dPhi_dy_1 : ndarray, shape (m - 1, n, n)
+            Diagonal (blocks 1) and off-diagonal (blocks 2) blocks.
+        dPhi_dp : ndarray with shape (m - 1, n, k) or None
+            Blocks 5.
+        dbc_dya, dbc_dyb, dbc_dp :
+            Blocks 3, 4 and 6.
+    """
     df_dy = np.transpose(df_dy, (2, 0, 1))
     df_dy_middle = np.transpose(df_dy_middle, (2, 0, 1))
 
@@ -268,19 +423,15 @@ def construct_global_jac(n, m, k, i_jac, j_jac, h, df_dy, df_dy_middle, df_dp,
     T = stacked_matmul(df_dy_middle, df_dy[1:])
     dPhi_dy_1 += h**2 / 12 * T
 
-    values = np.hstack((dPhi_dy_0.ravel(), dPhi_dy_1.ravel(), dbc_dya.ravel(),
-                        dbc_dyb.ravel()))
-
+    dPhi_dp = None
     if k > 0:
         df_dp = np.transpose(df_dp, (2, 0, 1))
         df_dp_middle = np.transpose(df_dp_middle, (2, 0, 1))
         T = stacked_matmul(df_dy_middle, df_dp[:-1] - df_dp[1:])
-        df_dp_middle += 0.125 * h * T
+        df_dp_middle = df_dp_middle + 0.125 * h * T
         dPhi_dp = -h/6 * (df_dp[:-1] + df_dp[1:] + 4 * df_dp_middle)
-        values = np.hstack((values, dPhi_dp.ravel(), dbc_dp.ravel()))
 
-    J = coo_matrix((values, (i_jac, j_jac)))
-    return csc_matrix(J)
+    return dPhi_dy_0, dPhi_dy_1, dPhi_dp, dbc_dya, dbc_dyb, dbc_dp
 
 
 def collocation_fun(fun, y, p, x, h):
@@ -316,31 +467,66 @@ def collocation_fun(fun, y, p, x, h):
             Number 3, pp. 299-316, 2001.
     """
     f = fun(x, y, p)
-    y_middle = (0.5 * (y[:, 1:] + y[:, :-1]) -
-                0.125 * h * (f[:, 1:] - f[:, :-1]))
+    # In-place updates, fewer (n, m - 1) temporaries.
+    df = f[:, 1:] - f[:, :-1]
+    df *= 0.125 * h
+    y_middle = y[:, 1:] + y[:, :-1]
+    y_middle *= 0.5
+    y_middle -= df
     f_middle = fun(x[:-1] + 0.5 * h, y_middle, p)
-    col_res = y[:, 1:] - y[:, :-1] - h / 6 * (f[:, :-1] + f[:, 1:] +
-                                              4 * f_middle)
+    col_res = f[:, :-1] + f[:, 1:]
+    col_res += 4 * f_middle
+    col_res *= -h / 6
+    col_res += y[:, 1:]
+    col_res -= y[:, :-1]
 
     return col_res, y_middle, f, f_middle
 
 
-def prepare_sys(n, m, k, fun, bc, fun_jac, bc_jac, x, h):
-    """Create the function and the Jacobian for the collocation system."""
+def interleave(a, b):
+    """[a_0, b_0, a_1, b_1, ..., a_{m-1}] along the last axis, b has one
+    element less than a."""
+    out = np.empty(a.shape[:-1] + (a.shape[-1] + b.shape[-1],),
+                   dtype=np.result_type(a, b))
+    out[..., 0::2] = a
+    out[..., 1::2] = b
+    return out
+
+
+def prepare_sys(n, m, k, fun, bc, fun_jac, bc_jac, x, h, linear_solver="abd",
+                jac_sparsity=None):
+    """Create the function and the Jacobian for the collocation system.
+
+    linear_solver : "abd" the Jacobian is returned as the tuple of its blocks
+                    (factorized by `abd.ABDFactor`), "splu" as a csc_matrix.
+    jac_sparsity  : nonzero pattern of df/dy for the colored finite differences.
+    """
     x_middle = x[:-1] + 0.5 * h
-    i_jac, j_jac = compute_jac_indices(n, m, k)
+    # Nodes and middle points interleaved (still increasing), the Jacobian of
+    # the rhs at both is evaluated in one pass over the mesh.
+    x_all = interleave(x, x_middle)
+    if linear_solver == "splu":
+        i_jac, j_jac = compute_jac_indices(n, m, k)
+    elif linear_solver != "abd":
+        raise ValueError(f"Unknown linear solver {linear_solver}")
 
     def col_fun(y, p):
         return collocation_fun(fun, y, p, x, h)
 
     def sys_jac(y, p, y_middle, f, f_middle, bc0):
+        y_all = interleave(y, y_middle)
         if fun_jac is None:
-            df_dy, df_dp = estimate_fun_jac(fun, x, y, p, f)
-            df_dy_middle, df_dp_middle = estimate_fun_jac(
-                fun, x_middle, y_middle, p, f_middle)
+            df_dy, df_dp = estimate_fun_jac(fun, x_all, y_all, p,
+                                            interleave(f, f_middle),
+                                            jac_sparsity)
         else:
-            df_dy, df_dp = fun_jac(x, y, p)
-            df_dy_middle, df_dp_middle = fun_jac(x_middle, y_middle, p)
+            df_dy, df_dp = fun_jac(x_all, y_all, p)
+
+        df_dy, df_dy_middle = df_dy[..., 0::2], df_dy[..., 1::2]
+        if df_dp is not None:
+            df_dp, df_dp_middle = df_dp[..., 0::2], df_dp[..., 1::2]
+        else:
+            df_dp_middle = None
 
         if bc_jac is None:
             dbc_dya, dbc_dyb, dbc_dp = estimate_bc_jac(bc, y[:, 0], y[:, -1],
@@ -348,6 +534,10 @@ def prepare_sys(n, m, k, fun, bc, fun_jac, bc_jac, x, h):
         else:
             dbc_dya, dbc_dyb, dbc_dp = bc_jac(y[:, 0], y[:, -1], p)
 
+        if linear_solver == "abd":
+            return construct_abd_jac(n, m, k, h, df_dy, df_dy_middle, df_dp,
+                                     df_dp_middle, dbc_dya, dbc_dyb, dbc_dp)
+
         return construct_global_jac(n, m, k, i_jac, j_jac, h, df_dy,
                                     df_dy_middle, df_dp, df_dp_middle, dbc_dya,
                                     dbc_dyb, dbc_dp)
@@ -388,7 +578,7 @@ def solve_newton(n, m, h, col_fun, bc, jac, y, p, B, bvp_tol, bc_tol):
         jac : callable
             Function computing the Jacobian of the whole system (including
             collocation and boundary condition residuals). It is supposed to
-            return csc_matrix.
+            return csc_matrix, or the tuple of blocks of `construct_abd_jac`.
         y : ndarray, shape (n, m)
             Initial guess for the function values at the mesh nodes.
         p : ndarray, shape (k,)
@@ -459,7 +649,7 @@ def solve_newton(n, m, h, col_fun, bc, jac, y, p, B, bvp_tol, bc_tol):
             J = jac(y, p, y_middle, f, f_middle, bc_res)
             njev += 1
             try:
-                LU = splu(J)
+                LU = ABDFactor(*J) if isinstance(J, tuple) else splu(J)
             except RuntimeError:
                 singular = True
                 break
@@ -738,7 +928,8 @@ def wrap_functions(fun, bc, fun_jac, bc_jac, k, a, S, D, dtype):
 
 
 def solve_bvp(fun, bc, x, y, p=None, *args, S=None, fun_jac=None, bc_jac=None,
-              tol=1e-3, max_nodes=1000, verbose=0, bc_tol=None, bvp_rms_mask=None, **kwargs):
+              tol=1e-3, max_nodes=1000, verbose=0, bc_tol=None, bvp_rms_mask=None,
+              linear_solver="abd", jac_sparsity=None, **kwargs):
     """
         Solve a boundary-value problem for a system of ODEs.
 
@@ -796,7 +987,7 @@ def solve_bvp(fun, bc, x, y, p=None, *args, S=None, fun_jac=None, bc_jac=None,
         S : array_like with shape (n, n) or None
             Matrix defining the singular term. If None (default), the problem is
             solved without the singular term.
-        fun_jac : callable or None, optional
+        fun_jac : callable, "complex_step" or None, optional
             Function computing derivatives of f with respect to y and p. The
             calling signature is ``fun_jac(x, y)``, or ``fun_jac(x, y, p)`` if
             parameters are present. The return must contain 1 or 2 elements in the
@@ -812,8 +1003,10 @@ def solve_bvp(fun, bc, x, y, p=None, *args, S=None, fun_jac=None, bc_jac=None,
             parameters df_dp should not be returned.
 
             If `fun_jac` is None (default), the derivatives will be estimated
-            by the forward finite differences.
-        bc_jac : callable or None, optional
+            by the forward finite differences. If `fun_jac` is "complex_step",
+            they are computed exactly by the complex step from `fun`, which
+            then must accept complex y and p.
+        bc_jac : callable, "complex_step" or None, optional
             Function computing derivatives of bc with respect to ya, yb and p.
             The calling signature is ``bc_jac(ya, yb)``, or ``bc_jac(ya, yb, p)``
             if parameters are present. The return must contain 2 or 3 elements in
@@ -830,7 +1023,7 @@ def solve_bvp(fun, bc, x, y, p=None, *args, S=None, fun_jac=None, bc_jac=None,
             be returned.
 
             If `bc_jac` is None (default), the derivatives will be estimated by
-            the forward finite differences.
+            the forward finite differences, "complex_step" as for `fun_jac`.
         tol : float, optional
             Desired tolerance of the solution. If we define ``r = y' - f(x, y)``
             where y is the found solution, then the solver tries to achieve on each
@@ -851,6 +1044,15 @@ def solve_bvp(fun, bc, x, y, p=None, *args, S=None, fun_jac=None, bc_jac=None,
             value should satisfy ``abs(bc) < bc_tol`` component-wise.
             Equals to `tol` by default. Up to 10 iterations are allowed to achieve this
             tolerance.
+        jac_sparsity : array_like with shape (n, n), optional
+            Nonzero pattern of df/dy. The columns of the Jacobian estimate
+            (finite differences or complex step) are colored by it, so that a
+            Jacobian costs one `fun` evaluation per color instead of per
+            component. Ignored with a singular term S.
+        linear_solver : {"abd", "splu"}, optional
+            Factorization of the Newton systems: "abd" (default) the structured
+            almost block diagonal LU of `abd.ABDFactor`, "splu" the general
+            sparse LU of the assembled csc_matrix.
         discontinuity: list *experimental*
             NOTE: add by salmon
             List of discontinuity points
@@ -1091,6 +1293,19 @@ def solve_bvp(fun, bc, x, y, p=None, *args, S=None, fun_jac=None, bc_jac=None,
     # Maximum number of iterations
     max_iteration = 10
 
+    if jac_sparsity is not None:
+        jac_sparsity = np.asarray(jac_sparsity, dtype=bool)
+        if jac_sparsity.shape != (n, n):
+            raise ValueError("`jac_sparsity` is expected to have shape {}, "
+                             "but actually has {}".format((n, n), jac_sparsity.shape))
+        if S is not None:
+            jac_sparsity = None
+
+    if isinstance(fun_jac, str) or isinstance(bc_jac, str):
+        if dtype is complex:
+            raise ValueError("The complex step Jacobian needs a real problem.")
+        fun_jac, bc_jac = complex_step_jacobians(fun, bc, fun_jac, bc_jac, k, jac_sparsity)
+
     fun_wrapped, bc_wrapped, fun_jac_wrapped, bc_jac_wrapped = wrap_functions(
         fun, bc, fun_jac, bc_jac, k, a, S, D, dtype)
 
@@ -1112,7 +1327,8 @@ def solve_bvp(fun, bc, x, y, p=None, *args, S=None, fun_jac=None, bc_jac=None,
     while True:
         m = x.shape[0]
 
-        col_fun, jac_sys = prepare_sys(n, m, k, fun_wrapped, bc_wrapped, fun_jac_wrapped, bc_jac_wrapped, x, h)
+        col_fun, jac_sys = prepare_sys(n, m, k, fun_wrapped, bc_wrapped, fun_jac_wrapped, bc_jac_wrapped, x, h,
+                                       linear_solver, jac_sparsity)
         y, p, singular = solve_newton(n, m, h, col_fun, bc_wrapped, jac_sys,  y, p, B, tol, bc_tol)
         iteration += 1
 
@@ -1128,7 +1344,7 @@ def solve_bvp(fun, bc, x, y, p=None, *args, S=None, fun_jac=None, bc_jac=None,
         ########################################
         # add by salmon 2021.6.15
 
-        rms_mask = False
+        rms_mask = np.zeros(m - 1, dtype=bool)
 
         for xd in bvp_rms_mask or []:
             rms_mask |= (x[:-1] <= xd) & (xd <= x[1:])
@@ -0,0 +1,290 @@
+""" 批量边值问题 Many two point boundary value problems of the same structure, solved in lockstep
+
+    >>> res = solve_bvp_many(fun, bc, x, y, args=params)   # y[B, n, m], params[B, q]
+
+The algorithm is that of `bvp.solve_bvp` (collocation by cubic C1 splines, damped Newton, mesh
+refinement by the rms residuals), applied to all problems together:
+
+- the rhs is called once for all nodes of all problems (problems are concatenated along the node
+  axis, their parameters are repeated per node)
+- problems with the same number of nodes share one batched `abd.ABDFactor`
+- every problem has its own step length, convergence and singularity masks
+- the mesh is refined per problem, only where its residuals are too large
+
+Unknown parameters (k > 0) are not supported.
+"""
+
+import typing
+
+import numpy as np
+
+from spdm.utils.logger import logger
+from spdm.utils.type_hint import ArrayType
+from spdm.numlib.abd import ABDFactor
+from spdm.numlib.bvp import EPS, TERMINATION_MESSAGES, BVPResult, modify_mesh
+from spdm.numlib.spline import create_spline_for_bvp
+
+
+class _Group:
+    """Problems with the same mesh size, arrays are [g, ...]"""
+
+    def __init__(self, fun, bc, x: ArrayType, args: ArrayType):
+        self._fun = fun
+        self._bc = bc
+        self.x = x
+        self.h = np.diff(x, axis=-1)
+        self.args = args
+        self.x_middle = x[:, :-1] + 0.5 * self.h
+
+    def rhs(self, x: ArrayType, y: ArrayType) -> ArrayType:
+        """f at x[g, m'] and y[g, n, m'], one call of fun for all problems"""
+        g, n, m = y.shape
+        yf = y.transpose(1, 0, 2).reshape(n, g * m)
+        if self.args is None:
+            f = self._fun(x.ravel(), yf)
+        else:
+            f = self._fun(x.ravel(), yf, np.repeat(self.args, m, axis=0).T)
+        return np.asarray(f, dtype=float).reshape(n, g, m).transpose(1, 0, 2)
+
+    def bc(self, ya: ArrayType, yb: ArrayType) -> ArrayType:
+        """boundary residuals [g, n] of ya, yb [g, n]"""
+        if self.args is None:
+            res = self._bc(ya.T, yb.T)
+        else:
+            res = self._bc(ya.T, yb.T, self.args.T)
+        return np.asarray(res, dtype=float).T
+
+    def collocation(self, y: ArrayType):
+        h = self.h[:, None]
+        f = self.rhs(self.x, y)
+        y_middle = 0.5 * (y[..., 1:] + y[..., :-1]) - 0.125 * h * (f[..., 1:] - f[..., :-1])
+        f_middle = self.rhs(self.x_middle, y_middle)
+        col_res = y[..., 1:] - y[..., :-1] - h / 6 * (f[..., :-1] + f[..., 1:] + 4 * f_middle)
+        return col_res, y_middle, f, f_middle
+
+    def fun_jac(self, x: ArrayType, y: ArrayType, f0: ArrayType) -> ArrayType:
+        """df/dy [g, m', n, n] by forward differences, n calls for all problems"""
+        n = y.shape[1]
+        jac = np.empty(y.shape[:1] + y.shape[2:] + (n, n))
+        step = EPS**0.5 * (1 + np.abs(y))
+        for j in range(n):
+            y_new = y.copy()
+            y_new[:, j] += step[:, j]
+            jac[..., :, j] = ((self.rhs(x, y_new) - f0) / (y_new[:, j] - y[:, j])[:, None]).transpose(0, 2, 1)
+        return jac
+
+    def bc_jac(self, ya: ArrayType, yb: ArrayType, bc0: ArrayType) -> typing.Tuple[ArrayType, ArrayType]:
+        n = ya.shape[1]
+        jac = np.empty(ya.shape[:1] + (n, 2 * n))
+        z = np.concatenate([ya, yb], axis=1)
+        step = EPS**0.5 * (1 + np.abs(z))
+        for j in range(2 * n):
+            z_new = z.copy()
+            z_new[:, j] += step[:, j]
+            jac[..., j] = (self.bc(z_new[:, :n], z_new[:, n:]) - bc0) / (z_new[:, j] - z[:, j])[:, None]
+        return jac[..., :n], jac[..., n:]
+
+    def jacobian(self, y, y_middle, f, f_middle, bc0) -> ABDFactor:
+        """batched ABD factor of the collocation Jacobians, see bvp.construct_abd_jac"""
+        n = y.shape[1]
+        df_dy = self.fun_jac(self.x, y, f)
+        df_dy_middle = self.fun_jac(self.x_middle, y_middle, f_middle)
+        h = self.h[..., None, None]
+        eye = np.identity(n)
+
+        a = -eye - h / 6 * (df_dy[:, :-1] + 2 * df_dy_middle) - h**2 / 12 * (df_dy_middle @ df_dy[:, :-1])
+        c = eye - h / 6 * (df_dy[:, 1:] + 2 * df_dy_middle) + h**2 / 12 * (df_dy_middle @ df_dy[:, 1:])
+        dbc_dya, dbc_dyb = self.bc_jac(y[..., 0], y[..., -1], bc0)
+        return ABDFactor(a, c, None, dbc_dya, dbc_dyb, None)
+
+    def rms_residuals(self, y: ArrayType, f: ArrayType, r_middle: ArrayType, f_middle: ArrayType) -> ArrayType:
+        """rms of the relative residuals [g, m-1] by Lobatto quadrature, see bvp.estimate_rms_residuals"""
+        h = self.h[:, None]
+        s = 0.5 * (3 / 7) ** 0.5
+        # 每个区间上的三次 Hermite 插值, t in [0,1]
+        slope = (y[..., 1:] - y[..., :-1]) / h
+        t_coef = (f[..., :-1] + f[..., 1:] - 2 * slope) / h
+        c0, c1, c2, c3 = t_coef / h, (slope - f[..., :-1]) / h - t_coef, f[..., :-1], y[..., :-1]
+
+        res = []
+        for u in (0.5 - s, 0.5 + s):
+            d = u * h
+            yu = ((c0 * d + c1) * d + c2) * d + c3
+            ypu = (3 * c0 * d + 2 * c1) * d + c2
+            fu = self.rhs(self.x[:, :-1] + u * self.h, yu)
+            r = (ypu - fu) / (1 + np.abs(fu))
+            res.append(np.sum(r**2, axis=1))
+        r_middle = np.sum((r_middle / (1 + np.abs(f_middle))) ** 2, axis=1)
+        return (0.5 * (32 / 45 * r_middle + 49 / 90 * (res[0] + res[1]))) ** 0.5
+
+
+def _newton(group: _Group, y: ArrayType, bvp_tol: float, bc_tol: float):
+    """Damped Newton iterations of all problems of the group in lockstep (see bvp.solve_newton)
+
+    Returns y, singular mask
+    """
+    tol_r = 2 / 3 * group.h[:, None] * 5e-2 * bvp_tol
+    max_iter, sigma, tau, n_trial = 8, 0.2, 0.5, 4
+
+    g, n, m = y.shape
+    singular = np.zeros(g, dtype=bool)
+    active = np.ones(g, dtype=bool)
+
+    def residual(y):
+        col_res, y_middle, f, f_middle = group.collocation(y)
+        bc_res = group.bc(y[..., 0], y[..., -1])
+        res = np.concatenate([col_res.transpose(0, 2, 1).reshape(g, -1), bc_res], axis=1)
+        return res, (col_res, y_middle, f, f_middle, bc_res)
+
+    res, state = residual(y)
+    for _ in range(max_iter):
+        col_res, y_middle, f, f_middle, bc_res = state
+        lu = group.jacobian(y, y_middle, f, f_middle, bc_res)
+        singular |= lu.singular & active
+        active &= ~lu.singular
+
+        step = lu.solve(res)
+        cost = np.sum(step**2, axis=1)
+        y_step = step.reshape(g, m, n).transpose(0, 2, 1)
+
+        # 各问题独立的回溯线搜索
+        alpha = np.ones(g)
+        pending = active.copy()
+        y_new, res_new, state_new = y, res, state
+        for trial in range(n_trial + 1):
+            y_try = np.where(pending[:, None, None], y - alpha[:, None, None] * y_step, y_new)
+            res_try, state_try = residual(y_try)
+            cost_try = np.sum(lu.solve(res_try) ** 2, axis=1)
+            accept = pending & ((cost_try < (1 - 2 * alpha * sigma) * cost) | (trial == n_trial))
+            y_new = np.where(accept[:, None, None], y_try, y_new)
+            res_new = np.where(accept[:, None], res_try, res_new)
+            state_new = tuple(np.where(_mask(accept, s), t, s) for s, t in zip(state_new, state_try))
+            pending &= ~accept
+            alpha = np.where(pending, alpha * tau, alpha)
+            if not np.any(pending):
+                break
+
+        y, res, state = y_new, res_new, state_new
+        col_res, _, _, f_middle, bc_res = state
+        converged = np.all(np.abs(col_res) < tol_r * (1 + np.abs(f_middle)), axis=(1, 2)) & np.all(
+            np.abs(bc_res) < bc_tol, axis=1
+        )
+        active &= ~converged
+        if not np.any(active):
+            break
+
+    return y, singular
+
+
+def _mask(mask: ArrayType, like: ArrayType) -> ArrayType:
+    return mask.reshape(mask.shape + (1,) * (like.ndim - 1))
+
+
+def solve_bvp_many(
+    fun: typing.Callable,
+    bc: typing.Callable,
+    x: ArrayType,
+    y: ArrayType,
+    args: ArrayType = None,
+    tol: float = 1e-3,
+    max_nodes: int = 1000,
+    bc_tol: float = None,
+    verbose: int = 0,
+) -> typing.List[BVPResult]:
+    """Solve B boundary value problems  dy/dx = f(x, y, a_b),  bc(y(x_0), y(x_end), a_b) = 0
+
+    Args:
+        fun  : fun(x, y) or fun(x, y, a), x[M], y[n, M], a[q, M] -> [n, M], vectorized over the
+               nodes of all problems (the parameters of every problem are repeated on its nodes)
+        bc   : bc(ya, yb) or bc(ya, yb, a), ya, yb [n, B], a [q, B] -> [n, B]
+        x    : initial mesh [m] shared by all problems, or [B, m]
+        y    : initial guess [B, n, m]
+        args : parameters of the problems [B, q], or None
+        tol, max_nodes, bc_tol : as bvp.solve_bvp, per problem
+
+    Returns:
+        list of BVPResult (sol, x, y, yp, rms_residuals, niter, status, message, success)
+    """
+    y = np.asarray(y, dtype=float)
+    if y.ndim != 3:
+        raise ValueError(f"`y` must be [B, n, m], not {y.shape}")
+    nb, n, m = y.shape
+    x = np.broadcast_to(np.asarray(x, dtype=float), (nb, m))
+    if np.any(np.diff(x, axis=-1) <= 0):
+        raise ValueError("`x` must be strictly increasing.")
+    if args is not None:
+        args = np.asarray(args, dtype=float).reshape(nb, -1)
+    bc_tol = tol if bc_tol is None else bc_tol
+    max_iteration = 10
+
+    xs = list(x.copy())
+    ys = list(y.copy())
+    status = np.full(nb, -1)
+    niter = np.zeros(nb, dtype=int)
+    rms = [None] * nb
+    fs = [None] * nb
+    todo = np.arange(nb)
+
+    while todo.size > 0:
+        sizes = np.array([xs[i].size for i in todo])
+        for size in np.unique(sizes):
+            idx = todo[sizes == size]
+            group = _Group(fun, bc, np.stack([xs[i] for i in idx]), None if args is None else args[idx])
+
+            y_g, singular = _newton(group, np.stack([ys[i] for i in idx]), tol, bc_tol)
+            niter[idx] += 1
+
+            col_res, y_middle, f, f_middle = group.collocation(y_g)
+            bc_res = group.bc(y_g[..., 0], y_g[..., -1])
+            max_bc = np.max(np.abs(bc_res), axis=1)
+            rms_g = group.rms_residuals(y_g, f, 1.5 * col_res / group.h[:, None], f_middle)
+            max_rms = np.max(rms_g, axis=1)
+
+            for j, i in enumerate(idx):
+                ys[i], fs[i], rms[i] = y_g[j], f[j], rms_g[j]
+                if singular[j]:
+                    status[i] = 2
+                    continue
+                insert_1 = np.nonzero((rms_g[j] > tol) & (rms_g[j] < 100 * tol))[0]
+                insert_2 = np.nonzero(rms_g[j] >= 100 * tol)[0]
+                nodes_added = insert_1.size + 2 * insert_2.size
+                if xs[i].size + nodes_added > max_nodes:
+                    status[i] = 1
+                elif nodes_added > 0:
+                    # 仅对该问题加密网格, 在三次样条上插值初值
+                    sol = create_spline_for_bvp(y_g[j], f[j], xs[i], group.h[j])
+                    xs[i] = modify_mesh(xs[i], insert_1, insert_2)
+                    ys[i] = sol(xs[i])
+                elif max_bc[j] <= bc_tol:
+                    status[i] = 0
+                elif niter[i] >= max_iteration:
+                    status[i] = 3
+
+            if verbose > 1:
+                logger.info(
+                    f"solve_bvp_many: {idx.size} problems of {size} nodes, max rms {np.max(max_rms):.2e}, "
+                    f"max bc {np.max(max_bc):.2e}"
+                )
+
+        todo = np.flatnonzero(status < 0)
+
+    results = []
+    for i in range(nb):
+        h = np.diff(xs[i])
+        results.append(
+            BVPResult(
+                sol=create_spline_for_bvp(ys[i], fs[i], xs[i], h),
+                p=None,
+                x=xs[i],
+                y=ys[i],
+                yp=fs[i],
+                rms_residuals=rms[i],
+                niter=niter[i],
+                status=status[i],
+                message=TERMINATION_MESSAGES[status[i]],
+                success=status[i] == 0,
+            )
+        )
+    if verbose > 0:
+        logger.info(f"solve_bvp_many: {np.sum(status == 0)}/{nb} problems converged")
+    return results
@@ -7,12 +7,12 @@ import scipy.interpolate
 from skimage import measure
 
 from ..core.field import Field
-from ..core.expression import Variable
 from ..geometry.curve import Curve
 from ..core.geo_object import GeoObject
 from ..geometry.point import Point
+from ..mesh.mesh_curvilinear import CurvilinearMesh
+from .stencil import stencil
 from ..utils.logger import deprecated, logger
-from .optimize import minimize_filter
 
 # import matplotlib.pyplot as plt
 # @deprecated
@@ -79,6 +79,243 @@ def find_countours_skimage(vals: list, z: np.ndarray, x: np.ndarray, y: np.ndarr
         #     yield val, None
 
 
+# 单元角点 c0=(i,j) c1=(i+1,j) c2=(i+1,j+1) c3=(i,j+1)
+# 单元边   e0=c0-c1  e1=c1-c2  e2=c3-c2  e3=c0-c3
+_CELL_EDGES = ((0, 1), (1, 2), (3, 2), (0, 3))
+
+# the two crossed edges of a cell for every case code (saddles 5,10 are resolved separately)
+_SEGMENT_TABLE = np.asarray(
+    [
+        ([k for k, (a, b) in enumerate(_CELL_EDGES) if ((code >> a) & 1) != ((code >> b) & 1)] + [0, 0])[:2]
+        for code in range(16)
+    ]
+)
+
+# the corner cut off by a pair of edges (adjacent edges), or c0 for a segment across the cell
+_PAIR_CORNER = np.zeros((4, 4), dtype=np.uint8)
+for (_a, _b), _c in {(0, 1): 1, (1, 2): 2, (2, 3): 3, (0, 3): 0, (0, 2): 0, (1, 3): 0}.items():
+    _PAIR_CORNER[_a, _b] = _PAIR_CORNER[_b, _a] = _c
+
+_CORNER_OFFSET = np.asarray([[0, 0], [1, 0], [1, 1], [0, 1]])
+
+
+def _refine_crossing(spl, level, t, lo, hi, fixed, axis: int, max_iter: int = 8, tol: float = 1.0e-12):
+    """Newton iteration along grid edges:  spl(t, fixed) = level  (axis=0) or spl(fixed, t) = level (axis=1)
+    Only the points that have not converged are iterated; a step leaving the edge is rejected.
+    """
+    t = np.array(t, dtype=float)
+    active = np.arange(t.size)
+    for _ in range(max_iter):
+        if active.size == 0:
+            break
+        ta, fa = t[active], fixed[active]
+        if axis == 0:
+            f = spl(ta, fa, grid=False) - level[active]
+            df = spl(ta, fa, dx=1, grid=False)
+        else:
+            f = spl(fa, ta, grid=False) - level[active]
+            df = spl(fa, ta, dy=1, grid=False)
+        with np.errstate(divide="ignore", invalid="ignore"):
+            t_new = ta - f / df
+        ok = (t_new >= lo[active]) & (t_new <= hi[active])
+        t[active[ok]] = t_new[ok]
+        step = np.abs(t_new - ta)
+        active = active[ok & (step > tol * (1.0 + np.abs(ta)))]
+    return t
+
+
+def marching_squares(
+    z: np.ndarray, levels: typing.Sequence[float], x: np.ndarray = None, y: np.ndarray = None, refine: bool = True
+) -> typing.List[typing.List[np.ndarray]]:
+    """Contours of z[i,j] for all levels in one sweep over the grid.
+
+    Args:
+        x, y  : 1D coordinates of the axes (rectilinear), or 2D arrays of the shape of z (curvilinear).
+                Default: index coordinates.
+        refine: for rectilinear grids, move the crossings from the linear estimate onto the bicubic
+                interpolant of z
+
+    Returns:
+        for every level, a list of polylines [n,2]; closed curves repeat the first point at the end.
+    """
+    z = np.asarray(z, dtype=float)
+    levels = np.atleast_1d(np.asarray(levels, dtype=float))
+    nx, ny = z.shape
+    n_lev = levels.size
+
+    if x is None:
+        x = np.arange(nx, dtype=float)
+    if y is None:
+        y = np.arange(ny, dtype=float)
+    x = np.asarray(x, dtype=float)
+    y = np.asarray(y, dtype=float)
+
+    # 二维坐标若为张量积网格则按直角网格处理
+    if x.ndim == 2 and np.allclose(x, x[:, :1]) and np.allclose(y, y[:1, :]):
+        x, y = x[:, 0], y[0, :]
+
+    rectilinear = x.ndim == 1
+
+    above = z[None, :, :] >= levels[:, None, None]  # [n_lev, nx, ny]
+
+    # crossings on the edges along axis 0 (between (i,j),(i+1,j)) and along axis 1
+    n_e0 = (nx - 1) * ny
+    n_edges = n_e0 + nx * (ny - 1)
+
+    cross0 = above[:, :-1, :] != above[:, 1:, :]
+    cross1 = above[:, :, :-1] != above[:, :, 1:]
+
+    l0, i0, j0 = np.nonzero(cross0)
+    l1, i1, j1 = np.nonzero(cross1)
+
+    with np.errstate(divide="ignore", invalid="ignore"):
+        t0 = (levels[l0] - z[i0, j0]) / (z[i0 + 1, j0] - z[i0, j0])
+        t1 = (levels[l1] - z[i1, j1]) / (z[i1, j1 + 1] - z[i1, j1])
+
+    if rectilinear:
+        px0 = x[i0] + t0 * (x[i0 + 1] - x[i0])
+        py1 = y[j1] + t1 * (y[j1 + 1] - y[j1])
+        if refine and nx > 3 and ny > 3:
+            spl = scipy.interpolate.RectBivariateSpline(x, y, z)
+            px0 = _refine_crossing(spl, levels[l0], px0, x[i0], x[i0 + 1], y[j0], axis=0)
+            py1 = _refine_crossing(spl, levels[l1], py1, y[j1], y[j1 + 1], x[i1], axis=1)
+        p0 = np.stack([px0, y[j0]], axis=-1)
+        p1 = np.stack([x[i1], py1], axis=-1)
+    else:
+        p0 = np.stack([v[i0, j0] + t0 * (v[i0 + 1, j0] - v[i0, j0]) for v in (x, y)], axis=-1)
+        p1 = np.stack([v[i1, j1] + t1 * (v[i1, j1 + 1] - v[i1, j1]) for v in (x, y)], axis=-1)
+
+    points = np.concatenate([p0, p1])
+    node_level = np.concatenate([l0, l1])
+
+    # (level, edge) -> node
+    node = np.full(n_lev * n_edges, -1, dtype=int)
+    node[np.concatenate([l0 * n_edges + i0 * ny + j0, l1 * n_edges + n_e0 + i1 * (ny - 1) + j1])] = np.arange(
+        points.shape[0]
+    )
+
+    # cell cases, bits: c0 | c1<<1 | c2<<2 | c3<<3 ; only cells crossed by a contour are visited
+    code = (
+        above[:, :-1, :-1].astype(np.uint8)
+        | (above[:, 1:, :-1].astype(np.uint8) << 1)
+        | (above[:, 1:, 1:].astype(np.uint8) << 2)
+        | (above[:, :-1, 1:].astype(np.uint8) << 3)
+    )
+    lv, ci, cj = np.nonzero((code != 0) & (code != 15))
+    code = code[lv, ci, cj]
+    base = lv * n_edges
+    ids = np.stack(
+        [
+            base + ci * ny + cj,
+            base + n_e0 + (ci + 1) * (ny - 1) + cj,
+            base + ci * ny + cj + 1,
+            base + n_e0 + ci * (ny - 1) + cj,
+        ],
+        axis=-1,
+    )
+
+    saddle = (code == 5) | (code == 10)
+
+    pair = _SEGMENT_TABLE[code]  # edges (slot in the cell) joined by a segment
+    cell = np.arange(code.size)
+
+    # 鞍点单元：四个交点，由单元中心值判断连接方式
+    if np.any(saddle):
+        sdl = np.flatnonzero(saddle)
+        i, j = ci[sdl], cj[sdl]
+        center = 0.25 * (z[i, j] + z[i + 1, j] + z[i + 1, j + 1] + z[i, j + 1])
+        # 中心与 c0 同侧: c0,c2 连通, 线段绕 c1,c3 : (e0,e1),(e2,e3) ; 否则绕 c0,c2 : (e3,e0),(e1,e2)
+        joined = ((center >= levels[lv[sdl]]) == (code[sdl] & 1).astype(bool))[:, None]
+        pair[sdl] = np.where(joined, [0, 1], [3, 0])
+        pair = np.concatenate([pair, np.where(joined, [2, 3], [1, 2])])
+        cell = np.concatenate([cell, sdl])
+
+    seg = node[np.take_along_axis(ids[cell], pair, axis=-1)]  # [n_seg, 2] node indices
+
+    # orient every segment with the higher values on its left, so that each node has one successor
+    corner = _PAIR_CORNER[pair[:, 0], pair[:, 1]]
+    corner_above = ((code[cell] >> corner) & 1).astype(bool)
+    # crossings on a grid node are moved slightly into the edge, consistent with the "z >= level" classification
+    s0, s1 = np.clip(t0, 1.0e-6, 1.0 - 1.0e-6), np.clip(t1, 1.0e-6, 1.0 - 1.0e-6)
+    uv = np.concatenate([np.stack([i0 + s0, j0], axis=-1), np.stack([i1, j1 + s1], axis=-1)])
+    pa, pb = uv[seg[:, 0]], uv[seg[:, 1]]
+    pc = np.stack([ci[cell] + _CORNER_OFFSET[corner, 0], cj[cell] + _CORNER_OFFSET[corner, 1]], axis=-1)
+    cross = (pb - pa)[:, 0] * (pc - pa)[:, 1] - (pb - pa)[:, 1] * (pc - pa)[:, 0]
+    flip = (cross > 0) != corner_above
+    seg[flip] = seg[flip, ::-1]
+
+    return [[points[c] for c in chains] for chains in _link(seg, points.shape[0], node_level, n_lev)]
+
+
+def _link(seg: np.ndarray, n: int, node_level: np.ndarray, n_lev: int):
+    """Chains of the directed segments, ordered by pointer jumping. Closed chains repeat their first node."""
+    nxt = np.full(n, -1, dtype=int)
+    nxt[seg[:, 0]] = seg[:, 1]
+
+    steps = int(np.ceil(np.log2(max(n, 2)))) + 1
+    idx = np.arange(n)
+
+    # 环：跳跃后仍未到达链尾的节点；以环上最小节点为起点断开
+    ptr, low = nxt.copy(), idx.copy()
+    for _ in range(steps):
+        valid = ptr >= 0
+        q = np.where(valid, ptr, idx)
+        low = np.where(valid, np.minimum(low, low[q]), low)
+        ptr = np.where(valid, ptr[q], ptr)
+    in_cycle = ptr >= 0
+    head = np.flatnonzero(in_cycle & (idx == low))
+    nxt[in_cycle & (nxt == low)] = -1
+
+    # list ranking: distance to the tail of the chain
+    ptr = nxt.copy()
+    rank = (nxt >= 0).astype(int)
+    tail = np.where(nxt >= 0, nxt, idx)
+    for _ in range(steps):
+        valid = ptr >= 0
+        if not np.any(valid):
+            break
+        q = np.where(valid, ptr, idx)
+        rank = np.where(valid, rank + rank[q], rank)
+        tail = np.where(valid, tail[q], tail)
+        ptr = np.where(valid, ptr[q], ptr)
+
+    used = np.zeros(n, dtype=bool)
+    used[seg.ravel()] = True
+    order = np.lexsort((-rank, tail))
+    order = order[used[order]]
+    bounds = np.flatnonzero(np.r_[True, tail[order][1:] != tail[order][:-1], True])
+
+    closed = np.zeros(n, dtype=bool)
+    closed[head] = True
+
+    res = [[] for _ in range(n_lev)]
+    for b, e in zip(bounds[:-1], bounds[1:]):
+        chain = order[b:e]
+        if closed[chain[0]]:
+            chain = np.append(chain, chain[0])
+        res[node_level[chain[0]]].append(chain)
+    return res
+
+
+def find_countours_marching(vals, z: np.ndarray, x: np.ndarray, y: np.ndarray, **kwargs):
+    if not isinstance(vals, (collections.abc.Sequence, np.ndarray)):
+        vals = [vals]
+    elif isinstance(vals, np.ndarray) and vals.ndim == 0:
+        vals = vals.reshape([1])
+
+    contours = marching_squares(z, vals, x, y, **kwargs)
+
+    def _curves(level_contours):
+        for data in level_contours:
+            if data.shape[0] == 1:
+                yield Point(*data[0])
+            else:
+                yield Curve(data)
+
+    for val, level_contours in zip(vals, contours):
+        yield val, _curves(level_contours)
+
+
 def _find_contours(
     *args, values, **kwargs
 ) -> typing.Generator[typing.Tuple[float, typing.Generator[GeoObject | None, None, None]], None, None]:
@@ -88,14 +325,15 @@ def _find_contours(
         if not isinstance(args[0], Field):
             raise TypeError(f"Wrong type of argument! should be Field, got {type(args[0])}")
         f = args[0]
-        xy = f.mesh.points
-        x = xy[0]
-        y = xy[1]
-        z = np.asarray(f)
+        z = np.asarray(f.__array__())
+        if isinstance(f.mesh, CurvilinearMesh):
+            x, y = f.mesh.coordinates
+        else:
+            x, y = f.mesh.dims
     else:
         raise ValueError(f"Wrong number of arguments! should be 1 or 3, got {len(args)}")
 
-    yield from find_countours_skimage(values, z, x, y, **kwargs)
+    yield from find_countours_marching(values, z, x, y, **kwargs)
 
 
 @dataclasses.dataclass
@@ -105,26 +343,140 @@ class OXPoint:
     value: float
 
 
-def find_critical_points(psi: Field) -> typing.Tuple[typing.Sequence[OXPoint], typing.Sequence[OXPoint]]:
-    opoints = []
+# bicubic Hermite patch:  p(u,v) = sum a_ij u^i v^j = U^T (M F M^T) V ,  u,v in [0,1]
+_HERMITE = np.asarray([[1.0, 0.0, 0.0, 0.0], [0.0, 0.0, 1.0, 0.0], [-3.0, 3.0, -2.0, -1.0], [2.0, -2.0, 1.0, 1.0]])
 
-    xpoints = []
 
-    R, Z = psi.mesh.points
-    _R = Variable(0, "R")
-    Bp2 = (psi.pd(0, 1) ** 2 + psi.pd(1, 0) ** 2) / (_R**2)
+class _BicubicPatches:
+    """Bicubic Hermite interpolant of a stack of fields f[n, nx, ny] on the grid (x, y).
+    Nodal derivatives are fourth order finite differences; value, gradient and Hessian are
+    evaluated analytically, vectorized over points of all fields.
+    """
+
+    def __init__(self, f: np.ndarray, x: np.ndarray, y: np.ndarray) -> None:
+        self.x = x
+        self.y = y
+        self.f = f
+        self.fx = stencil(x, 1, 4).apply(f, axis=1)
+        self.fy = stencil(y, 1, 4).apply(f, axis=2)
+        self.fxy = stencil(y, 1, 4).apply(self.fx, axis=2)
+
+    def locate(self, px, py):
+        i = np.clip(np.searchsorted(self.x, px, side="right") - 1, 0, self.x.size - 2)
+        j = np.clip(np.searchsorted(self.y, py, side="right") - 1, 0, self.y.size - 2)
+        return i, j
+
+    def __call__(self, k, px, py):
+        """value, gradient [2], Hessian [2,2] at (px,py) of the field k"""
+        i, j = self.locate(px, py)
+        hx = self.x[i + 1] - self.x[i]
+        hy = self.y[j + 1] - self.y[j]
+        u = (px - self.x[i]) / hx
+        v = (py - self.y[j]) / hy
+
+        def corners(a):
+            return np.stack([a[k, i, j], a[k, i, j + 1], a[k, i + 1, j], a[k, i + 1, j + 1]], axis=-1).reshape(-1, 2, 2)
+
+        F = np.empty((px.size, 4, 4))
+        F[:, :2, :2] = corners(self.f)
+        F[:, :2, 2:] = corners(self.fy) * hy[:, None, None]
+        F[:, 2:, :2] = corners(self.fx) * hx[:, None, None]
+        F[:, 2:, 2:] = corners(self.fxy) * (hx * hy)[:, None, None]
+        a = _HERMITE @ F @ _HERMITE.T  # [m,4,4]
+
+        p = np.arange(4)
+        U = u[:, None] ** p
+        V = v[:, None] ** p
+        dU = np.concatenate([np.zeros((u.size, 1)), p[1:] * u[:, None] ** p[:-1]], axis=-1)
+        dV = np.concatenate([np.zeros((v.size, 1)), p[1:] * v[:, None] ** p[:-1]], axis=-1)
+        d2U = np.concatenate([np.zeros((u.size, 2)), (p[2:] * (p[2:] - 1)) * u[:, None] ** p[:-2]], axis=-1)
+        d2V = np.concatenate([np.zeros((v.size, 2)), (p[2:] * (p[2:] - 1)) * v[:, None] ** p[:-2]], axis=-1)
+
+        def ev(A, B):
+            return np.einsum("mi,mij,mj->m", A, a, B)
+
+        val = ev(U, V)
+        grad = np.stack([ev(dU, V) / hx, ev(U, dV) / hy], axis=-1)
+        hess = np.empty((u.size, 2, 2))
+        hess[:, 0, 0] = ev(d2U, V) / hx**2
+        hess[:, 1, 1] = ev(U, d2V) / hy**2
+        hess[:, 0, 1] = hess[:, 1, 0] = ev(dU, dV) / (hx * hy)
+        return val, grad, hess
+
+
+def critical_points(
+    psi: np.ndarray, r: np.ndarray, z: np.ndarray, tol: float = 1.0e-10, max_iter: int = 30
+) -> typing.List[typing.Tuple[np.ndarray, np.ndarray]]:
+    """O-points and X-points of psi[..., nr, nz], batched over the leading (time slice) axes.
+
+    Candidates are the cells where both components of grad psi change sign; all of them (of all
+    slices) are refined together by Newton iteration on the analytic gradient and Hessian of the
+    bicubic interpolant, and classified by the sign of det(Hessian): > 0 O-point, < 0 X-point.
+
+    Returns:
+        for every slice (leading axes flattened): (opoints [n_o,3], xpoints [n_x,3]), rows are (r, z, psi)
+    """
+    psi = np.asarray(psi, dtype=float)
+    psi = psi.reshape(-1, *psi.shape[-2:])
+    n = psi.shape[0]
+
+    patch = _BicubicPatches(psi, r, z)
+
+    def _sign_change(g):
+        c = np.stack([g[:, :-1, :-1], g[:, 1:, :-1], g[:, :-1, 1:], g[:, 1:, 1:]])
+        return (c.min(axis=0) <= 0) & (c.max(axis=0) >= 0)
+
+    k, i, j = np.nonzero(_sign_change(patch.fx) & _sign_change(patch.fy))
+    px = 0.5 * (r[i] + r[i + 1])
+    py = 0.5 * (z[j] + z[j + 1])
+    step_max = 2.0 * max(np.diff(r).max(), np.diff(z).max())
+
+    active = np.arange(k.size)
+    converged = np.zeros(k.size, dtype=bool)
+    for _ in range(max_iter):
+        if active.size == 0:
+            break
+        _, g, h = patch(k[active], px[active], py[active])
+        det = h[:, 0, 0] * h[:, 1, 1] - h[:, 0, 1] ** 2
+        with np.errstate(divide="ignore", invalid="ignore"):
+            dx = (h[:, 1, 1] * g[:, 0] - h[:, 0, 1] * g[:, 1]) / det
+            dy = (h[:, 0, 0] * g[:, 1] - h[:, 0, 1] * g[:, 0]) / det
+            scale = np.minimum(1.0, step_max / np.hypot(dx, dy))
+        px[active] -= scale * dx
+        py[active] -= scale * dy
+
+        done = np.hypot(dx, dy) < tol * (1.0 + np.hypot(px[active], py[active]))
+        converged[active[done]] = True
+        keep = ~done & np.isfinite(dx) & np.isfinite(dy)
+        keep &= (px[active] >= r[0]) & (px[active] <= r[-1]) & (py[active] >= z[0]) & (py[active] <= z[-1])
+        active = active[keep]
+
+    inside = converged & (px >= r[0]) & (px <= r[-1]) & (py >= z[0]) & (py <= z[-1])
+    k, px, py = k[inside], px[inside], py[inside]
+
+    # 多个候选单元收敛到同一点时去重
+    res_tol = 1.0e-6 * min(np.diff(r).min(), np.diff(z).min())
+    key = np.stack([k, np.round(px / res_tol), np.round(py / res_tol)], axis=-1)
+    _, first = np.unique(key, axis=0, return_index=True)
+    k, px, py = k[first], px[first], py[first]
+
+    val, _, h = patch(k, px, py)
+    det = h[:, 0, 0] * h[:, 1, 1] - h[:, 0, 1] ** 2
+
+    pts = np.stack([px, py, val], axis=-1)
+    return [(pts[(k == s) & (det > 0)], pts[(k == s) & (det < 0)]) for s in range(n)]
+
+
+def find_critical_points(psi: Field) -> typing.Tuple[typing.Sequence[OXPoint], typing.Sequence[OXPoint]]:
+    R, Z = psi.mesh.dims
 
-    D = psi.pd(2, 0) * psi.pd(0, 2) - psi.pd(1, 1) ** 2
+    ((o_pts, x_pts),) = critical_points(psi.__array__(), R, Z)
 
-    for r, x_z in minimize_filter(Bp2, R, Z):
-        p = OXPoint(r, x_z, psi(r, x_z))
+    opoints = [OXPoint(*map(float, p)) for p in o_pts]
 
-        if D(r, x_z) < 0.0:  # saddle/X-point
-            xpoints.append(p)
-        else:  # extremum/ O-point
-            opoints.append(p)
+    xpoints = [OXPoint(*map(float, p)) for p in x_pts]
 
-    Rmid, Zmid = psi.mesh.geometry.bbox.origin + psi.mesh.geometry.bbox.dimensions * 0.5
+    Rmid, Zmid = 0.5 * (R[0] + R[-1]), 0.5 * (Z[0] + Z[-1])
 
     opoints.sort(key=lambda x: (x.r - Rmid) ** 2 + (x.z - Zmid) ** 2)
 
@@ -175,8 +527,6 @@ def find_contours(psirz: Field, psi, axis=None) -> typing.Generator[typing.Tuple
     if axis is None or axis is False:
         for psi_val, surfs in _find_contours(psirz, values=psi):
             for surf in surfs:
-                if isinstance(surf, GeoObject):
-                    surf.set_coordinates("r", "z")
                 yield psi_val, surf
 
     else:
@@ -211,7 +561,6 @@ def find_contours(psirz: Field, psi, axis=None) -> typing.Generator[typing.Tuple
                     # theta_0 = np.arctan2(x_point.r-o_point.r, x_point.z-o_point.z)
                     # theta = ((np.arctan2(_R-o_point.r, _Z-o_point.z)-theta_0)+2.0*scipy.constants.pi) % (2.0*scipy.constants.pi)
                     # surf = surf.remesh(theta)
-                    surf.set_coordinates("r", "z")
                     yield psi_val, surf
                 else:
                     count -= 1
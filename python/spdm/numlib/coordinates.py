@@ -0,0 +1,146 @@
+""" 坐标变换 Coordinate transforms between cylindrical (R, phi, Z), Cartesian (x, y, z)
+and toroidal flux coordinates (rho, theta, phi)
+
+All kernels are vectorized over leading axes, components are on the last axis:
+points / vectors [..., 3], tensors [..., 3, 3], the toroidal angle phi broadcasts with [...].
+
+- cylindrical_to_cartesian / cartesian_to_cylindrical : points
+- cylindrical_basis    : Q = [e_R, e_phi, e_Z] in Cartesian components (columns)
+- cylindrical_jacobian : d(x,y,z)/d(R,phi,Z)
+- vector_* / tensor_*  : components  v_xyz = Q v_RphiZ,  T_xyz = Q T Q^T
+- sweep                : revolve (R, Z) points about the Z axis, or any axis
+- flux_jacobian        : d(R,phi,Z)/d(rho,theta,phi), sqrt(g) and g_ij of a flux coordinate map
+"""
+
+import typing
+
+import numpy as np
+
+from spdm.utils.type_hint import ArrayType
+
+
+def cylindrical_to_cartesian(points: ArrayType) -> ArrayType:
+    """(R, phi, Z) -> (x, y, z)"""
+    points = np.asarray(points, dtype=float)
+    r, phi, z = points[..., 0], points[..., 1], points[..., 2]
+    return np.stack([r * np.cos(phi), r * np.sin(phi), z], axis=-1)
+
+
+def cartesian_to_cylindrical(points: ArrayType) -> ArrayType:
+    """(x, y, z) -> (R, phi, Z), phi in (-pi, pi]"""
+    points = np.asarray(points, dtype=float)
+    x, y, z = points[..., 0], points[..., 1], points[..., 2]
+    return np.stack([np.hypot(x, y), np.arctan2(y, x), z], axis=-1)
+
+
+def cylindrical_basis(phi: ArrayType) -> ArrayType:
+    """Q[..., 3, 3], columns are e_R, e_phi, e_Z at the toroidal angle phi"""
+    phi = np.asarray(phi, dtype=float)
+    c, s = np.cos(phi), np.sin(phi)
+    q = np.zeros(phi.shape + (3, 3))
+    q[..., 0, 0], q[..., 1, 0] = c, s
+    q[..., 0, 1], q[..., 1, 1] = -s, c
+    q[..., 2, 2] = 1.0
+    return q
+
+
+def cylindrical_jacobian(points: ArrayType) -> ArrayType:
+    """d(x,y,z)/d(R,phi,Z) [..., 3, 3] of the points (R, phi, Z), det = R"""
+    points = np.asarray(points, dtype=float)
+    jac = cylindrical_basis(points[..., 1])
+    jac[..., :, 1] *= points[..., 0, None]
+    return jac
+
+
+def vector_to_cartesian(v: ArrayType, phi: ArrayType) -> ArrayType:
+    """(v_R, v_phi, v_Z) at phi -> (v_x, v_y, v_z)"""
+    return np.einsum("...ij,...j->...i", cylindrical_basis(phi), v)
+
+
+def vector_to_cylindrical(v: ArrayType, phi: ArrayType) -> ArrayType:
+    """(v_x, v_y, v_z) -> (v_R, v_phi, v_Z) at phi"""
+    return np.einsum("...ji,...j->...i", cylindrical_basis(phi), v)
+
+
+def tensor_to_cartesian(t: ArrayType, phi: ArrayType) -> ArrayType:
+    """T_xyz = Q T_RphiZ Q^T"""
+    q = cylindrical_basis(phi)
+    return np.einsum("...ik,...kl,...jl->...ij", q, t, q)
+
+
+def tensor_to_cylindrical(t: ArrayType, phi: ArrayType) -> ArrayType:
+    """T_RphiZ = Q^T T_xyz Q"""
+    q = cylindrical_basis(phi)
+    return np.einsum("...ki,...kl,...lj->...ij", q, t, q)
+
+
+def sweep(points: ArrayType, phi: ArrayType, origin: ArrayType = None, direction: ArrayType = None) -> ArrayType:
+    """Revolve points by the angles phi, shape [*points.shape[:-1], *phi.shape, 3]
+
+    points : (R, Z) [..., 2] revolved about the Z axis (phi is the toroidal angle), or
+             (x, y, z) [..., 3] revolved about the axis through origin along direction
+             (Rodrigues' formula, right handed)
+    """
+    points = np.asarray(points, dtype=float)
+    phi = np.asarray(phi, dtype=float)
+    lead = points.shape[:-1]
+    pts = points.reshape(lead + (1,) * phi.ndim + points.shape[-1:])
+
+    if points.shape[-1] == 2:
+        if origin is not None or direction is not None:
+            raise ValueError("(R, Z) points are revolved about the Z axis only")
+        r, z = pts[..., 0], pts[..., 1]
+        return np.stack(np.broadcast_arrays(r * np.cos(phi), r * np.sin(phi), z), axis=-1)
+
+    elif points.shape[-1] != 3:
+        raise ValueError(f"points must be (R,Z) or (x,y,z), not {points.shape}")
+
+    origin = np.zeros(3) if origin is None else np.asarray(origin, dtype=float)
+    k = np.asarray([0.0, 0.0, 1.0] if direction is None else direction, dtype=float)
+    k = k / np.linalg.norm(k)
+    p = pts - origin
+    c, s = np.cos(phi)[..., None], np.sin(phi)[..., None]
+    return origin + p * c + np.cross(k, p) * s + k * (p @ k)[..., None] * (1.0 - c)
+
+
+def _gradient(f: ArrayType, x: ArrayType, axis: int, periodic: bool) -> ArrayType:
+    if not periodic:
+        return np.gradient(f, x, axis=axis, edge_order=2)
+    # 周期方向: 非均匀中心差分, 首尾点相连 (x 不含重复端点)
+    period = 2.0 * np.pi
+    xp = np.r_[x[-1] - period, x, x[0] + period]
+    fp = np.concatenate([np.take(f, [-1], axis), f, np.take(f, [0], axis)], axis=axis)
+    return np.take(np.gradient(fp, xp, axis=axis), np.arange(1, x.size + 1), axis=axis)
+
+
+def flux_jacobian(
+    r: ArrayType, z: ArrayType, rho: ArrayType, theta: ArrayType, periodic: bool = None
+) -> typing.Tuple[ArrayType, ArrayType, ArrayType]:
+    """Jacobian of the map (rho, theta, phi) -> (R, phi, Z) sampled on the grid r[rho, theta], z[rho, theta]
+
+    Returns:
+        jac    : d(R,phi,Z)/d(rho,theta,phi)  [nrho, ntheta, 3, 3]
+        sqrt_g : R * det(jac) = -R (R_rho Z_theta - R_theta Z_rho)
+        g      : covariant metric g_ij = jac^T diag(1, R^2, 1) jac
+    periodic : theta covers [0, 2pi) without the repeated end point, default: detected
+    """
+    r = np.asarray(r, dtype=float)
+    z = np.asarray(z, dtype=float)
+    rho = np.asarray(rho, dtype=float)
+    theta = np.asarray(theta, dtype=float)
+    if periodic is None:
+        span = (theta[-1] - theta[0]) * theta.size / (theta.size - 1)
+        periodic = bool(np.isclose(span, 2.0 * np.pi, rtol=1.0e-6))
+
+    jac = np.zeros(r.shape + (3, 3))
+    jac[..., 0, 0] = np.gradient(r, rho, axis=0, edge_order=2)
+    jac[..., 2, 0] = np.gradient(z, rho, axis=0, edge_order=2)
+    jac[..., 0, 1] = _gradient(r, theta, 1, periodic)
+    jac[..., 2, 1] = _gradient(z, theta, 1, periodic)
+    jac[..., 1, 2] = 1.0
+
+    sqrt_g = r * np.linalg.det(jac)
+    scale = np.ones(r.shape + (3,))
+    scale[..., 1] = r**2
+    g = np.einsum("...ki,...k,...kj->...ij", jac, scale, jac)
+    return jac, sqrt_g, g
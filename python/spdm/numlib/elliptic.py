@@ -0,0 +1,302 @@
+""" 椭圆型方程 Elliptic solvers on rectilinear grids
+
+    "poisson"        :  u_xx + u_yy                  = f
+    "grad_shafranov" :  Δ*psi = psi_RR - psi_R/R + psi_ZZ = f      ( f = -mu0 R J_phi )
+
+Both operators are discretized by second order central differences (non-uniform spacing
+allowed along the first axis) with Dirichlet values on the boundary of the grid.
+
+methods:
+    - "dst"       : DST-I along the second axis (uniform), which decouples the modes; the
+                    tridiagonal systems along the first axis are solved for all modes at once
+    - "multigrid" : geometric multigrid V-cycles, red-black Gauss-Seidel smoothing
+
+Free boundary values are given by the free-space Green's function of the operator,
+summed over the source on the grid (`boundary="free"`).
+"""
+
+import typing
+
+import numpy as np
+import scipy.constants
+import scipy.fft
+import scipy.sparse
+import scipy.sparse.linalg
+from scipy.special import ellipe, ellipk
+
+from spdm.utils.logger import logger
+from spdm.utils.type_hint import ArrayType
+
+MU0 = scipy.constants.mu_0
+
+
+def _coefficients(x: ArrayType, operator: str) -> typing.Tuple[ArrayType, ArrayType, ArrayType]:
+    """Three point stencil (a,b,c) of the first axis part of the operator at the interior points"""
+    h0 = x[1:-1] - x[:-2]
+    h1 = x[2:] - x[1:-1]
+    a = 2.0 / (h0 * (h0 + h1))
+    c = 2.0 / (h1 * (h0 + h1))
+    b = -a - c
+    if operator == "grad_shafranov":
+        # - (1/R) d/dR
+        d0 = -h1 / (h0 * (h0 + h1))
+        d1 = (h1 - h0) / (h0 * h1)
+        d2 = h0 / (h1 * (h0 + h1))
+        r = x[1:-1]
+        a, b, c = a - d0 / r, b - d1 / r, c - d2 / r
+    elif operator != "poisson":
+        raise ValueError(f"Unknown operator {operator}")
+    return a, b, c
+
+
+def _rhs_with_boundary(f: ArrayType, u: ArrayType, a, c, d) -> ArrayType:
+    """interior right hand side with the Dirichlet values moved over"""
+    rhs = np.array(f[1:-1, 1:-1], dtype=float)
+    rhs[0, :] -= a[0] * u[0, 1:-1]
+    rhs[-1, :] -= c[-1] * u[-1, 1:-1]
+    rhs[:, 0] -= d * u[1:-1, 0]
+    rhs[:, -1] -= d * u[1:-1, -1]
+    return rhs
+
+
+def _solve_tridiagonal(a: ArrayType, b: ArrayType, c: ArrayType, rhs: ArrayType) -> ArrayType:
+    """Thomas algorithm for a batch of systems along axis 0.
+    a, c: [n] ;  b, rhs: [n, m]  (m independent diagonals/right hand sides)
+    """
+    n = rhs.shape[0]
+    cp = np.empty_like(b)
+    dp = np.empty_like(rhs)
+    cp[0] = c[0] / b[0]
+    dp[0] = rhs[0] / b[0]
+    for i in range(1, n):
+        m = b[i] - a[i] * cp[i - 1]
+        cp[i] = c[i] / m
+        dp[i] = (rhs[i] - a[i] * dp[i - 1]) / m
+    res = np.empty_like(rhs)
+    res[-1] = dp[-1]
+    for i in range(n - 2, -1, -1):
+        res[i] = dp[i] - cp[i] * res[i + 1]
+    return res
+
+
+def solve_dst(f: ArrayType, u: ArrayType, x: ArrayType, y: ArrayType, operator: str = "poisson") -> ArrayType:
+    """Direct solver, y must be uniform. u holds the boundary values and is overwritten in the interior."""
+    dy = y[1] - y[0]
+    if not np.allclose(np.diff(y), dy, rtol=1.0e-8):
+        raise ValueError("DST solver requires a uniform grid along the second axis")
+
+    a, b, c = _coefficients(x, operator)
+    d = 1.0 / dy**2
+    rhs = _rhs_with_boundary(f, u, a, c, d)
+
+    m = rhs.shape[1]
+    lam = -4.0 * d * np.sin(np.arange(1, m + 1) * np.pi / (2.0 * (m + 1))) ** 2
+
+    rhs_k = scipy.fft.dst(rhs, type=1, axis=1)
+    sol_k = _solve_tridiagonal(np.r_[0.0, a[1:]], b[:, None] + lam[None, :], np.r_[c[:-1], 0.0], rhs_k)
+    u[1:-1, 1:-1] = scipy.fft.idst(sol_k, type=1, axis=1)
+    return u
+
+
+class _Level:
+    def __init__(self, x: ArrayType, y: ArrayType, operator: str) -> None:
+        self.x = x
+        self.y = y
+        a, b, c = _coefficients(x, operator)
+        h0 = y[1:-1] - y[:-2]
+        h1 = y[2:] - y[1:-1]
+        self.a = a[:, None]
+        self.c = c[:, None]
+        self.e = (2.0 / (h0 * (h0 + h1)))[None, :]
+        self.g = (2.0 / (h1 * (h0 + h1)))[None, :]
+        self.diag = b[:, None] - self.e - self.g
+        self._matrix = None
+
+    def apply(self, u: ArrayType) -> ArrayType:
+        """operator at the interior points"""
+        return (
+            self.a * u[:-2, 1:-1]
+            + self.c * u[2:, 1:-1]
+            + self.e * u[1:-1, :-2]
+            + self.g * u[1:-1, 2:]
+            + self.diag * u[1:-1, 1:-1]
+        )
+
+    def residual(self, f: ArrayType, u: ArrayType) -> ArrayType:
+        r = np.zeros_like(u)
+        r[1:-1, 1:-1] = f[1:-1, 1:-1] - self.apply(u)
+        return r
+
+    def smooth(self, f: ArrayType, u: ArrayType, sweeps: int = 2) -> ArrayType:
+        """red-black Gauss-Seidel"""
+        i, j = np.meshgrid(np.arange(1, u.shape[0] - 1), np.arange(1, u.shape[1] - 1), indexing="ij")
+        red = (i + j) % 2 == 0
+        for _ in range(sweeps):
+            for mask in (red, ~red):
+                off = self.apply(u) - self.diag * u[1:-1, 1:-1]
+                inner = u[1:-1, 1:-1]
+                inner[mask] = ((f[1:-1, 1:-1] - off) / self.diag)[mask]
+        return u
+
+    def solve(self, f: ArrayType, u: ArrayType) -> ArrayType:
+        """direct sparse solve on the coarsest level"""
+        nx, ny = u.shape[0] - 2, u.shape[1] - 2
+        if self._matrix is None:
+            a = np.broadcast_to(self.a, (nx, ny)).ravel()
+            c = np.broadcast_to(self.c, (nx, ny)).ravel()
+            e = np.broadcast_to(self.e, (nx, ny)).ravel()
+            g = np.broadcast_to(self.g, (nx, ny)).ravel()
+            diag = np.broadcast_to(self.diag, (nx, ny)).ravel()
+            same_row = np.arange(1, nx * ny) % ny != 0
+            self._matrix = scipy.sparse.diags(
+                [a[ny:], e[1:] * same_row, diag, g[:-1] * same_row, c[:-ny]],
+                [-ny, -1, 0, 1, ny],
+                format="csc",
+            )
+        rhs = f[1:-1, 1:-1] - self.apply(u)
+        u[1:-1, 1:-1] += scipy.sparse.linalg.spsolve(self._matrix, rhs.ravel()).reshape(nx, ny)
+        return u
+
+
+def _restrict(r: ArrayType) -> ArrayType:
+    """full weighting, (2n+1) -> (n+1)"""
+    res = np.zeros(((r.shape[0] + 1) // 2, (r.shape[1] + 1) // 2))
+    res[1:-1, 1:-1] = (
+        4.0 * r[2:-2:2, 2:-2:2]
+        + 2.0 * (r[1:-3:2, 2:-2:2] + r[3:-1:2, 2:-2:2] + r[2:-2:2, 1:-3:2] + r[2:-2:2, 3:-1:2])
+        + (r[1:-3:2, 1:-3:2] + r[3:-1:2, 1:-3:2] + r[1:-3:2, 3:-1:2] + r[3:-1:2, 3:-1:2])
+    ) / 16.0
+    return res
+
+
+def _prolong(e: ArrayType, shape) -> ArrayType:
+    """bilinear, (n+1) -> (2n+1)"""
+    res = np.zeros(shape)
+    res[::2, ::2] = e
+    res[1::2, ::2] = 0.5 * (e[:-1] + e[1:])
+    res[:, 1::2] = 0.5 * (res[:, :-1:2] + res[:, 2::2])
+    return res
+
+
+class Multigrid:
+    """Geometric multigrid V-cycle. Grids are coarsened by 2 while both axes have an odd number of points."""
+
+    def __init__(self, x: ArrayType, y: ArrayType, operator: str = "poisson", min_size: int = 5) -> None:
+        self._levels = [_Level(x, y, operator)]
+        while (x.size - 1) % 2 == 0 and (y.size - 1) % 2 == 0 and min(x.size, y.size) > 2 * min_size:
+            x, y = x[::2], y[::2]
+            self._levels.append(_Level(x, y, operator))
+
+    def _vcycle(self, k: int, f: ArrayType, u: ArrayType) -> ArrayType:
+        level = self._levels[k]
+        if k == len(self._levels) - 1:
+            return level.solve(f, u)
+        level.smooth(f, u)
+        r = _restrict(level.residual(f, u))
+        e = self._vcycle(k + 1, r, np.zeros_like(r))
+        u += _prolong(e, u.shape)
+        return level.smooth(f, u)
+
+    def __call__(self, f: ArrayType, u: ArrayType, tol: float = 1.0e-10, max_iter: int = 50) -> ArrayType:
+        level = self._levels[0]
+        norm = np.linalg.norm(level.residual(f, u)) or 1.0
+        res = 0.0
+        for n in range(max_iter):
+            u = self._vcycle(0, f, u)
+            res = np.linalg.norm(level.residual(f, u)) / norm
+            if res < tol:
+                logger.debug(f"Multigrid: residual={res} after {n+1} cycles")
+                break
+        else:
+            logger.warning(f"Multigrid does not converge: residual={res} after {max_iter} cycles")
+        return u
+
+
+def greens_function(r: ArrayType, z: ArrayType, rc: ArrayType, zc: ArrayType, operator: str = "grad_shafranov"):
+    """Free space Green's function G(r,z; rc,zc)
+
+    grad_shafranov: poloidal flux at (r,z) of a unit toroidal current filament at (rc,zc),
+                    Δ*G = -mu0 r δ(r-rc)δ(z-zc)
+    poisson       : ln(|x-xc|)/(2 pi)
+    """
+    if operator == "poisson":
+        return np.log(np.hypot(r - rc, z - zc)) / (2.0 * np.pi)
+    k2 = 4.0 * r * rc / ((r + rc) ** 2 + (z - zc) ** 2)
+    k2 = np.clip(k2, 1.0e-10, 1.0 - 1.0e-10)
+    k = np.sqrt(k2)
+    return MU0 / (2.0 * np.pi) * np.sqrt(r * rc) * ((2.0 - k2) * ellipk(k2) - 2.0 * ellipe(k2)) / k
+
+
+def free_boundary_values(f: ArrayType, x: ArrayType, y: ArrayType, operator: str = "poisson") -> ArrayType:
+    """Dirichlet values on the grid boundary from the free space Green's function of the source f"""
+    gx, gy = np.meshgrid(x, y, indexing="ij")
+    # 对偶单元的面积, 边界上为半个单元
+    dx, dy = [np.concatenate([[0.5 * (d[1] - d[0])], 0.5 * (d[2:] - d[:-2]), [0.5 * (d[-1] - d[-2])]]) for d in (x, y)]
+    w = np.outer(dx, dy)
+
+    if operator == "grad_shafranov":
+        src = -f / (MU0 * gx) * w  # filament currents  I = J_phi dA
+    else:
+        src = f * w
+
+    edge = np.zeros(gx.shape, dtype=bool)
+    edge[[0, -1], :] = True
+    edge[:, [0, -1]] = True
+
+    # 边界节点是 Dirichlet 节点, 不求解, 其上的源不计入 (否则 G 在源点处奇异)
+    mask = (src != 0.0) & ~edge
+    xs, ys, src = gx[mask], gy[mask], src[mask]
+
+    u = np.zeros(gx.shape)
+    xb, yb = gx[edge], gy[edge]
+    u[edge] = greens_function(xb[:, None], yb[:, None], xs[None, :], ys[None, :], operator=operator) @ src
+    return u
+
+
+def solve_elliptic(
+    mesh,
+    f: ArrayType | typing.Callable[..., ArrayType],
+    boundary: ArrayType | typing.Callable[..., ArrayType] | float | str = 0.0,
+    operator: str = "poisson",
+    method: str = "dst",
+    **kwargs,
+):
+    """Solve  L u = f  on a RectilinearMesh, Dirichlet values on the boundary of the mesh
+
+    Args:
+        f        : source, array of mesh.shape or function of the mesh coordinates
+        boundary : boundary values: array of mesh.shape (only the edge is used), function, scalar,
+                   or "free" (free space Green's function of f)
+        operator : "poisson" or "grad_shafranov"
+        method   : "dst" or "multigrid"
+
+    Returns:
+        Field on mesh
+    """
+    from spdm.core.field import Field
+
+    x, y = mesh.dims
+    coords = mesh.coordinates
+
+    f = np.asarray(f(*coords) if callable(f) else f, dtype=float)
+
+    if isinstance(boundary, str):
+        if boundary != "free":
+            raise ValueError(f"Unknown boundary {boundary}")
+        u = free_boundary_values(f, x, y, operator=operator)
+    elif callable(boundary):
+        u = np.array(boundary(*coords), dtype=float)
+    else:
+        u = np.array(np.broadcast_to(boundary, f.shape), dtype=float)
+
+    u[1:-1, 1:-1] = 0.0
+
+    match method:
+        case "dst":
+            u = solve_dst(f, u, x, y, operator=operator)
+        case "multigrid":
+            u = Multigrid(x, y, operator=operator)(f, u, **kwargs)
+        case _:
+            raise ValueError(f"Unknown method {method}")
+
+    return Field(u, mesh=mesh)
@@ -0,0 +1,404 @@
+""" 磁面 Flux surfaces of psi(R,Z)
+
+Closed flux surfaces are star shaped about the magnetic axis, so every surface is
+traced along rays cast from the O-point.  For all rays at once psi is sampled up to
+the edge of the grid, which brackets the crossing of every requested level; the
+crossings are then refined by safeguarded Newton iteration on the bicubic spline.
+
+    >>> mesh = flux_surface_mesh(psirz, psi_norm=np.linspace(0, 0.99, 64), theta=128, o_point=o_point,
+    ...                          psi_boundary=x_point.value, parameterization="straight_field_line")
+
+poloidal angle (parameterization):
+    - "equal_arc"          : theta proportional to arc length
+    - "straight_field_line": theta* with  d theta*/dl ~ 1/(R|grad psi|)  (PEST)
+    - "polar"              : geometric angle about the O-point
+
+FluxSurfaceAverage caches the surface geometry and Jacobian weights, and averages any
+number of quantities over all surfaces in one contraction.
+"""
+
+import concurrent.futures
+import typing
+
+import numpy as np
+import scipy.constants
+from scipy.interpolate import RectBivariateSpline
+
+from spdm.utils.logger import logger
+from spdm.utils.type_hint import ArrayType
+
+TWOPI = 2.0 * scipy.constants.pi
+
+
+def bicubic(psi, *dims: ArrayType) -> RectBivariateSpline:
+    """Bicubic spline of psi. psi is a Field on a RectilinearMesh, or an array with its dims (R, Z)"""
+    if len(dims) == 0:
+        dims = psi.mesh.dims
+        psi = psi.__array__()
+    return RectBivariateSpline(*dims, np.asarray(psi, dtype=float), kx=3, ky=3)
+
+
+class FluxSurfaceTracer:
+    """Find the points where rays from the O-point cross levels of psi_norm
+
+    Args:
+        psi         : Field, or array psi[R,Z] with dims
+        o_point     : (r, z) or (r, z, psi) of the magnetic axis
+        psi_boundary: psi at the boundary (psi_norm=1), e.g. psi of the X-point
+        n_sample    : number of samples per ray used for bracketing
+    """
+
+    def __init__(self, psi, *dims, o_point=None, psi_boundary: float = None, n_sample: int = None) -> None:
+        if len(dims) == 0:
+            dims = psi.mesh.dims
+
+        self._spl = bicubic(psi, *dims)
+        self._bbox = np.asarray([[d[0], d[-1]] for d in dims], dtype=float)
+
+        if o_point is None:
+            raise ValueError("o_point is required")
+
+        self._r0 = float(o_point[0] if not hasattr(o_point, "r") else o_point.r)
+        self._z0 = float(o_point[1] if not hasattr(o_point, "z") else o_point.z)
+        self._psi_axis = float(self._spl(self._r0, self._z0, grid=False))
+
+        if psi_boundary is None:
+            raise ValueError("psi_boundary is required")
+
+        self._psi_boundary = float(psi_boundary)
+        self._n_sample = n_sample or 2 * max(len(d) for d in dims)
+
+    @property
+    def spline(self) -> RectBivariateSpline:
+        return self._spl
+
+    @property
+    def o_point(self) -> typing.Tuple[float, float]:
+        return self._r0, self._z0
+
+    @property
+    def psi_axis(self) -> float:
+        return self._psi_axis
+
+    @property
+    def psi_boundary(self) -> float:
+        return self._psi_boundary
+
+    def psi_norm(self, r: ArrayType, z: ArrayType) -> ArrayType:
+        return (self._spl(r, z, grid=False) - self._psi_axis) / (self._psi_boundary - self._psi_axis)
+
+    def _ray_length(self, alpha: ArrayType) -> ArrayType:
+        """distance from the O-point to the edge of the grid"""
+        c, s = np.cos(alpha), np.sin(alpha)
+        (rmin, rmax), (zmin, zmax) = self._bbox
+        with np.errstate(divide="ignore"):
+            lr = np.where(c > 0, (rmax - self._r0) / c, np.where(c < 0, (rmin - self._r0) / c, np.inf))
+            lz = np.where(s > 0, (zmax - self._z0) / s, np.where(s < 0, (zmin - self._z0) / s, np.inf))
+        return np.minimum(lr, lz) * (1.0 - 1.0e-10)
+
+    def _newton(self, alpha, level, s, s_lo, s_hi, max_iter: int = 20, tol: float = 1.0e-12):
+        c, sn = np.cos(alpha), np.sin(alpha)
+        scale = 1.0 / (self._psi_boundary - self._psi_axis)
+
+        for _ in range(max_iter):
+            r = self._r0 + s * c
+            z = self._z0 + s * sn
+            f = (self._spl(r, z, grid=False) - self._psi_axis) * scale - level
+            df = (self._spl(r, z, dx=1, grid=False) * c + self._spl(r, z, dy=1, grid=False) * sn) * scale
+
+            # 收紧区间，牛顿步越界时取二分
+            s_lo = np.where(f < 0, s, s_lo)
+            s_hi = np.where(f > 0, s, s_hi)
+
+            with np.errstate(divide="ignore", invalid="ignore"):
+                s_new = s - f / df
+            bad = ~((s_new >= s_lo) & (s_new <= s_hi))
+            s_new = np.where(bad, 0.5 * (s_lo + s_hi), s_new)
+
+            delta = np.abs(s_new - s)
+            s = s_new
+            if np.all(~(delta > tol * (1.0 + np.abs(s)))):
+                break
+
+        return s
+
+    def trace(self, alpha: ArrayType, psi_norm: ArrayType) -> typing.Tuple[ArrayType, ArrayType]:
+        """Crossings of the rays alpha [n_alpha] with the levels psi_norm [n_psi]
+
+        Returns:
+            r, z  : shape [n_psi, n_alpha]; nan where the ray leaves the grid (or the
+                    monotonic part of psi) before reaching the level
+        """
+        alpha = np.asarray(alpha, dtype=float)
+        level = np.asarray(psi_norm, dtype=float)
+
+        # bracketing: psi_norm sampled along every ray, kept up to its first non-monotonic point
+        length = self._ray_length(alpha)
+        t = np.linspace(0.0, 1.0, self._n_sample)
+        s = length[:, None] * t[None, :]
+        pn = self.psi_norm(self._r0 + s * np.cos(alpha)[:, None], self._z0 + s * np.sin(alpha)[:, None])
+        pn[:, 0] = 0.0
+        stop = np.concatenate([np.diff(pn, axis=-1) <= 0, np.ones((alpha.size, 1), dtype=bool)], axis=-1)
+        stop = np.argmax(stop, axis=-1)  # last index of the monotonic part
+        pn = np.where(np.arange(self._n_sample)[None, :] <= stop[:, None], pn, np.inf)
+
+        k = np.sum(pn[:, None, :] <= level[None, :, None], axis=-1) - 1  # [n_alpha, n_psi]
+        found = (k >= 0) & (k < stop[:, None])
+        k = np.clip(k, 0, self._n_sample - 2)
+
+        ray = np.arange(alpha.size)[:, None]
+        s_lo, s_hi = s[ray, k], s[ray, k + 1]
+        p_lo, p_hi = pn[ray, k], pn[ray, k + 1]
+        with np.errstate(invalid="ignore", divide="ignore"):
+            s0 = s_lo + (s_hi - s_lo) * np.clip((level[None, :] - p_lo) / (p_hi - p_lo), 0.0, 1.0)
+
+        aa = np.broadcast_to(alpha[:, None], s0.shape)
+        res = np.where(found, self._newton(aa, level[None, :], np.where(found, s0, 0.0), s_lo, s_hi), np.nan)
+        res = np.where(level[None, :] <= 0.0, 0.0, res).T
+
+        return self._r0 + res * np.cos(alpha), self._z0 + res * np.sin(alpha)
+
+    def refine(self, alpha: ArrayType, psi_norm: ArrayType, s: ArrayType) -> typing.Tuple[ArrayType, ArrayType]:
+        """Newton refinement from the initial distances s; alpha, s shape [n_psi, n]"""
+        level = np.broadcast_to(np.asarray(psi_norm, dtype=float)[:, None], s.shape)
+        inside = level > 0.0
+        s = np.where(inside, self._newton(alpha, level, s, 0.5 * s, 1.5 * s + 1.0e-12), 0.0)
+        return self._r0 + s * np.cos(alpha), self._z0 + s * np.sin(alpha)
+
+
+def _interp_rows(xq: ArrayType, xp: ArrayType, fp: ArrayType) -> ArrayType:
+    """np.interp for each row; xp [n, m] increasing in [0, 2pi], xq [k] or [n, k]"""
+    n = xp.shape[0]
+    shift = 2.0 * TWOPI * np.arange(n)[:, None]
+    xq = np.broadcast_to(xq, (n, np.shape(xq)[-1]))
+    return np.interp((xq + shift).ravel(), (xp + shift).ravel(), fp.ravel()).reshape(xq.shape)
+
+
+def flux_surface_points(
+    tracer: FluxSurfaceTracer,
+    psi_norm: ArrayType,
+    theta: int | ArrayType = 128,
+    parameterization: str = "equal_arc",
+    n_ray: int = None,
+    theta0: float = 0.0,
+) -> typing.Tuple[ArrayType, ArrayType]:
+    """R, Z of the flux surfaces, shape [n_psi, n_theta]
+
+    theta: number of points, or angles in [0, 2pi). theta0 is the direction (about the O-point)
+    of theta=0, default the outboard midplane.
+    """
+    psi_norm = np.asarray(psi_norm, dtype=float)
+
+    if isinstance(theta, int):
+        theta = np.linspace(0, TWOPI, theta, endpoint=False)
+    theta = np.asarray(theta, dtype=float)
+
+    n_ray = n_ray or max(4 * theta.size, 256)
+
+    if parameterization == "polar":
+        alpha = theta + theta0
+        return tracer.trace(alpha, psi_norm)
+
+    alpha = theta0 + np.linspace(0, TWOPI, n_ray + 1)
+    r, z = tracer.trace(alpha[:-1], psi_norm)
+
+    if np.any(np.isnan(r)):
+        bad = psi_norm[np.any(np.isnan(r), axis=-1)]
+        raise RuntimeError(f"Flux surfaces are not closed inside the grid: psi_norm={bad}")
+
+    r = np.concatenate([r, r[:, :1]], axis=-1)
+    z = np.concatenate([z, z[:, :1]], axis=-1)
+
+    dl = np.hypot(np.diff(r, axis=-1), np.diff(z, axis=-1))
+
+    match parameterization:
+        case "equal_arc":
+            w = dl
+        case "straight_field_line":
+            spl = tracer.spline
+            grad = np.hypot(spl(r, z, dx=1, grid=False), spl(r, z, dy=1, grid=False))
+            with np.errstate(divide="ignore"):
+                g = 1.0 / (r * grad)
+            w = 0.5 * (g[:, 1:] + g[:, :-1]) * dl
+        case _:
+            raise ValueError(f"Unknown parameterization {parameterization}")
+
+    c = np.concatenate([np.zeros((psi_norm.size, 1)), np.cumsum(w, axis=-1)], axis=-1)
+    total = c[:, -1:]
+    with np.errstate(divide="ignore", invalid="ignore"):
+        theta_of_alpha = np.where(total > 0, TWOPI * c / total, alpha[None, :] - theta0)
+
+    # angle of the rays at the requested theta, then back onto the surface
+    alpha_t = _interp_rows(theta, theta_of_alpha, np.broadcast_to(alpha, c.shape))
+    s = np.hypot(r - tracer.o_point[0], z - tracer.o_point[1])
+    s_t = _interp_rows(alpha_t - theta0, np.broadcast_to(alpha - theta0, c.shape), s)
+
+    return tracer.refine(alpha_t, psi_norm, s_t)
+
+
+def flux_surface_mesh(
+    psi,
+    *dims,
+    psi_norm: ArrayType,
+    theta: int | ArrayType = 128,
+    o_point=None,
+    psi_boundary: float = None,
+    parameterization: str = "equal_arc",
+    workers: int = None,
+    **kwargs,
+):
+    """Flux aligned CurvilinearMesh on (psi_norm, theta)
+
+    Args:
+        psi     : Field, or array psi[R,Z] with dims
+        workers : number of threads; the surfaces are split into chunks traced concurrently
+    """
+    from spdm.mesh.mesh_curvilinear import CurvilinearMesh
+
+    tracer = FluxSurfaceTracer(psi, *dims, o_point=o_point, psi_boundary=psi_boundary)
+
+    psi_norm = np.asarray(psi_norm, dtype=float)
+    if isinstance(theta, int):
+        theta = np.linspace(0, TWOPI, theta, endpoint=False)
+
+    if workers is None or workers <= 1 or psi_norm.size < 2 * workers:
+        r, z = flux_surface_points(tracer, psi_norm, theta, parameterization=parameterization, **kwargs)
+    else:
+        chunks = np.array_split(psi_norm, workers)
+        with concurrent.futures.ThreadPoolExecutor(max_workers=workers) as executor:
+            res = list(
+                executor.map(
+                    lambda p: flux_surface_points(tracer, p, theta, parameterization=parameterization, **kwargs),
+                    chunks,
+                )
+            )
+        r = np.concatenate([v[0] for v in res])
+        z = np.concatenate([v[1] for v in res])
+
+    logger.debug(f"Flux surface mesh: {psi_norm.size} x {np.size(theta)} ({parameterization})")
+
+    return CurvilinearMesh(psi_norm, theta, points=np.stack([r, z], axis=-1), periods=[0, TWOPI])
+
+
+class FluxSurfaceAverage:
+    """Flux surface average  <f> = ∮ f dl/Bp / ∮ dl/Bp ,  Bp = |grad psi|/R
+
+    The surfaces are traced once and sampled at n_theta points uniform in a smooth periodic angle,
+    so the contour integrals are trapezoidal sums with spectral accuracy; dl/dtheta is taken
+    from the FFT derivative of R(theta), Z(theta). The Jacobian weights are cached and reused for
+    every quantity.
+
+        >>> fsa = FluxSurfaceAverage(psirz, psi_norm=psi_norm, o_point=o_point, psi_boundary=x_point.value)
+        >>> gm1, gm2 = fsa(lambda r, z: 1.0 / r**2, lambda r, z: fsa.grad_psi2 / r**2)
+    """
+
+    def __init__(
+        self,
+        psi,
+        *dims,
+        psi_norm: ArrayType,
+        o_point=None,
+        psi_boundary: float = None,
+        n_theta: int = 128,
+        parameterization: str = "polar",
+    ) -> None:
+        tracer = (
+            psi
+            if isinstance(psi, FluxSurfaceTracer)
+            else FluxSurfaceTracer(psi, *dims, o_point=o_point, psi_boundary=psi_boundary)
+        )
+        self._tracer = tracer
+        self._psi_norm = np.asarray(psi_norm, dtype=float)
+
+        theta = np.linspace(0, TWOPI, n_theta, endpoint=False)
+        r, z = flux_surface_points(tracer, self._psi_norm, theta, parameterization=parameterization)
+        self._r = r
+        self._z = z
+
+        spl = tracer.spline
+        self._grad_psi2 = spl(r, z, dx=1, grid=False) ** 2 + spl(r, z, dy=1, grid=False) ** 2
+
+        # |d(R,Z)/dtheta| by spectral differentiation
+        k = np.fft.rfftfreq(n_theta, 1.0 / n_theta) * 1j
+        dr = np.fft.irfft(k * np.fft.rfft(r, axis=-1), n=n_theta, axis=-1)
+        dz = np.fft.irfft(k * np.fft.rfft(z, axis=-1), n=n_theta, axis=-1)
+        dl = np.hypot(dr, dz) * (TWOPI / n_theta)
+
+        self._dl = dl
+        self._dz = dz * (TWOPI / n_theta)
+
+        # dl/Bp
+        axis = self._psi_norm <= 0.0
+        with np.errstate(divide="ignore", invalid="ignore"):
+            jac = np.where(axis[:, None], 0.0, dl * r / np.sqrt(self._grad_psi2))
+        self._jacobian = jac
+        norm = jac.sum(axis=-1, keepdims=True)
+        with np.errstate(divide="ignore", invalid="ignore"):
+            # 磁轴上取极限：平均值为磁轴处的值
+            self._weights = np.where(axis[:, None], 1.0 / n_theta, jac / norm)
+
+        self._dvolume_dpsi = TWOPI * norm[:, 0]
+        if np.any(axis):
+            # 磁轴附近 psi-psi_axis ≈ x^T H x/2 ，dV/dpsi = 4 pi^2 R0 / sqrt(det H)
+            r0, z0 = tracer.o_point
+            det = (
+                spl(r0, z0, dx=2, grid=False) * spl(r0, z0, dy=2, grid=False) - spl(r0, z0, dx=1, dy=1, grid=False) ** 2
+            )
+            self._dvolume_dpsi[axis] = TWOPI * TWOPI * r0 / np.sqrt(abs(det))
+
+    @property
+    def psi_norm(self) -> ArrayType:
+        return self._psi_norm
+
+    @property
+    def points(self) -> typing.Tuple[ArrayType, ArrayType]:
+        """R, Z on the surfaces [n_psi, n_theta]"""
+        return self._r, self._z
+
+    @property
+    def grad_psi2(self) -> ArrayType:
+        """|grad psi|^2 on the surfaces [n_psi, n_theta]"""
+        return self._grad_psi2
+
+    @property
+    def weights(self) -> ArrayType:
+        """normalized averaging weights [n_psi, n_theta]"""
+        return self._weights
+
+    @property
+    def dvolume_dpsi(self) -> ArrayType:
+        """dV/dpsi = ∮ 2 pi R dl/|grad psi|"""
+        return self._dvolume_dpsi
+
+    @property
+    def area(self) -> ArrayType:
+        """poloidal cross section enclosed by the surfaces,  |∮ R dZ|"""
+        return np.abs(np.sum(self._r * self._dz, axis=-1))
+
+    @property
+    def volume(self) -> ArrayType:
+        """volume enclosed by the surfaces,  |∮ pi R^2 dZ|"""
+        return np.abs(np.pi * np.sum(self._r**2 * self._dz, axis=-1))
+
+    @property
+    def surface_area(self) -> ArrayType:
+        """area of the toroidal surfaces,  ∮ 2 pi R dl"""
+        return TWOPI * np.sum(self._r * self._dl, axis=-1)
+
+    def average(self, *funcs) -> ArrayType:
+        """<f> for each f: a function of (R, Z) or an array of the shape of `points` [n_psi, n_theta]
+
+        Returns:
+            [n_psi] for one quantity, [n_quantity, n_psi] for several
+        """
+        values = np.stack(
+            [
+                np.broadcast_to(f(self._r, self._z) if callable(f) else np.asarray(f, dtype=float), self._r.shape)
+                for f in funcs
+            ]
+        )
+        res = np.einsum("qij,ij->qi", values, self._weights)
+        return res[0] if len(funcs) == 1 else res
+
+    def __call__(self, *funcs) -> ArrayType:
+        return self.average(*funcs)
@@ -0,0 +1,307 @@
+""" 视线积分 Line of sight integrals for synthetic diagnostics
+
+Chords are straight lines  origin + t * (end - origin),  t in [0,1]  (or t >= 0 for rays
+given by a direction). They are clipped against the bounding box of the mesh and the wall;
+then
+
+- on a RectilinearMesh the chords are split at their exact crossings with the grid lines,
+  inside every cell the bilinear interpolant is a quadratic in t, so Simpson's rule per
+  piece is exact. The result is a sparse geometry matrix G [n_chord, n_node]:
+        signal = G @ values.ravel()
+- for any other field (callable of the coordinates) the sample points are chosen by
+  vectorized adaptive Simpson refinement, then fixed; the result is a sparse matrix
+  W [n_chord, n_sample] and every later time slice costs one evaluation and one SpMV.
+
+    >>> los = LineOfSight(origin, end, wall=wall_points)
+    >>> signal = los(ne)                          # Field on a RectilinearMesh, G is cached
+"""
+
+import typing
+
+import numpy as np
+import scipy.sparse
+
+from spdm.utils.logger import logger
+from spdm.utils.type_hint import ArrayType
+from spdm.numlib.spatial import polygon_index, segment_index
+
+
+def clip_box(
+    origin: ArrayType, direction: ArrayType, t0: ArrayType, t1: ArrayType, lo: ArrayType, hi: ArrayType
+) -> typing.Tuple[ArrayType, ArrayType]:
+    """Clip the parameter range [t0,t1] of the lines origin + t*direction to the box [lo,hi] (slab test)"""
+    parallel = direction == 0.0
+    inside = (origin >= lo) & (origin <= hi)
+    with np.errstate(divide="ignore", invalid="ignore"):
+        ta = (lo - origin) / direction
+        tb = (hi - origin) / direction
+    near = np.where(parallel, np.where(inside, -np.inf, np.inf), np.minimum(ta, tb)).max(axis=-1)
+    far = np.where(parallel, np.where(inside, np.inf, -np.inf), np.maximum(ta, tb)).min(axis=-1)
+    return np.maximum(t0, near), np.minimum(t1, far)
+
+
+def clip_wall(
+    origin: ArrayType, direction: ArrayType, t0: ArrayType, t1: ArrayType, wall: ArrayType
+) -> typing.Tuple[ArrayType, ArrayType]:
+    """Clip [t0,t1] to the part of the lines inside the closed wall polyline
+
+    The chord starts at the first point inside the wall, and ends at the next crossing.
+    """
+    index = segment_index(wall, closed=True)
+    start = origin + np.where(np.isfinite(t0), t0, 0.0)[:, None] * direction
+    inside = polygon_index(wall)(start)
+
+    ray, t, _ = index.hits(origin, direction, t0, t1)
+    n = origin.shape[0]
+
+    # 起点在壁外: 第一个交点进入, 第二个交点离开; 起点在壁内: 第一个交点离开
+    first = np.flatnonzero(np.r_[True, ray[1:] != ray[:-1]]) if ray.size > 0 else np.zeros(0, dtype=int)
+    count = np.diff(np.r_[first, ray.size])
+    t_first = np.full(n, np.nan)
+    t_second = np.full(n, np.nan)
+    t_first[ray[first]] = t[first]
+    two = count > 1
+    t_second[ray[first[two]]] = t[first[two] + 1]
+
+    a = np.where(inside, t0, t_first)
+    b = np.where(inside, np.where(np.isnan(t_first), t1, t_first), t_second)
+    a = np.where(np.isnan(a), 0.0, a)
+    b = np.where(np.isnan(b), a, b)
+    return a, np.minimum(b, t1)
+
+
+def _bilinear(dims: typing.Sequence[ArrayType], x: ArrayType, y: ArrayType, ix: ArrayType, iy: ArrayType):
+    """bilinear weights of the points (x,y) in the cells (ix,iy): node indices [n,4], weights [n,4]"""
+    gx, gy = dims
+    sx = (x - gx[ix]) / (gx[ix + 1] - gx[ix])
+    sy = (y - gy[iy]) / (gy[iy + 1] - gy[iy])
+    ny = gy.size
+    node = np.stack([ix * ny + iy, (ix + 1) * ny + iy, ix * ny + iy + 1, (ix + 1) * ny + iy + 1], axis=-1)
+    weight = np.stack([(1 - sx) * (1 - sy), sx * (1 - sy), (1 - sx) * sy, sx * sy], axis=-1)
+    return node, weight
+
+
+def geometry_matrix(
+    origin: ArrayType, direction: ArrayType, t0: ArrayType, t1: ArrayType, dims: typing.Sequence[ArrayType]
+) -> scipy.sparse.csr_matrix:
+    """Sparse matrix G[n_chord, nx*ny] of the line integrals of the bilinear interpolant on the grid dims,
+    the chords are split at their exact crossings with the grid lines"""
+    gx, gy = [np.asarray(d, dtype=float) for d in dims]
+    n = origin.shape[0]
+    ok = t1 > t0
+    t0 = np.where(ok, t0, 0.0)
+    t1 = np.where(ok, t1, 0.0)
+
+    chords = [np.arange(n), np.arange(n)]
+    params = [t0, t1]
+    for axis, g in enumerate((gx, gy)):
+        a = origin[:, axis] + t0 * direction[:, axis]
+        b = origin[:, axis] + t1 * direction[:, axis]
+        lo = np.searchsorted(g, np.minimum(a, b), side="right")
+        hi = np.searchsorted(g, np.maximum(a, b), side="left")
+        count = np.where(ok & (direction[:, axis] != 0.0), np.maximum(hi - lo, 0), 0)
+        c = np.repeat(np.arange(n), count)
+        k = np.repeat(lo, count) + np.arange(count.sum()) - np.repeat(np.cumsum(count) - count, count)
+        chords.append(c)
+        params.append((g[k] - origin[c, axis]) / direction[c, axis])
+
+    chord = np.concatenate(chords)
+    t = np.concatenate(params)
+    order = np.lexsort((t, chord))
+    chord, t = chord[order], t[order]
+
+    # 相邻交点之间的片段, 每段在一个网格单元内
+    same = (chord[1:] == chord[:-1]) & (t[1:] > t[:-1])
+    c, ta, tb = chord[:-1][same], t[:-1][same], t[1:][same]
+    tm = 0.5 * (ta + tb)
+    xm = origin[c] + tm[:, None] * direction[c]
+    ix = np.clip(np.searchsorted(gx, xm[:, 0], side="right") - 1, 0, gx.size - 2)
+    iy = np.clip(np.searchsorted(gy, xm[:, 1], side="right") - 1, 0, gy.size - 2)
+
+    length = (tb - ta) * np.linalg.norm(direction[c], axis=-1)
+    rows, cols, vals = [], [], []
+    for s, w in ((ta, 1.0 / 6.0), (tm, 4.0 / 6.0), (tb, 1.0 / 6.0)):
+        p = origin[c] + s[:, None] * direction[c]
+        node, weight = _bilinear((gx, gy), p[:, 0], p[:, 1], ix, iy)
+        rows.append(np.repeat(c, 4))
+        cols.append(node.ravel())
+        vals.append((weight * (w * length)[:, None]).ravel())
+
+    return scipy.sparse.csr_matrix(
+        (np.concatenate(vals), (np.concatenate(rows), np.concatenate(cols))), shape=(n, gx.size * gy.size)
+    )
+
+
+def adaptive_samples(
+    func: typing.Callable[..., ArrayType],
+    origin: ArrayType,
+    direction: ArrayType,
+    t0: ArrayType,
+    t1: ArrayType,
+    n_init: int = 8,
+    rtol: float = 1.0e-4,
+    atol: float = 0.0,
+    max_level: int = 12,
+) -> typing.Tuple[ArrayType, scipy.sparse.csr_matrix]:
+    """Sample points and quadrature matrix W[n_chord, n_sample] by adaptive Simpson refinement of func
+
+    All the intervals of all the chords are refined together, an interval is split while the
+    difference between the Simpson rule on it and on its halves exceeds atol + rtol*|∫ chord|.
+    """
+    n = origin.shape[0]
+    ok = t1 > t0
+    speed = np.linalg.norm(direction, axis=-1)
+
+    chord = np.repeat(np.flatnonzero(ok), n_init)
+    k = np.tile(np.arange(n_init), int(ok.sum()))
+    h = (t1[chord] - t0[chord]) / n_init
+    a = t0[chord] + k * h
+
+    def _eval(c, t):
+        p = origin[c] + t[:, None] * direction[c]
+        return np.asarray(func(p[:, 0], p[:, 1]), dtype=float)
+
+    def _simpson(f, h):
+        s1 = h / 6 * (f[:, 0] + 4 * f[:, 2] + f[:, 4])
+        s2 = h / 12 * (f[:, 0] + 4 * f[:, 1] + 2 * f[:, 2] + 4 * f[:, 3] + f[:, 4])
+        return s1, s2
+
+    frac = np.linspace(0.0, 1.0, 5)
+    done_c, done_a, done_h = [], [], []
+    for level in range(max_level + 1):
+        f = _eval(np.repeat(chord, 5), (a[:, None] + h[:, None] * frac).ravel()).reshape(-1, 5)
+        s1, s2 = _simpson(f, h * speed[chord])
+        if level == 0:
+            scale = np.abs(np.bincount(chord, weights=s2, minlength=n))  # 初始估计的弦积分
+        err = np.abs(s2 - s1) / 15.0
+        good = (err <= atol + rtol * scale[chord]) | (level == max_level)
+        done_c.append(chord[good])
+        done_a.append(a[good])
+        done_h.append(h[good])
+        if np.all(good):
+            break
+        chord, a, h = chord[~good], a[~good], h[~good]
+        chord, a, h = np.repeat(chord, 2), np.stack([a, a + 0.5 * h], axis=-1).ravel(), np.repeat(0.5 * h, 2)
+    else:
+        logger.warning(f"Adaptive sampling does not converge after {max_level} levels")
+
+    chord, a, h = np.concatenate(done_c), np.concatenate(done_a), np.concatenate(done_h)
+    t = (a[:, None] + h[:, None] * frac).ravel()
+    c = np.repeat(chord, 5)
+    w = ((h * speed[chord])[:, None] * np.asarray([1, 4, 2, 4, 1]) / 12.0).ravel()
+    points = origin[c] + t[:, None] * direction[c]
+    return points, scipy.sparse.csr_matrix((w, (c, np.arange(c.size))), shape=(n, c.size))
+
+
+class LineOfSight:
+    """Line integrals along a batch of chords
+
+    Args:
+        origin    : [n,2] start points of the chords
+        end       : [n,2] end points, the chord is origin -> end
+        direction : [n,2] instead of end, the chord is the ray origin + t*direction, t>=0
+        bbox      : (lo, hi) box to clip to, default: the bounding box of the mesh of the field
+        wall      : closed wall polyline [m,2]; the chords are clipped to its inside
+    """
+
+    def __init__(
+        self,
+        origin: ArrayType,
+        end: ArrayType = None,
+        direction: ArrayType = None,
+        bbox: typing.Tuple[ArrayType, ArrayType] = None,
+        wall: ArrayType = None,
+    ) -> None:
+        origin = np.atleast_2d(np.asarray(origin, dtype=float))
+        if end is not None:
+            direction = np.atleast_2d(np.asarray(end, dtype=float)) - origin
+            t1 = np.ones(origin.shape[0])
+        elif direction is not None:
+            direction = np.atleast_2d(np.asarray(direction, dtype=float))
+            t1 = np.full(origin.shape[0], np.inf)
+        else:
+            raise ValueError("Either end or direction is required!")
+
+        self._origin, self._direction = np.broadcast_arrays(origin, direction)
+        self._t0 = np.zeros(self._origin.shape[0])
+        self._t1 = t1
+        self._bbox = bbox
+        self._wall = None if wall is None else np.asarray(getattr(wall, "points", wall), dtype=float)
+        self._cache = {}
+
+    @property
+    def size(self) -> int:
+        return self._origin.shape[0]
+
+    def clip(self, lo: ArrayType = None, hi: ArrayType = None) -> typing.Tuple[ArrayType, ArrayType]:
+        """parameter range [t0,t1] of every chord after clipping to the box [lo,hi] and the wall"""
+        if lo is None:
+            lo, hi = self._bbox if self._bbox is not None else (np.full(2, -np.inf), np.full(2, np.inf))
+        lo, hi = np.asarray(lo, dtype=float), np.asarray(hi, dtype=float)
+        key = ("clip", lo.tobytes(), hi.tobytes())
+        if key not in self._cache:
+            t0, t1 = clip_box(self._origin, self._direction, self._t0, self._t1, lo, hi)
+            if self._wall is not None:
+                t0, t1 = clip_wall(self._origin, self._direction, t0, t1, self._wall)
+            t1 = np.where(np.isfinite(t1), t1, t0)  # 未被截断的射线长度记为零
+            self._cache[key] = t0, np.maximum(t1, t0)
+        return self._cache[key]
+
+    def endpoints(self, lo: ArrayType = None, hi: ArrayType = None) -> typing.Tuple[ArrayType, ArrayType]:
+        """first and last point of every clipped chord"""
+        t0, t1 = self.clip(lo, hi)
+        return self._origin + t0[:, None] * self._direction, self._origin + t1[:, None] * self._direction
+
+    def length(self, lo: ArrayType = None, hi: ArrayType = None) -> ArrayType:
+        t0, t1 = self.clip(lo, hi)
+        return (t1 - t0) * np.linalg.norm(self._direction, axis=-1)
+
+    def geometry_matrix(self, *dims: ArrayType) -> scipy.sparse.csr_matrix:
+        """G[n_chord, nx*ny] on the rectilinear grid dims, signal = G @ values.ravel()"""
+        key = ("G", *[np.ascontiguousarray(d, dtype=float).tobytes() for d in dims])
+        if key not in self._cache:
+            lo = [np.min(d) for d in dims] if self._bbox is None else self._bbox[0]
+            hi = [np.max(d) for d in dims] if self._bbox is None else self._bbox[1]
+            lo = np.maximum(lo, [np.min(d) for d in dims])
+            hi = np.minimum(hi, [np.max(d) for d in dims])
+            self._cache[key] = geometry_matrix(self._origin, self._direction, *self.clip(lo, hi), dims)
+        return self._cache[key]
+
+    def samples(self, func: typing.Callable[..., ArrayType], key=None, **kwargs):
+        """adaptive sample points [n_sample,2] and quadrature matrix W[n_chord,n_sample] for func,
+        cached under key (e.g. the fingerprint of the mesh) and the options of adaptive_samples"""
+        key = ("W", key, tuple(sorted(kwargs.items())))
+        if key[1] is None or key not in self._cache:
+            res = adaptive_samples(func, self._origin, self._direction, *self.clip(), **kwargs)
+            if key[1] is None:
+                return res
+            self._cache[key] = res
+        return self._cache[key]
+
+    def __call__(self, field, **kwargs) -> ArrayType:
+        """∫ field dl along every chord
+
+        field: Field on a RectilinearMesh (exact cell crossings, geometry matrix), or any callable of (x,y)
+               (adaptive samples, e.g. a Field on a CurvilinearMesh)
+
+        The adaptive samples of a field with a mesh are cached by the mesh fingerprint, so they
+        adapt to the first field (time slice) on that mesh only, later fields reuse them.
+        """
+        from spdm.mesh.mesh_rectilinear import RectilinearMesh
+
+        mesh = getattr(field, "mesh", None)
+        # CurvilinearMesh 的 dims 是逻辑坐标, 不是单元边界
+        if isinstance(mesh, RectilinearMesh) and mesh.is_tensor_grid:
+            value = np.asarray(field, dtype=float)
+            return self.geometry_matrix(*mesh.dims) @ value.reshape(-1, *value.shape[len(mesh.dims) :])
+
+        if not callable(field):
+            raise TypeError(f"Illegal field {type(field)}")
+        key = getattr(mesh, "fingerprint", None) if mesh is not None else None
+        points, weights = self.samples(field, key=key, **kwargs)
+        return weights @ np.asarray(field(points[:, 0], points[:, 1]), dtype=float)
+
+
+def line_integral(field, origin: ArrayType, end: ArrayType, wall: ArrayType = None, **kwargs) -> ArrayType:
+    """∫ field dl along the chords origin -> end"""
+    return LineOfSight(origin, end, wall=wall)(field, **kwargs)
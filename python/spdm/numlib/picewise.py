@@ -1,4 +1,3 @@
-
 import warnings
 import typing
 from copy import copy, deepcopy
@@ -12,6 +11,7 @@ from spdm.utils.type_hint import ArrayType, NumericType, array_type, as_array, i
 from spdm.utils.logger import logger
 from spdm.utils.misc import group_dict_by_prefix
 from spdm.numlib.interpolate import interpolate
+from spdm.numlib.polynomial import clenshaw
 
 from spdm.core.functor import Functor
 from spdm.core.entry import Entry
@@ -21,18 +21,162 @@ from spdm.core.path import update_tree, Path
 from spdm.core.functor import Functor, DerivativeOp
 from spdm.core.expression import Expression
 
+
+_NUMPY_KIND = {
+    "Polynomial": "power",
+    "Chebyshev": "chebyshev",
+    "Legendre": "legendre",
+    "Hermite": "hermite",
+    "HermiteE": "hermite_e",
+    "Laguerre": "laguerre",
+}
+
+
+def _series(func) -> typing.Tuple[str, ArrayType, float, float] | None:
+    """(kind, coefficients, off, scl) of a constant or polynomial branch, None otherwise
+
+    value = Σ c_k P_k(off + scl * x), the branch keeps its own basis and domain -> window map
+    (converting to power series in x is ill-conditioned away from the origin)
+    """
+    from numpy.polynomial._polybase import ABCPolyBase
+
+    if isinstance(func, (int, float, np.integer, np.floating)):
+        return "power", np.asarray([float(func)]), 0.0, 1.0
+    elif isinstance(func, ABCPolyBase):
+        kind = next((_NUMPY_KIND[c.__name__] for c in type(func).__mro__ if c.__name__ in _NUMPY_KIND), None)
+        if kind is None:
+            return None
+        off, scl = func.mapparms()
+        return kind, np.asarray(func.coef, dtype=float), float(off), float(scl)
+    elif hasattr(func, "coeff") and hasattr(func, "kind"):
+        # numlib.polynomial.Polynomials with a single series
+        from spdm.numlib import polynomial
+
+        if func.coeff.ndim != 1 or func._preprocess is not None or func._postprocess is not None:
+            return None
+        off, scl = polynomial._mapping(func.kind, func._interval, func._window)
+        return func.kind, np.asarray(func.coeff, dtype=float), float(off), float(scl)
+    return None
+
+
+class PiecewiseIntervals:
+    """Evaluation engine of a 1D piecewise function on sorted breakpoints
+
+    Every point is classified once by a sorted breakpoint search, then every branch is
+    evaluated only on its own points. Constant and polynomial branches are gathered in one
+    coefficient table (in their own basis and window) and evaluated together by the Clenshaw
+    recurrence, one pass per basis instead of one per branch.
+
+    Args:
+        funcs       : n branches, callables, constants or polynomials
+        breakpoints : n-1 inner breakpoints (the outer branches extend to infinity), or
+                      n+1 breakpoints (points outside [b_0, b_n] get `fill_value`)
+        right       : if True intervals are (b_{i-1}, b_i], else [b_{i-1}, b_i)
+    """
+
+    def __init__(self, funcs: typing.Sequence, breakpoints: ArrayType, right: bool = False, fill_value=np.nan):
+        breakpoints = np.asarray(breakpoints, dtype=float)
+        if np.any(np.diff(breakpoints) < 0):
+            raise ValueError(f"breakpoints must be sorted! {breakpoints}")
+
+        n = len(funcs)
+        if breakpoints.size == n - 1:
+            self._bounded = False
+        elif breakpoints.size == n + 1:
+            self._bounded = True
+        else:
+            raise ValueError(f"{n} branches need {n-1} or {n+1} breakpoints, not {breakpoints.size}")
+
+        self._funcs = list(funcs)
+        self._breakpoints = breakpoints
+        self._side = "left" if right else "right"
+        self._fill_value = fill_value
+
+        series = [_series(f) for f in self._funcs]
+        self._poly = np.asarray([c is not None for c in series])
+        self._kinds = sorted({c[0] for c in series if c is not None})
+        self._kind = np.full(n, -1)
+        deg = max([c[1].size for c in series if c is not None], default=1)
+        self._coeff = np.zeros((n, deg))
+        self._mapping = np.tile([0.0, 1.0], (n, 1))
+        for i, c in enumerate(series):
+            if c is not None:
+                kind, coeff, off, scl = c
+                self._kind[i] = self._kinds.index(kind)
+                self._coeff[i, : coeff.size] = coeff
+                self._mapping[i] = off, scl
+
+    @property
+    def breakpoints(self) -> ArrayType:
+        return self._breakpoints
+
+    def classify(self, x: ArrayType) -> ArrayType:
+        """branch index of every point, -1 outside"""
+        idx = np.searchsorted(self._breakpoints, x, side=self._side)
+        if self._bounded:
+            idx = idx - 1
+            idx[(idx < 0) | (idx >= len(self._funcs))] = -1
+        return idx
+
+    def __call__(self, x: ArrayType | float, *args, **kwargs) -> ArrayType | float:
+        scalar = not isinstance(x, array_type)
+        x = np.asarray(x, dtype=float)
+        shape = x.shape
+        x = x.ravel()
+        idx = self.classify(x)
+        res = np.full(x.shape, self._fill_value, dtype=float)
+
+        inside = idx >= 0
+        fast = np.zeros_like(inside)
+        fast[inside] = self._poly[idx[inside]]
+        if np.any(fast):
+            b = idx[fast]
+            t = self._mapping[b, 0] + self._mapping[b, 1] * x[fast]
+            val = np.empty(t.shape)
+            for i, kind in enumerate(self._kinds):
+                sel = self._kind[b] == i
+                if np.any(sel):
+                    val[sel] = clenshaw(self._coeff[b[sel]].T, t[sel], kind, tensor=False)
+            res[fast] = val
+
+        slow = np.flatnonzero(inside & ~fast)
+        if slow.size > 0:
+            # 按分支排序后分组, 每个分支只在自己的点上计算一次
+            order = slow[np.argsort(idx[slow], kind="stable")]
+            branch, start = np.unique(idx[order], return_index=True)
+            for b, sel in zip(branch, np.split(order, start[1:])):
+                _args = [(a.ravel()[sel] if isinstance(a, array_type) and a.size == x.size else a) for a in args]
+                res[sel] = self._funcs[b](x[sel], *_args, **kwargs)
+
+        res = res.reshape(shape)
+        return float(res) if scalar else res
+
+
 class Piecewise(Expression):
     """PiecewiseFunction
     A piecewise function. 一维或多维，分段函数
+
+    - Piecewise([(func, cond), ...])            : 条件为函数, 按顺序取第一个满足的分支
+    - Piecewise([func, ...], breakpoints=[...])  : 一维, 按有序断点分段, 见 PiecewiseIntervals
     """
 
-    def __init__(self, piecewise_func: typing.List[typing.Tuple[Expression | float | int, Expression]], **kwargs):
+    def __init__(
+        self,
+        piecewise_func: typing.List[typing.Tuple[Expression | float | int, Expression]] | typing.List,
+        breakpoints: ArrayType = None,
+        right: bool = False,
+        **kwargs,
+    ):
         super().__init__(None, **kwargs)
         self._piecewise = piecewise_func
+        self._intervals = (
+            PiecewiseIntervals(piecewise_func, breakpoints, right=right) if breakpoints is not None else None
+        )
 
     def __copy__(self) -> typing.Self:
         res = super().__copy__()
         res._piecewise = self._piecewise
+        res._intervals = self._intervals
         return res
 
     def __call__(self, *args, **kwargs) -> NumericType:
@@ -42,38 +186,50 @@ class Piecewise(Expression):
         elif any([callable(val) for val in args]):
             return super().__call__(*args, **kwargs)
 
+        elif self._intervals is not None and isinstance(args[0], (float, int, array_type)):
+            return self._intervals(*args, **kwargs)
+
         elif isinstance(args[0], float):
             for func, cond in self._piecewise:
                 if not cond(*args, **kwargs):
                     continue
                 else:
-                    res = func(*args, **kwargs)
+                    res = func(*args, **kwargs) if callable(func) else func
                     break
             else:
                 raise RuntimeError(f"Can not fit any condition! {args}")
 
             return res
         elif isinstance(args[0], array_type):
-            res = np.full_like(args[0], np.nan)
+            res = np.full_like(args[0], np.nan, dtype=float)
+            todo = np.ones(args[0].shape, dtype=bool)
             for func, cond in self._piecewise:
-                marker = cond(*args, **kwargs)
+                # 已归类的点不再参与后面的条件
+                marker = np.asarray(cond(*args, **kwargs), dtype=bool) & todo
+                if not np.any(marker):
+                    continue
+                todo &= ~marker
                 if callable(func):
                     _args = [(a[marker] if isinstance(a, array_type) else a) for a in args]
                     _kwargs = {k: (v[marker] if isinstance(v, array_type) else v) for k, v in kwargs.items()}
                     res[marker] = func(*_args, **_kwargs)
                 else:
                     res[marker] = func
+                if not np.any(todo):
+                    break
 
             return res
         else:
             raise TypeError(f"PiecewiseFunction only support single float or  1D array, {args}")
 
 
-def piecewise(func_cond, size=None, **kwargs):
+def piecewise(func_cond, size=None, breakpoints=None, **kwargs):
     if not isinstance(func_cond, list):
         raise TypeError(f"Illegal type {type(func_cond)}")
+    elif breakpoints is not None:
+        return Piecewise(func_cond, breakpoints=breakpoints, **kwargs)
     elif all([isinstance(func, (array_type, float, int)) and isinstance(cond, array_type) for func, cond in func_cond]):
-        res = np.full_like(func_cond[0][0], np.nan)
+        res = np.full_like(func_cond[0][0], np.nan, dtype=float)
         for func, cond in func_cond:
             if np.sum(cond) == 0:
                 continue
@@ -85,4 +241,3 @@ def piecewise(func_cond, size=None, **kwargs):
         return res
     else:
         return Piecewise(func_cond, **kwargs)
-
@@ -0,0 +1,284 @@
+""" 折线批处理 Kernels for batches of polylines stored as one ragged array
+
+A batch of m curves is stored as
+    points  : [N, ndim]   all nodes, curve after curve
+    offsets : [m+1]       curve k is points[offsets[k]:offsets[k+1]]
+A closed curve repeats its first node at the end (as Curve does).
+
+Every curve is the C2 cubic spline through its nodes, parameterized by chord length
+(periodic for closed curves). The tangents of all curves come from one sparse solve;
+after that every segment is a cubic Hermite patch, so lengths, integrals and resampling
+of the whole batch are vectorized, the segment integrals use Gauss-Legendre quadrature.
+"""
+
+import functools
+import typing
+
+import numpy as np
+import scipy.sparse
+import scipy.sparse.linalg
+
+from spdm.utils.type_hint import ArrayType
+
+
+def ragged(curves: typing.Sequence[ArrayType]) -> typing.Tuple[ArrayType, ArrayType]:
+    """list of [n_k, ndim] arrays -> (points, offsets)"""
+    counts = [len(c) for c in curves]
+    offsets = np.concatenate([[0], np.cumsum(counts)]).astype(int)
+    return np.concatenate([np.asarray(c, dtype=float) for c in curves]), offsets
+
+
+def split(values: ArrayType, offsets: ArrayType) -> typing.List[ArrayType]:
+    return np.split(values, offsets[1:-1])
+
+
+@functools.lru_cache(maxsize=8)
+def _gauss(n: int) -> typing.Tuple[ArrayType, ArrayType]:
+    x, w = np.polynomial.legendre.leggauss(n)
+    return 0.5 * (x + 1.0), 0.5 * w
+
+
+def _segments(offsets: ArrayType) -> ArrayType:
+    """index of the first node of every segment"""
+    n = offsets[-1]
+    start = np.ones(n, dtype=bool)
+    start[offsets[1:] - 1] = False
+    return np.flatnonzero(start)
+
+
+def segment_lengths(points: ArrayType, offsets: ArrayType) -> ArrayType:
+    """chord lengths of all segments [N-m]"""
+    seg = _segments(offsets)
+    return np.linalg.norm(points[seg + 1] - points[seg], axis=-1)
+
+
+def is_closed(points: ArrayType, offsets: ArrayType) -> ArrayType:
+    return np.all(np.isclose(points[offsets[:-1]], points[offsets[1:] - 1]), axis=-1) & (np.diff(offsets) > 2)
+
+
+class _SplineSystem:
+    """Tangents of the C2 cubic splines of all curves, d = A^-1 B v
+
+    closed curves are periodic; open curves are clamped by the three point end slope.
+    A is block diagonal (cyclic for closed curves) and is factorized once for the batch.
+    """
+
+    def __init__(self, h: ArrayType, offsets: ArrayType, closed: ArrayType):
+        n = offsets[-1]
+        seg = _segments(offsets)
+        first, last = offsets[:-1], offsets[1:] - 1
+        count = np.diff(offsets)
+
+        h_left = np.full(n, np.nan)
+        h_right = np.full(n, np.nan)
+        h_left[seg + 1] = h
+        h_right[seg] = h
+        prev = np.arange(n) - 1
+        h_left[first[closed]] = h_left[last[closed]]
+        prev[first[closed]] = last[closed] - 1
+
+        a_rows, a_cols, a_vals = [], [], []
+        b_rows, b_cols, b_vals = [], [], []
+
+        def _add(rows, cols, vals, r, c, v):
+            rows.append(r)
+            cols.append(c)
+            vals.append(np.broadcast_to(v, np.shape(r)))
+
+        # 内点: h_r d_{i-1} + 2(h_l+h_r) d_i + h_l d_{i+1} = 3(h_r δ_l + h_l δ_r)
+        inner = np.isfinite(h_left) & np.isfinite(h_right)
+        inner[last[closed]] = False
+        i = np.flatnonzero(inner)
+        hl, hr = h_left[i], h_right[i]
+        _add(a_rows, a_cols, a_vals, i, i, 2 * (hl + hr))
+        _add(a_rows, a_cols, a_vals, i, prev[i], hr)
+        _add(a_rows, a_cols, a_vals, i, i + 1, hl)
+        _add(b_rows, b_cols, b_vals, i, prev[i], -3 * hr / hl)
+        _add(b_rows, b_cols, b_vals, i, i, 3 * (hr / hl - hl / hr))
+        _add(b_rows, b_cols, b_vals, i, i + 1, 3 * hl / hr)
+
+        # 闭曲线: d_last = d_first
+        _add(a_rows, a_cols, a_vals, last[closed], last[closed], 1.0)
+        _add(a_rows, a_cols, a_vals, last[closed], first[closed], -1.0)
+
+        # 开曲线端点: 单侧三点公式
+        o = ~closed & (count > 2)
+        for ia, sign in ((first[o], 1), (last[o], -1)):
+            ib, ic = ia + sign, ia + 2 * sign
+            h0 = np.abs(h_right[ia] if sign > 0 else h_left[ia])
+            h1 = np.abs(h_right[ib] if sign > 0 else h_left[ib])
+            c0, c1 = (2 * h0 + h1) / (h0 + h1) / h0, h0 / (h0 + h1) / h1
+            _add(a_rows, a_cols, a_vals, ia, ia, 1.0)
+            _add(b_rows, b_cols, b_vals, ia, ia, -sign * c0)
+            _add(b_rows, b_cols, b_vals, ia, ib, sign * (c0 + c1))
+            _add(b_rows, b_cols, b_vals, ia, ic, -sign * c1)
+
+        # 两点曲线: 直线
+        two = count == 2
+        for ia in (first[two], last[two]):
+            hs = h_right[first[two]]
+            _add(a_rows, a_cols, a_vals, ia, ia, 1.0)
+            _add(b_rows, b_cols, b_vals, ia, first[two], -1.0 / hs)
+            _add(b_rows, b_cols, b_vals, ia, last[two], 1.0 / hs)
+
+        def _matrix(rows, cols, vals):
+            return scipy.sparse.csc_matrix(
+                (np.concatenate(vals), (np.concatenate(rows), np.concatenate(cols))), shape=(n, n)
+            )
+
+        self._lu = scipy.sparse.linalg.splu(_matrix(a_rows, a_cols, a_vals))
+        self._rhs = _matrix(b_rows, b_cols, b_vals).tocsr()
+
+    def __call__(self, values: ArrayType) -> ArrayType:
+        return self._lu.solve(np.asarray(self._rhs @ values, dtype=float))
+
+
+class Polylines:
+    """Batch of curves in ragged storage, see the module doc"""
+
+    def __init__(self, points: ArrayType, offsets: ArrayType = None, closed: ArrayType = None, n_gauss: int = 5):
+        points = np.asarray(points, dtype=float)
+        if offsets is None:
+            offsets = np.asarray([0, points.shape[0]])
+        self._points = points
+        self._offsets = np.asarray(offsets, dtype=int)
+        self._closed = is_closed(points, self._offsets) if closed is None else np.broadcast_to(closed, self.size)
+        self._seg = _segments(self._offsets)
+        self._h = segment_lengths(points, self._offsets)
+        self._spline = _SplineSystem(self._h, self._offsets, self._closed)
+        self._d = self._spline(points)
+        self._n_gauss = n_gauss
+
+    @classmethod
+    def from_list(cls, curves: typing.Sequence[ArrayType], **kwargs) -> typing.Self:
+        return cls(*ragged(curves), **kwargs)
+
+    @property
+    def size(self) -> int:
+        return self._offsets.size - 1
+
+    @property
+    def points(self) -> ArrayType:
+        return self._points
+
+    @property
+    def offsets(self) -> ArrayType:
+        return self._offsets
+
+    @property
+    def closed(self) -> ArrayType:
+        return self._closed
+
+    @property
+    def chord_lengths(self) -> ArrayType:
+        return self._h
+
+    def _eval(self, seg: ArrayType, s: ArrayType, values: ArrayType = None, tangents: ArrayType = None):
+        """Hermite spline on segments seg at local coordinate s in [0,1]: value and derivative wrt chord parameter"""
+        if values is None:
+            values, tangents = self._points, self._d
+        i = self._seg[seg]
+        h = self._h[seg]
+        shape = (-1, *([1] * (values.ndim - 1)))
+        s = s.reshape(shape)
+        hh = h.reshape(shape)
+        s2, s3 = s * s, s * s * s
+        p0, p1 = values[i], values[i + 1]
+        m0, m1 = tangents[i] * hh, tangents[i + 1] * hh
+        val = (2 * s3 - 3 * s2 + 1) * p0 + (s3 - 2 * s2 + s) * m0 + (-2 * s3 + 3 * s2) * p1 + (s3 - s2) * m1
+        der = ((6 * s2 - 6 * s) * p0 + (3 * s2 - 4 * s + 1) * m0 + (-6 * s2 + 6 * s) * p1 + (3 * s2 - 2 * s) * m1) / hh
+        return val, der
+
+    def _quadrature(self, seg: ArrayType, upper: ArrayType = None):
+        """Gauss nodes on segments seg over [0, upper]: (segment, s, weight*h)"""
+        x, w = _gauss(self._n_gauss)
+        upper = np.ones(seg.size) if upper is None else upper
+        s = (upper[:, None] * x[None, :]).ravel()
+        wt = (upper[:, None] * w[None, :] * self._h[seg][:, None]).ravel()
+        return np.repeat(seg, x.size), s, wt
+
+    @functools.cached_property
+    def arc_lengths(self) -> ArrayType:
+        """arc length of every segment of the splines [N-m]"""
+        seg = np.arange(self._seg.size)
+        q_seg, s, wt = self._quadrature(seg)
+        _, der = self._eval(q_seg, s)
+        return (np.linalg.norm(der, axis=-1) * wt).reshape(seg.size, -1).sum(axis=-1)
+
+    @functools.cached_property
+    def cumulative_length(self) -> ArrayType:
+        """arc length from the start of the curve, at every node [N]"""
+        res = np.zeros(self._offsets[-1])
+        res[self._seg + 1] = self.arc_lengths
+        res = np.cumsum(res)
+        return res - np.repeat(res[self._offsets[:-1]], np.diff(self._offsets))
+
+    @property
+    def length(self) -> ArrayType:
+        """length of every curve [m]"""
+        return self.cumulative_length[self._offsets[1:] - 1]
+
+    def integral(self, func: typing.Callable[..., ArrayType] | ArrayType) -> ArrayType:
+        """∫ f dl along every curve [m]
+
+        func: function of the coordinates, evaluated at the quadrature points, or values at the
+              nodes [N], interpolated by the same Hermite spline
+        """
+        seg = np.arange(self._seg.size)
+        q_seg, s, wt = self._quadrature(seg)
+        pos, der = self._eval(q_seg, s)
+        if callable(func):
+            val = func(*pos.T)
+        else:
+            val = np.asarray(func, dtype=float)
+            val, _ = self._eval(q_seg, s, val, self._spline(val))
+        per_seg = (val * np.linalg.norm(der, axis=-1) * wt).reshape(seg.size, -1).sum(axis=-1)
+        return np.bincount(self._curve_of_segment, weights=per_seg, minlength=self.size)
+
+    @functools.cached_property
+    def _curve_of_segment(self) -> ArrayType:
+        return np.repeat(np.arange(self.size), np.diff(self._offsets) - 1)
+
+    def locate(self, length: ArrayType, curve: ArrayType, newton: int = 3) -> ArrayType:
+        """points at arc length `length` on the curves `curve`"""
+        length = np.asarray(length, dtype=float)
+        curve = np.asarray(curve, dtype=int)
+
+        # segments of the curve: global search with the curves shifted apart
+        total = self.cumulative_length
+        shift = np.repeat(np.arange(self.size) * (self.length.max() + 1.0) * 2.0, np.diff(self._offsets))
+        node = np.searchsorted(total + shift, length + shift[self._offsets[curve]], side="right") - 1
+        node = np.clip(node, self._offsets[curve], self._offsets[curve + 1] - 2)
+        seg = node - curve  # every curve has one segment less than nodes
+
+        rem = length - total[node]
+        ds = self.arc_lengths[seg]
+        with np.errstate(invalid="ignore", divide="ignore"):
+            s = np.clip(np.where(ds > 0, rem / ds, 0.0), 0.0, 1.0)
+
+        # 段内弧长非线性: 牛顿迭代  ∫_0^s |r'| h ds = rem
+        for _ in range(newton):
+            q_seg, qs, wt = self._quadrature(seg, s)
+            _, der = self._eval(q_seg, qs)
+            f = (np.linalg.norm(der, axis=-1) * wt).reshape(seg.size, -1).sum(axis=-1) - rem
+            _, der = self._eval(seg, s)
+            df = np.linalg.norm(der, axis=-1) * self._h[seg]
+            with np.errstate(invalid="ignore", divide="ignore"):
+                s = np.clip(np.where(df > 0, s - f / df, s), 0.0, 1.0)
+
+        pos, _ = self._eval(seg, s)
+        return pos
+
+    def resample(self, n: int | ArrayType) -> typing.Self:
+        """equal arc resampling, n points per curve (the ends are kept; closed curves stay closed)"""
+        counts = np.broadcast_to(np.asarray(n, dtype=int), (self.size,))
+        curve = np.repeat(np.arange(self.size), counts)
+        frac = np.concatenate([np.linspace(0.0, 1.0, c) for c in counts])
+        points = self.locate(frac * self.length[curve], curve)
+        offsets = np.concatenate([[0], np.cumsum(counts)])
+        ends = offsets[1:] - 1
+        points[ends[self._closed]] = points[offsets[:-1][self._closed]]
+        return Polylines(points, offsets, closed=self._closed, n_gauss=self._n_gauss)
+
+    def split(self, values: ArrayType = None) -> typing.List[ArrayType]:
+        return split(self._points if values is None else values, self._offsets)
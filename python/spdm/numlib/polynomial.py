@@ -1,10 +1,218 @@
-from spdm.utils.type_hint import array_type
+""" 正交多项式级数 Polynomial series (power, Chebyshev, Legendre, Hermite, HermiteE, Laguerre)
+
+Batched kernels, the series share the basis and the coefficients have shape [deg+1, *batch]
+(the numpy.polynomial convention):
+
+- clenshaw     : evaluation of many series at many points by the Clenshaw recurrence
+- PolynomialFit: least squares fit of many profiles sampled on the same points, the
+                 Vandermonde matrix is factorized once (QR) and reused for every right hand side
+- derivative / antiderivative of the series, definite integrals
+
+The argument is mapped linearly from `domain` to `window` (default: the natural window of the basis).
+"""
+
+import functools
+import typing
+
+import numpy as np
+from numpy.polynomial import chebyshev, hermite, hermite_e, laguerre, legendre, polynomial
+
+from spdm.utils.type_hint import ArrayType, array_type
 from spdm.core.expression import Expression
 
+_BASIS = {
+    "power": polynomial,
+    "chebyshev": chebyshev,
+    "legendre": legendre,
+    "hermite": hermite,
+    "hermite_e": hermite_e,
+    "laguerre": laguerre,
+}
+
+_PREFIX = {
+    "power": "poly",
+    "chebyshev": "cheb",
+    "legendre": "leg",
+    "hermite": "herm",
+    "hermite_e": "herme",
+    "laguerre": "lag",
+}
+
+_WINDOW = {
+    "power": (-1.0, 1.0),
+    "chebyshev": (-1.0, 1.0),
+    "legendre": (-1.0, 1.0),
+    "hermite": (-1.0, 1.0),
+    "hermite_e": (-1.0, 1.0),
+    "laguerre": (0.0, 1.0),
+}
+
+
+def _kind(kind: str | None) -> str:
+    kind = kind or "power"
+    if kind not in _BASIS:
+        raise ValueError(f"Unknown polynomial kind {kind}")
+    return kind
+
+
+def _recurrence(kind: str, n: int) -> typing.Tuple[ArrayType, ArrayType, ArrayType]:
+    """P_{k+1} = (a_k x + b_k) P_k - g_k P_{k-1},  P_0 = 1, k = 0..n-1"""
+    k = np.arange(n, dtype=float)
+    one = np.ones(n)
+    match kind:
+        case "power":
+            return one, 0 * one, 0 * one
+        case "chebyshev":
+            return np.where(k == 0, 1.0, 2.0), 0 * one, one
+        case "legendre":
+            return (2 * k + 1) / (k + 1), 0 * one, k / (k + 1)
+        case "hermite":
+            return 2 * one, 0 * one, 2 * k
+        case "hermite_e":
+            return one, 0 * one, k
+        case "laguerre":
+            return -1 / (k + 1), (2 * k + 1) / (k + 1), k / (k + 1)
+
+
+def _mapping(kind: str, domain=None, window=None) -> typing.Tuple[float, float]:
+    """x_window = off + scl * x"""
+    if domain is None:
+        return 0.0, 1.0
+    window = _WINDOW[kind] if window is None else window
+    (d0, d1), (w0, w1) = domain, window
+    scl = (w1 - w0) / (d1 - d0)
+    return w0 - scl * d0, scl
+
+
+def clenshaw(
+    c: ArrayType, x: ArrayType, kind: str = "power", domain=None, window=None, tensor: bool = True
+) -> ArrayType:
+    """Value of the series c[deg+1, *batch] at x, shape [*batch, *x.shape] (as numpy chebval)
+    tensor=False: the batch is broadcast with x, e.g. every point with its own series"""
+    kind = _kind(kind)
+    c = np.asarray(c, dtype=float)
+    x = np.asarray(x, dtype=float)
+    off, scl = _mapping(kind, domain, window)
+    t = off + scl * x
+
+    n = c.shape[0]
+    a, b, g = _recurrence(kind, n)
+    shape = c.shape[1:] + (1,) * x.ndim if tensor else c.shape[1:]
+    b1 = np.zeros(np.broadcast_shapes(shape, x.shape))
+    b2 = np.zeros(b1.shape)
+    for k in range(n - 1, -1, -1):
+        gk = g[k + 1] if k + 1 < n else 0.0
+        b1, b2 = c[k].reshape(shape) + (a[k] * t + b[k]) * b1 - gk * b2, b1
+    return b1
+
+
+def vandermonde(x: ArrayType, deg: int, kind: str = "power", domain=None, window=None) -> ArrayType:
+    """V[..., k] = P_k(x), k = 0..deg"""
+    kind = _kind(kind)
+    off, scl = _mapping(kind, domain, window)
+    t = off + scl * np.asarray(x, dtype=float)
+    a, b, g = _recurrence(kind, deg + 1)
+    v = np.empty(t.shape + (deg + 1,))
+    v[..., 0] = 1.0
+    if deg > 0:
+        v[..., 1] = a[0] * t + b[0]
+    for k in range(1, deg):
+        v[..., k + 1] = (a[k] * t + b[k]) * v[..., k] - g[k] * v[..., k - 1]
+    return v
+
+
+class PolynomialFit:
+    """Weighted least squares fit of series of degree deg to many profiles sampled at x
+
+    The column scaled Vandermonde matrix is factorized once, V = Q R, then
+        c = R^-1 Q^T (w y)  for all right hand sides together.
+    """
+
+    def __init__(self, x: ArrayType, deg: int, kind: str = "power", domain=None, window=None, w: ArrayType = None):
+        x = np.asarray(x, dtype=float)
+        if x.ndim != 1:
+            raise ValueError(f"x must be 1D, not {x.shape}")
+        if x.size < deg + 1:
+            raise ValueError(f"Too few points {x.size} for degree {deg}")
+        self._kind = _kind(kind)
+        self._deg = deg
+        self._domain = (float(x.min()), float(x.max())) if domain is None else tuple(domain)
+        self._window = _WINDOW[self._kind] if window is None else tuple(window)
+        self._w = None if w is None else np.asarray(w, dtype=float)
+
+        v = vandermonde(x, deg, self._kind, self._domain, self._window)
+        if self._w is not None:
+            v = v * self._w[:, None]
+        self._scale = np.sqrt(np.square(v).sum(axis=0))
+        self._scale[self._scale == 0] = 1.0
+        self._q, self._r = np.linalg.qr(v / self._scale)
+        self._n = x.size
+
+    @property
+    def kind(self) -> str:
+        return self._kind
+
+    @property
+    def domain(self) -> typing.Tuple[float, float]:
+        return self._domain
+
+    @property
+    def window(self) -> typing.Tuple[float, float]:
+        return self._window
+
+    def __call__(self, y: ArrayType) -> ArrayType:
+        """y[n, *batch] -> c[deg+1, *batch]"""
+        y = np.asarray(y, dtype=float)
+        if y.shape[0] != self._n:
+            raise ValueError(f"Shape mismatch {y.shape} [{self._n},...]")
+        rhs = y.reshape(self._n, -1)
+        if self._w is not None:
+            rhs = rhs * self._w[:, None]
+        c = np.linalg.solve(self._r, self._q.T @ rhs) / self._scale[:, None]
+        return c.reshape((self._deg + 1,) + y.shape[1:])
+
+
+@functools.lru_cache(maxsize=32)
+def _polynomial_fit(x: bytes, deg: int, kind: str, domain, window) -> PolynomialFit:
+    return PolynomialFit(np.frombuffer(x), deg, kind, domain, window)
+
+
+def polyfit(x: ArrayType, y: ArrayType, deg: int, kind: str = "power", domain=None, window=None, w=None):
+    """Fit y[n, *batch] sampled at x; the factorization is cached for unweighted fits"""
+    kind = _kind(kind)
+    if w is not None:
+        return PolynomialFit(x, deg, kind, domain, window, w)(y)
+    domain = None if domain is None else tuple(domain)
+    window = None if window is None else tuple(window)
+    return _polynomial_fit(np.ascontiguousarray(x, dtype=float).tobytes(), deg, kind, domain, window)(y)
+
+
+def derivative(c: ArrayType, m: int = 1, kind: str = "power", domain=None, window=None) -> ArrayType:
+    """Coefficients of the m-th derivative with respect to x (not to the window variable)"""
+    kind = _kind(kind)
+    _, scl = _mapping(kind, domain, window)
+    return getattr(_BASIS[kind], _PREFIX[kind] + "der")(np.asarray(c, dtype=float), m, scl=scl, axis=0)
+
+
+def antiderivative(c: ArrayType, m: int = 1, kind: str = "power", domain=None, window=None, lbnd=None) -> ArrayType:
+    """Coefficients of the m-th antiderivative, zero at x = lbnd (default: the lower end of the domain)"""
+    kind = _kind(kind)
+    off, scl = _mapping(kind, domain, window)
+    lb = (off + scl * lbnd) if lbnd is not None else (off + scl * domain[0] if domain is not None else 0.0)
+    return getattr(_BASIS[kind], _PREFIX[kind] + "int")(np.asarray(c, dtype=float), m, lbnd=lb, scl=1.0 / scl, axis=0)
+
+
+def integral(c: ArrayType, a: float, b: float, kind: str = "power", domain=None, window=None) -> ArrayType:
+    """∫_a^b of every series, shape [*batch]"""
+    ci = antiderivative(c, 1, kind, domain, window, lbnd=a)
+    return clenshaw(ci, np.asarray(b, dtype=float), kind, domain, window)
+
 
 class Polynomials(Expression):
-    """A wrapper for numpy.polynomial
-    TODO: imcomplete
+    """A wrapper for numpy.polynomial, 批量级数
+
+    coeff : [deg+1] or [deg+1, *batch], evaluation returns [*batch, *x.shape]
+    kind  : "power", "chebyshev", "legendre", "hermite", "hermite_e", "laguerre"
     """
 
     def __init__(
@@ -19,41 +227,62 @@ class Polynomials(Expression):
         postprocess=None,
         **kwargs,
     ) -> None:
-        match kind:
-            case "chebyshev":
-                from numpy.polynomial.chebyshev import Chebyshev
+        kind = _kind(kind)
+        coeff = np.asarray(coeff, dtype=float)
+        interval = None if domain is None else tuple(domain)
+        window = None if window is None else tuple(window)
 
-                PPolyOp = Chebyshev
-            case "hermite":
-                from numpy.polynomial.hermite import Hermite
+        super().__init__(functools.partial(clenshaw, coeff, kind=kind, domain=interval, window=window), *args, **kwargs)
+        self._coeff = coeff
+        self._kind = kind
+        self._interval = interval
+        self._window = window
+        self._symbol = symbol
+        self._preprocess = preprocess
+        self._postprocess = postprocess
 
-                PPolyOp = Hermite
-            case "hermite":
-                from numpy.polynomial.hermite_e import HermiteE
+    @classmethod
+    def fit(cls, x: ArrayType, y: ArrayType, deg: int, kind: str = "chebyshev", domain=None, w=None, **kwargs):
+        """least squares fit of the profiles y[len(x), *batch]"""
+        x = np.asarray(x, dtype=float)
+        domain = (float(x.min()), float(x.max())) if domain is None else tuple(domain)
+        return cls(polyfit(x, y, deg, kind, domain, w=w), kind=kind, domain=domain, **kwargs)
 
-                PPolyOp = HermiteE
-            case "laguerre":
-                from numpy.polynomial.laguerre import Laguerre
+    @property
+    def coeff(self) -> ArrayType:
+        return self._coeff
 
-                PPolyOp = Laguerre
-            case "legendre":
-                from numpy.polynomial.legendre import Legendre
+    @property
+    def kind(self) -> str:
+        return self._kind
 
-                PPolyOp = Legendre
-            case _:  # "power"
-                import numpy.polynomial.polynomial as polynomial
+    def _new(self, coeff: ArrayType) -> typing.Self:
+        return Polynomials(
+            coeff,
+            kind=self._kind,
+            domain=self._interval,
+            window=self._window,
+            symbol=self._symbol,
+            preprocess=self._preprocess,
+            postprocess=self._postprocess,
+        )
 
-                PPolyOp = polynomial
+    def derivative(self, order: int = 1, **kwargs) -> typing.Self:
+        return self._new(derivative(self._coeff, order, self._kind, self._interval, self._window))
 
-        op = PPolyOp(coeff, domain=domain, window=window, symbol=symbol)
+    def antiderivative(self, order: int = 1, **kwargs) -> typing.Self:
+        return self._new(antiderivative(self._coeff, order, self._kind, self._interval, self._window))
 
-        super().__init__(op, *args, **kwargs)
-        self._preprocess = preprocess
-        self._postprocess = postprocess
+    def integral(self, *args, **kwargs) -> float | ArrayType:
+        """定积分, 默认在 domain 上"""
+        if len(args) == 0 and self._interval is not None:
+            args = self._interval
+        if len(args) != 2 or self._preprocess is not None or self._postprocess is not None:
+            return super().integral(*args, **kwargs)
+        return integral(self._coeff, *args, self._kind, self._interval, self._window)
 
     def _eval(self, x: array_type | float) -> array_type | float:
-
-        if not isinstance(x, (array_type, float)):
+        if not isinstance(x, (array_type, float, int)):
             return super().__call__(x)
 
         if self._preprocess is not None:
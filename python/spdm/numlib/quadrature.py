@@ -0,0 +1,232 @@
+""" 数值积分 Numerical quadrature
+
+- Gauss-Legendre      : tensor-product rule on rectilinear meshes
+- spline weights      : exact integral of the cubic spline interpolant
+- Gauss-Kronrod (7-15): adaptive 1D integration with error control
+
+All partial sums are reduced with `math.fsum`, so the result does not depend on
+the order in which cells or intervals are visited.
+"""
+
+import functools
+import math
+import typing
+
+import numpy as np
+from scipy.interpolate import CubicSpline
+
+from spdm.utils.logger import logger
+from spdm.utils.type_hint import ArrayType
+
+
+def fsum(value: ArrayType) -> float:
+    """Correctly rounded (hence order independent) summation."""
+    return math.fsum(np.asarray(value, dtype=float).ravel())
+
+
+@functools.cache
+def gauss_legendre(n: int) -> typing.Tuple[ArrayType, ArrayType]:
+    """Gauss-Legendre nodes and weights on [-1,1]"""
+    x, w = np.polynomial.legendre.leggauss(n)
+    x.setflags(write=False)
+    w.setflags(write=False)
+    return x, w
+
+
+def gauss_legendre_nodes(x: ArrayType, n: int = 3) -> typing.Tuple[ArrayType, ArrayType]:
+    """Gauss-Legendre nodes and weights on every cell of the 1D grid x.
+
+    Returns:
+        nodes, weights : shape [len(x)-1, n]
+    """
+    xi, wi = gauss_legendre(n)
+    x = np.asarray(x, dtype=float)
+    c = 0.5 * (x[1:] + x[:-1])
+    h = 0.5 * (x[1:] - x[:-1])
+    return c[:, None] + h[:, None] * xi[None, :], h[:, None] * wi[None, :]
+
+
+def integrate_gauss_legendre(func: typing.Callable[..., ArrayType], *dims: ArrayType, n: int = 3) -> float:
+    """Tensor-product Gauss-Legendre quadrature of func over the rectilinear grid `dims`.
+
+    func is evaluated once on the tensor grid of all cell nodes.
+    """
+    nodes = []
+    weights = None
+    for d in dims:
+        x, w = gauss_legendre_nodes(d, n)
+        nodes.append(x.ravel())
+        weights = w.ravel() if weights is None else np.multiply.outer(weights, w.ravel())
+
+    value = np.asarray(func(*np.meshgrid(*nodes, indexing="ij")), dtype=float)
+
+    return fsum(value * weights)
+
+
+def cumulative_gauss_legendre(
+    func: typing.Callable[..., ArrayType], *dims: ArrayType, axis: int = 0, n: int = 3
+) -> ArrayType:
+    """Cumulative integral of func along `axis`, sampled on the grid points of `dims`.
+
+    The other axes are sampled at the grid points, the integrated axis at the
+    Gauss-Legendre nodes of each cell.
+    """
+    x, w = gauss_legendre_nodes(dims[axis], n)
+    ncell = x.shape[0]
+
+    coords = [*dims]
+    coords[axis] = x.ravel()
+    value = np.asarray(func(*np.meshgrid(*coords, indexing="ij")), dtype=float)
+
+    value = np.moveaxis(value, axis, -1).reshape(*value.shape[:axis], *value.shape[axis + 1 :], ncell, n)
+    cell = np.sum(value * w, axis=-1)
+
+    res = np.zeros((*cell.shape[:-1], ncell + 1))
+    res[..., 1:] = np.cumsum(cell, axis=-1)
+    return np.moveaxis(res, -1, axis)
+
+
+@functools.lru_cache(maxsize=32)
+def _spline_weights(x: bytes, bc_type: str) -> ArrayType:
+    x = np.frombuffer(x, dtype=float)
+    spl = CubicSpline(x, np.eye(x.size), bc_type=bc_type, axis=0)
+    w = spl.integrate(x[0], x[-1])
+    w.setflags(write=False)
+    return w
+
+
+def spline_weights(x: ArrayType, bc_type: str = "not-a-knot") -> ArrayType:
+    """Quadrature weights w such that  sum(w*y) == integral of CubicSpline(x,y,bc_type)
+
+    The spline is linear in y, so the weights are the integrals of the cardinal splines.
+    """
+    return _spline_weights(np.ascontiguousarray(x, dtype=float).tobytes(), bc_type)
+
+
+def integrate_spline(value: ArrayType, *dims: ArrayType, bc_type: str = "not-a-knot") -> float:
+    """Exact integral of the tensor-product cubic spline interpolant of `value` on `dims`."""
+    value = np.asarray(value, dtype=float)
+    for d in dims[:-1]:
+        value = np.tensordot(spline_weights(d, bc_type), value, axes=([0], [0]))
+    return fsum(value * spline_weights(dims[-1], bc_type))
+
+
+# fmt: off
+# Gauss-Kronrod 7-15  nodes (non negative half) and weights
+_GK15_XGK = np.array([
+    0.991455371120812639206854697526329, 0.949107912342758524526189684047851,
+    0.864864423359769072789712788640926, 0.741531185599394439863864773280788,
+    0.586087235467691130294144845693013, 0.405845151377397166906606412076961,
+    0.207784955007898467600689403773245, 0.000000000000000000000000000000000,
+])
+_GK15_WGK = np.array([
+    0.022935322010529224963732008058970, 0.063092092629978553290700663189204,
+    0.104790010322250183839876322541518, 0.140653259715525918745189590510238,
+    0.169004726639267902826583426598550, 0.190350578064785409913256402421014,
+    0.204432940075298892414161999234649, 0.209482141084727828012999174891714,
+])
+_GK15_WG = np.array([
+    0.129484966168869693270611432679082, 0.279705391489276667901467771423780,
+    0.381830050505118944950369775488975, 0.417959183673469387755102040816327,
+])
+# fmt: on
+
+_GK15_X = np.concatenate([-_GK15_XGK[:-1], _GK15_XGK[::-1]])
+_GK15_WK = np.concatenate([_GK15_WGK[:-1], _GK15_WGK[::-1]])
+_GK15_WG7 = np.zeros(15)
+_GK15_WG7[1:7:2] = _GK15_WG[:3]
+_GK15_WG7[7] = _GK15_WG[3]
+_GK15_WG7[9:15:2] = _GK15_WG[2::-1]
+
+
+def _gk15(func, a: ArrayType, b: ArrayType) -> typing.Tuple[ArrayType, ArrayType]:
+    """Gauss-Kronrod 7-15 estimate and error on every interval [a,b] with one call of func."""
+    c = 0.5 * (a + b)
+    h = 0.5 * (b - a)
+    x = c[:, None] + h[:, None] * _GK15_X[None, :]
+    y = np.asarray(func(x.ravel()), dtype=float).reshape(x.shape)
+    res_k = h * (y @ _GK15_WK)
+    res_g = h * (y @ _GK15_WG7)
+    return res_k, np.abs(res_k - res_g)
+
+
+def integrate_gauss_kronrod(
+    func: typing.Callable[[ArrayType], ArrayType],
+    a: float,
+    b: float,
+    epsabs: float = 1.49e-8,
+    epsrel: float = 1.49e-8,
+    limit: int = 50,
+    full_output: bool = False,
+) -> float | typing.Tuple[float, float]:
+    """Adaptive Gauss-Kronrod (7-15) integration.
+
+    Every pass evaluates all active intervals in a single vectorized call of `func`.
+    An interval is accepted when its error estimate is within its share (by length)
+    of the global tolerance, otherwise it is bisected.
+
+    Args:
+        limit: maximum number of subintervals (as scipy quad), when it is reached only
+               the intervals with the largest errors are bisected
+
+    Returns:
+        value  or (value, error) if full_output
+    """
+    if a == b:
+        return (0.0, 0.0) if full_output else 0.0
+
+    sign = 1.0
+    if a > b:
+        a, b, sign = b, a, -1.0
+
+    left = np.asarray([a], dtype=float)
+    right = np.asarray([b], dtype=float)
+
+    done_x, done_v, done_e = [], [], []
+    n_done = 0
+    exhausted = False
+
+    tol = None
+
+    while left.size > 0:
+        value, error = _gk15(func, left, right)
+
+        if tol is None:
+            tol = max(epsabs, epsrel * abs(value[0]))
+
+        accept = error <= tol * (right - left) / (b - a)
+
+        # 每次二分增加一个子区间, 超出 limit 时只二分误差最大的, 其余按当前估计计入
+        split = ~accept
+        room = limit - n_done - left.size
+        if np.count_nonzero(split) > room:
+            exhausted = True
+            worst = np.argsort(np.where(split, -error, np.inf), kind="stable")[: max(room, 0)]
+            split[:] = False
+            split[worst] = True
+
+        done = ~split
+        done_x.append(left[done])
+        done_v.append(value[done])
+        done_e.append(error[done])
+        n_done += int(np.count_nonzero(done))
+
+        l, r = left[split], right[split]
+        m = 0.5 * (l + r)
+        left = np.concatenate([l, m])
+        right = np.concatenate([m, r])
+
+        # update the global tolerance with the best current estimate
+        v_now = fsum(np.concatenate([*done_v, value[split]]))
+        tol = max(epsabs, epsrel * abs(v_now))
+
+    if exhausted:
+        logger.warning(
+            f"Gauss-Kronrod: reach the limit of subintervals ({limit}), error={fsum(np.concatenate(done_e)):.3e}"
+        )
+
+    order = np.argsort(np.concatenate(done_x), kind="stable")
+    value = sign * fsum(np.concatenate(done_v)[order])
+    error = fsum(np.concatenate(done_e)[order])
+
+    return (value, error) if full_output else value
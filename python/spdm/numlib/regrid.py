@@ -0,0 +1,246 @@
+""" 网格间插值 Regridding between meshes
+
+The remap from a source mesh to a target mesh is linear in the field values, so it
+is assembled once as a sparse matrix W [n_target, n_source] and applied as
+
+    target = W @ source
+
+A stack of fields on the same pair of meshes (e.g. a time series) is remapped by a
+single sparse matrix-matrix product.
+
+methods:
+    - "bilinear"    : multi-linear on rectilinear source, barycentric (Delaunay) on others
+    - "bicubic"     : tensor-product cubic convolution (Keys, a=-1/2), rectilinear source only
+    - "conservative": first order conservative, rectilinear source and target.
+                      Node values are treated as averages over their dual cells. Target
+                      cells not fully covered by the source mesh get `fill_value`.
+"""
+
+import collections
+import itertools
+import typing
+
+import numpy as np
+import scipy.sparse
+import scipy.spatial
+
+from spdm.utils.logger import logger
+from spdm.utils.type_hint import ArrayType
+
+
+def _rect_dims(mesh) -> typing.Tuple[ArrayType, ...] | None:
+    dims = getattr(mesh, "dims", None)
+    if isinstance(dims, (tuple, list)) and len(dims) > 0 and all(np.ndim(d) == 1 for d in dims):
+        if getattr(mesh, "is_tensor_grid", True):
+            return tuple(np.asarray(d, dtype=float) for d in dims)
+    return None
+
+
+def _points(mesh) -> ArrayType:
+    points = np.asarray(mesh.points, dtype=float)
+    return points.reshape(-1, points.shape[-1])
+
+
+def _linear_1d(x: ArrayType, xi: ArrayType) -> typing.Tuple[ArrayType, ArrayType, ArrayType]:
+    """indices [m,2], weights [m,2], inside [m]"""
+    idx = np.clip(np.searchsorted(x, xi, side="right") - 1, 0, x.size - 2)
+    t = (xi - x[idx]) / (x[idx + 1] - x[idx])
+    inside = (xi >= x[0]) & (xi <= x[-1])
+    return np.stack([idx, idx + 1], axis=-1), np.stack([1.0 - t, t], axis=-1), inside
+
+
+def _cubic_1d(x: ArrayType, xi: ArrayType, a: float = -0.5) -> typing.Tuple[ArrayType, ArrayType, ArrayType]:
+    """Keys cubic convolution. Local coordinate is relative to the (possibly non-uniform) cell."""
+    idx = np.clip(np.searchsorted(x, xi, side="right") - 1, 0, x.size - 2)
+    t = (xi - x[idx]) / (x[idx + 1] - x[idx])
+
+    s = np.stack([1.0 + t, t, 1.0 - t, 2.0 - t], axis=-1)
+    w = np.where(
+        s <= 1.0,
+        ((a + 2.0) * s - (a + 3.0)) * s * s + 1.0,
+        ((a * s - 5.0 * a) * s + 8.0 * a) * s - 4.0 * a,
+    )
+
+    n = x.size
+    indices = idx[:, None] + np.arange(-1, 3)[None, :]
+
+    # ghost points beyond the boundary:  f[-1] = 3f[0]-3f[1]+f[2],  f[n] = 3f[n-1]-3f[n-2]+f[n-3]
+    lo = indices[:, 0] < 0
+    hi = indices[:, 3] > n - 1
+    w_lo = np.where(lo, w[:, 0], 0.0)
+    w_hi = np.where(hi, w[:, 3], 0.0)
+    w[:, 0] = np.where(lo, 0.0, w[:, 0])
+    w[:, 3] = np.where(hi, 0.0, w[:, 3])
+
+    indices = np.concatenate(
+        [np.clip(indices, 0, n - 1), np.broadcast_to([0, 1, 2, n - 1, n - 2, n - 3], (xi.size, 6))], axis=-1
+    )
+    ghost = np.asarray([3.0, -3.0, 1.0])
+    w = np.concatenate([w, w_lo[:, None] * ghost, w_hi[:, None] * ghost], axis=-1)
+
+    inside = (xi >= x[0]) & (xi <= x[-1])
+    return indices, w, inside
+
+
+def _tensor_weights(dims, points, kernel) -> typing.Tuple[scipy.sparse.csr_matrix, ArrayType]:
+    shape = tuple(d.size for d in dims)
+    m = points.shape[0]
+
+    per_axis = [kernel(d, points[:, i]) for i, d in enumerate(dims)]
+
+    inside = np.bitwise_and.reduce([p[2] for p in per_axis])
+
+    k = [p[0].shape[1] for p in per_axis]
+    rows, cols, vals = [], [], []
+    for combo in itertools.product(*[range(n) for n in k]):
+        idx = tuple(per_axis[i][0][:, c] for i, c in enumerate(combo))
+        w = np.prod([per_axis[i][1][:, c] for i, c in enumerate(combo)], axis=0)
+        rows.append(np.arange(m))
+        cols.append(np.ravel_multi_index(idx, shape))
+        vals.append(w)
+
+    rows = np.concatenate(rows)
+    cols = np.concatenate(cols)
+    vals = np.concatenate(vals)
+    keep = inside[rows]
+
+    mat = scipy.sparse.csr_matrix((vals[keep], (rows[keep], cols[keep])), shape=(m, int(np.prod(shape))))
+    mat.sum_duplicates()
+    return mat, inside
+
+
+def _barycentric_weights(src_points, points) -> typing.Tuple[scipy.sparse.csr_matrix, ArrayType]:
+    tri = scipy.spatial.Delaunay(src_points)
+    simplex = tri.find_simplex(points)
+    inside = simplex >= 0
+    ndim = src_points.shape[1]
+
+    trans = tri.transform[simplex[inside]]
+    b = np.einsum("ijk,ik->ij", trans[:, :ndim, :], points[inside] - trans[:, ndim, :])
+    w = np.concatenate([b, 1.0 - b.sum(axis=1, keepdims=True)], axis=1)
+
+    rows = np.repeat(np.flatnonzero(inside), ndim + 1)
+    cols = tri.simplices[simplex[inside]].ravel()
+    mat = scipy.sparse.csr_matrix((w.ravel(), (rows, cols)), shape=(points.shape[0], src_points.shape[0]))
+    mat.sum_duplicates()
+    return mat, inside
+
+
+def _dual_cells(x: ArrayType) -> ArrayType:
+    """Boundaries of the dual (control volume) cells of the nodes x"""
+    return np.concatenate([[x[0]], 0.5 * (x[1:] + x[:-1]), [x[-1]]])
+
+
+def _overlap_1d(x_src: ArrayType, x_dst: ArrayType) -> scipy.sparse.csr_matrix:
+    """A[i,j] = |dual_dst_i ∩ dual_src_j| / |dual_dst_i|"""
+    es = _dual_cells(x_src)
+    ed = _dual_cells(x_dst)
+    lo, hi = ed[:-1], ed[1:]
+
+    # 与目标单元 i 相交的源单元为 j0[i] <= j < j1[i]
+    j0 = np.maximum(np.searchsorted(es, lo, side="right") - 1, 0)
+    j1 = np.minimum(np.searchsorted(es, hi, side="left"), x_src.size)
+    count = np.where(hi > lo, np.maximum(j1 - j0, 0), 0)
+
+    rows = np.repeat(np.arange(x_dst.size), count)
+    cols = np.repeat(j0 - np.cumsum(count) + count, count) + np.arange(rows.size)
+    ov = np.minimum(es[cols + 1], hi[rows]) - np.maximum(es[cols], lo[rows])
+    ok = ov > 0
+
+    return scipy.sparse.csr_matrix(
+        (ov[ok] / (hi - lo)[rows[ok]], (rows[ok], cols[ok])), shape=(x_dst.size, x_src.size)
+    )
+
+
+class Regridder:
+    """Sparse linear remap from `source` mesh to `target` mesh"""
+
+    def __init__(self, source, target, method: str = "bilinear", fill_value: float = np.nan) -> None:
+        src_dims = _rect_dims(source)
+        dst_dims = _rect_dims(target)
+
+        self._src_shape = tuple(source.shape)
+        self._dst_shape = tuple(target.shape)
+        self._fill_value = fill_value
+        self._method = method
+
+        match method:
+            case "bilinear" | "linear":
+                if src_dims is not None:
+                    self._matrix, inside = _tensor_weights(src_dims, _points(target), _linear_1d)
+                else:
+                    self._matrix, inside = _barycentric_weights(_points(source), _points(target))
+
+            case "bicubic" | "cubic":
+                if src_dims is None:
+                    raise NotImplementedError(f"bicubic regrid from {source.__class__.__name__}")
+                self._matrix, inside = _tensor_weights(src_dims, _points(target), _cubic_1d)
+
+            case "conservative":
+                if src_dims is None or dst_dims is None:
+                    raise NotImplementedError("conservative regrid requires rectilinear meshes")
+                mat = None
+                for xs, xd in zip(src_dims, dst_dims):
+                    a = _overlap_1d(xs, xd)
+                    mat = a if mat is None else scipy.sparse.kron(mat, a, format="csr")
+                mat = mat.tocsr()
+                # 只部分落在源网格内的目标单元不外推 (取 fill_value), 其余按行和归一化消除舍入误差
+                total = np.asarray(mat.sum(axis=1)).ravel()
+                inside = total >= 1.0 - 1.0e-10
+                self._matrix = scipy.sparse.diags(np.where(inside, 1.0 / np.where(inside, total, 1.0), 0.0)) @ mat
+                self._matrix.eliminate_zeros()
+            case _:
+                raise ValueError(f"Unknown regrid method {method}")
+
+        self._outside = np.flatnonzero(~inside)
+
+        if self._outside.size > 0:
+            logger.debug(f"Regrid: {self._outside.size} target points are outside of the source mesh")
+
+    @property
+    def matrix(self) -> scipy.sparse.csr_matrix:
+        return self._matrix
+
+    def __call__(self, value: ArrayType) -> ArrayType:
+        """value shape [*source.shape] or [n, *source.shape]  (stack of fields)"""
+        value = np.asarray(value)
+        ndim = len(self._src_shape)
+
+        if tuple(value.shape[-ndim:]) != self._src_shape:
+            raise ValueError(f"Shape mismatch {value.shape} != [...,{self._src_shape}]")
+
+        lead = value.shape[:-ndim]
+        v = value.reshape(-1, int(np.prod(self._src_shape))).T
+
+        res = (self._matrix @ v).T
+
+        if self._outside.size > 0:
+            res[:, self._outside] = self._fill_value
+
+        return res.reshape(*lead, *self._dst_shape)
+
+
+_REGRIDDER_CACHE: collections.OrderedDict = collections.OrderedDict()
+
+REGRIDDER_CACHE_SIZE = 16
+
+
+def regridder(source, target, method: str = "bilinear", **kwargs) -> Regridder:
+    """Cached Regridder, keyed by the fingerprints of the two meshes"""
+    key = (source.fingerprint, target.fingerprint, method, tuple(sorted(kwargs.items())))
+
+    op = _REGRIDDER_CACHE.get(key, None)
+
+    if op is None:
+        op = Regridder(source, target, method=method, **kwargs)
+        _REGRIDDER_CACHE[key] = op
+        if len(_REGRIDDER_CACHE) > REGRIDDER_CACHE_SIZE:
+            _REGRIDDER_CACHE.popitem(last=False)
+    else:
+        _REGRIDDER_CACHE.move_to_end(key)
+
+    return op
+
+
+def regrid(value: ArrayType, source, target, method: str = "bilinear", **kwargs) -> ArrayType:
+    return regridder(source, target, method=method, **kwargs)(value)
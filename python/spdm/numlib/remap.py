@@ -0,0 +1,158 @@
+""" 一维剖面坐标变换 Batched remapping of 1D profiles between coordinates
+
+Typical use: profiles sampled on a `psi_norm` grid are needed on a `rho_tor_norm`
+grid. Given the mapping once (the value of the new coordinate at every source
+point), a whole batch of profiles [n_profiles, n_points] is remapped per call.
+
+    >>> op = ProfileRemap(rho_tor_norm_of_psi, rho_grid, method="pchip")
+    >>> y_rho = op(y_psi)            # y_psi.shape == [n_profiles, len(rho_tor_norm_of_psi)]
+
+methods:
+    - "linear" : piecewise linear, cached sparse weights
+    - "cubic"  : natural cubic spline; the spline is linear in y, so it is cached as a dense matrix
+    - "pchip"  : monotonicity preserving cubic Hermite (Fritsch-Carlson), cached intervals and basis
+"""
+
+import functools
+import typing
+
+import numpy as np
+import scipy.sparse
+from scipy.interpolate import CubicSpline
+
+from spdm.utils.type_hint import ArrayType
+
+
+class ProfileRemap:
+    """Remap profiles from the source coordinate x_src to the points x_dst
+
+    Args:
+        x_src      : value of the target coordinate at the source points, strictly monotonic
+        x_dst      : points where the profiles are wanted
+        method     : "linear", "cubic" or "pchip"
+        extrapolate: if False, points outside [min(x_src),max(x_src)] are set to nan
+    """
+
+    def __init__(self, x_src: ArrayType, x_dst: ArrayType, method: str = "linear", extrapolate: bool = False):
+        x_src = np.asarray(x_src, dtype=float)
+        x_dst = np.asarray(x_dst, dtype=float)
+
+        dx = np.diff(x_src)
+        if np.all(dx < 0):
+            self._order = np.arange(x_src.size)[::-1]
+            x_src = x_src[::-1]
+        elif np.all(dx > 0):
+            self._order = None
+        else:
+            raise ValueError("x_src must be strictly monotonic!")
+
+        self._n = x_src.size
+        self._shape = x_dst.shape
+        self._method = method
+
+        xi = x_dst.ravel()
+        idx = np.clip(np.searchsorted(x_src, xi, side="right") - 1, 0, self._n - 2)
+        h = x_src[idx + 1] - x_src[idx]
+        t = (xi - x_src[idx]) / h
+
+        self._outside = None if extrapolate else np.flatnonzero((xi < x_src[0]) | (xi > x_src[-1]))
+
+        match method:
+            case "linear":
+                m = xi.size
+                rows = np.concatenate([np.arange(m), np.arange(m)])
+                cols = np.concatenate([idx, idx + 1])
+                vals = np.concatenate([1.0 - t, t])
+                self._matrix = scipy.sparse.csr_matrix((vals, (rows, cols)), shape=(m, self._n))
+
+            case "cubic":
+                self._matrix = CubicSpline(x_src, np.eye(self._n), bc_type="natural", axis=0)(xi)
+
+            case "pchip":
+                self._matrix = None
+                self._x = x_src
+                self._idx = idx
+                self._h = h
+                t2 = t * t
+                t3 = t2 * t
+                # cubic Hermite basis
+                self._basis = (
+                    2 * t3 - 3 * t2 + 1,
+                    (t3 - 2 * t2 + t) * h,
+                    -2 * t3 + 3 * t2,
+                    (t3 - t2) * h,
+                )
+            case _:
+                raise ValueError(f"Unknown method {method}")
+
+    def _pchip_slopes(self, y: ArrayType) -> ArrayType:
+        """Fritsch-Carlson slopes, y.shape == [batch, n]"""
+        h = np.diff(self._x)
+        delta = np.diff(y, axis=-1) / h
+
+        d = np.zeros_like(y)
+
+        w1 = 2 * h[1:] + h[:-1]
+        w2 = h[1:] + 2 * h[:-1]
+        d0, d1 = delta[:, :-1], delta[:, 1:]
+        same = (d0 * d1) > 0
+        with np.errstate(divide="ignore", invalid="ignore"):
+            hm = (w1 + w2) / (w1 / d0 + w2 / d1)
+        d[:, 1:-1] = np.where(same, hm, 0.0)
+
+        d[:, 0] = self._edge_slope(h[0], h[1], delta[:, 0], delta[:, 1])
+        d[:, -1] = self._edge_slope(h[-1], h[-2], delta[:, -1], delta[:, -2])
+        return d
+
+    @staticmethod
+    def _edge_slope(h0, h1, m0, m1):
+        d = ((2 * h0 + h1) * m0 - h0 * m1) / (h0 + h1)
+        d = np.where(np.sign(d) != np.sign(m0), 0.0, d)
+        return np.where((np.sign(m0) != np.sign(m1)) & (np.abs(d) > np.abs(3 * m0)), 3 * m0, d)
+
+    def __call__(self, y: ArrayType) -> ArrayType:
+        """y.shape == [..., n_points]  ->  [..., *x_dst.shape]"""
+        y = np.asarray(y, dtype=float)
+        if y.shape[-1] != self._n:
+            raise ValueError(f"Shape mismatch {y.shape} [...,{self._n}]")
+
+        lead = y.shape[:-1]
+        y = y.reshape(-1, self._n)
+
+        if self._order is not None:
+            y = y[:, self._order]
+
+        if self._matrix is not None:
+            res = (self._matrix @ y.T).T
+        else:
+            d = self._pchip_slopes(y) if self._n > 2 else np.repeat(np.diff(y, axis=-1) / self._h[0], 2, axis=-1)
+            i = self._idx
+            b0, b1, b2, b3 = self._basis
+            res = b0 * y[:, i] + b1 * d[:, i] + b2 * y[:, i + 1] + b3 * d[:, i + 1]
+
+        if self._outside is not None and self._outside.size > 0:
+            res[:, self._outside] = np.nan
+
+        return res.reshape(*lead, *self._shape)
+
+
+@functools.lru_cache(maxsize=32)
+def _profile_remap(x_src: bytes, x_dst: bytes, method: str, extrapolate: bool) -> ProfileRemap:
+    return ProfileRemap(np.frombuffer(x_src), np.frombuffer(x_dst), method=method, extrapolate=extrapolate)
+
+
+def profile_remap(
+    x_src: ArrayType, x_dst: ArrayType, method: str = "linear", extrapolate: bool = False
+) -> ProfileRemap:
+    """Cached ProfileRemap"""
+    return _profile_remap(
+        np.ascontiguousarray(x_src, dtype=float).tobytes(),
+        np.ascontiguousarray(x_dst, dtype=float).tobytes(),
+        method,
+        extrapolate,
+    )
+
+
+def remap_profiles(y: ArrayType, x_src: ArrayType, x_dst: ArrayType, method: str = "linear", **kwargs) -> ArrayType:
+    """Remap a batch of profiles y[..., len(x_src)] onto x_dst"""
+    return profile_remap(x_src, x_dst, method=method, **kwargs)(y)
@@ -0,0 +1,215 @@
+""" 求根 Roots of one dimensional functions
+
+- ppoly_roots   : roots of a piecewise polynomial  sum_j c[j,i] (x-x[i])^(k-j) = y, all intervals
+                  at once, by the eigenvalues of the companion matrices (stacked per degree)
+- bracket_roots : vectorized Illinois (modified regula falsi) refinement of many brackets
+- find_roots    : roots of a spline, a compiled Expression or any callable; the piecewise
+                  polynomial roots are refined on the exact function when it is not a polynomial
+"""
+
+import typing
+
+import numpy as np
+from scipy.interpolate import PPoly, BSpline, UnivariateSpline
+
+from spdm.utils.logger import logger
+from spdm.utils.type_hint import ArrayType
+
+
+def _dedupe(roots: ArrayType, tol: float) -> ArrayType:
+    roots = np.sort(roots)
+    if roots.size < 2:
+        return roots
+    keep = np.r_[True, np.diff(roots) > tol]
+    return roots[keep]
+
+
+def _call(func: typing.Callable, x: ArrayType, y: float = 0.0) -> ArrayType:
+    """func(x)-y as a float array of the shape of x (expressions return scalars for one point)"""
+    return np.broadcast_to(np.asarray(func(x), dtype=float), x.shape) - y
+
+
+def ppoly_roots(c: ArrayType, x: ArrayType, y: float = 0.0, tol: float = 1.0e-10) -> ArrayType:
+    """Sorted real roots of the piecewise polynomial (c[k+1, m], x[m+1]) = y inside [x[0], x[-1]]
+
+    Intervals where the polynomial is identically y are skipped (as PPoly.roots reports nan).
+    """
+    c = np.array(c, dtype=float)
+    x = np.asarray(x, dtype=float)
+    k = c.shape[0] - 1
+    h = np.diff(x)
+    c[-1] -= y
+
+    # 归一化变量 u=(x-x_i)/h in [0,1]:  a_j = c_j h^(k-j)
+    a = c * h[None, :] ** np.arange(k, -1, -1)[:, None]
+    scale = np.abs(a).max(axis=0)
+    nonzero = np.abs(a) > 64 * np.finfo(float).eps * scale
+
+    # 有效次数: 最高的非零系数
+    lead = np.where(nonzero.any(axis=0), np.argmax(nonzero, axis=0), k + 1)
+    degree = k - lead
+
+    roots, owner = [], []
+    for d in range(1, k + 1):
+        idx = np.flatnonzero(degree == d)
+        if idx.size == 0:
+            continue
+        coef = a[k - d :, idx].T  # [n, d+1], leading first
+        coef = coef / coef[:, :1]
+        if d == 1:
+            r = -coef[:, 1:2].astype(complex)
+        else:
+            comp = np.zeros((idx.size, d, d))
+            comp[:, 0, :] = -coef[:, 1:]
+            comp[:, np.arange(1, d), np.arange(d - 1)] = 1.0
+            r = np.linalg.eigvals(comp)
+        roots.append(r)
+        owner.append(np.repeat(idx, d).reshape(idx.size, d))
+
+    if len(roots) == 0:
+        return np.zeros(0)
+
+    u = np.concatenate([r.ravel() for r in roots])
+    i = np.concatenate([o.ravel() for o in owner])
+    real = (np.abs(u.imag) <= np.sqrt(tol)) & (u.real >= -tol) & (u.real <= 1 + tol)
+    u, i = np.clip(u.real[real], 0.0, 1.0), i[real]
+
+    # 牛顿迭代修正
+    for _ in range(2):
+        p = np.zeros_like(u)
+        dp = np.zeros_like(u)
+        for j in range(k + 1):
+            dp = dp * u + p
+            p = p * u + a[j, i]
+        with np.errstate(divide="ignore", invalid="ignore"):
+            step = np.where(dp != 0.0, p / dp, 0.0)
+        u = np.clip(u - step, 0.0, 1.0)
+
+    # 只保留确实接近零的根 (夹到端点的虚假根被排除)
+    p = np.zeros_like(u)
+    for j in range(k + 1):
+        p = p * u + a[j, i]
+    ok = np.abs(p) <= np.sqrt(tol) * scale[i]
+
+    return _dedupe(x[i[ok]] + u[ok] * h[i[ok]], tol * (x[-1] - x[0]))
+
+
+def to_ppoly(func) -> PPoly | None:
+    """piecewise polynomial of a 1D spline / compiled Expression, None if there is none"""
+    if isinstance(func, PPoly):
+        return func
+    elif isinstance(func, BSpline):
+        return PPoly.from_spline(func)
+    elif isinstance(func, UnivariateSpline):
+        return PPoly.from_spline(func._eval_args)
+    elif hasattr(func, "ppoly") and not callable(getattr(func, "__compile__", None)):
+        # RectInterpolateOp
+        if len(getattr(func, "_dims", ())) != 1:
+            return None
+        return to_ppoly(func.ppoly)
+    elif callable(getattr(func, "__compile__", None)):
+        try:
+            return to_ppoly(func.__compile__())
+        except Exception as error:  # 定义域不足以编译
+            logger.debug(f"Can not compile {type(func).__name__}: {error}")
+            return None
+    return None
+
+
+def bracket_roots(
+    func: typing.Callable[[ArrayType], ArrayType],
+    a: ArrayType,
+    b: ArrayType,
+    fa: ArrayType = None,
+    fb: ArrayType = None,
+    xtol: float = 1.0e-12,
+    max_iter: int = 100,
+) -> ArrayType:
+    """Refine the brackets [a,b] with f(a)*f(b) <= 0 together, by the Illinois method.
+    func is called once per iteration with all the active points."""
+    a = np.array(a, dtype=float)
+    b = np.array(b, dtype=float)
+    fa = np.array(_call(func, a) if fa is None else fa, dtype=float)
+    fb = np.array(_call(func, b) if fb is None else fb, dtype=float)
+
+    res = np.where(fa == 0.0, a, np.where(fb == 0.0, b, np.nan))
+    active = np.flatnonzero(np.isnan(res) & (fa * fb < 0))
+    side = np.zeros(a.size, dtype=int)  # 上次保留的端点, 连续两次则将其函数值减半
+
+    for _ in range(max_iter):
+        if active.size == 0:
+            break
+        i = active
+        c = b[i] - fb[i] * (b[i] - a[i]) / (fb[i] - fa[i])
+        c = np.where((c > np.minimum(a[i], b[i])) & (c < np.maximum(a[i], b[i])), c, 0.5 * (a[i] + b[i]))
+        fc = _call(func, c)
+
+        left = fc * fb[i] < 0  # 根在 [c, b]
+        a[i] = np.where(left, b[i], a[i])
+        fa[i] = np.where(left, fb[i], fa[i])
+        fa[i] = np.where(~left & (side[i] == -1), 0.5 * fa[i], fa[i])
+        side[i] = np.where(left, 1, -1)
+        b[i], fb[i] = c, fc
+
+        done = (fc == 0.0) | (np.abs(b[i] - a[i]) <= xtol * (1.0 + np.abs(c)))
+        res[i[done]] = c[done]
+        active = i[~done]
+    else:
+        logger.warning(f"bracket_roots: {active.size} brackets do not converge after {max_iter} iterations")
+        res[active] = b[active]
+
+    return res
+
+
+def sample_roots(func: typing.Callable[[ArrayType], ArrayType], x: ArrayType, y: float = 0.0, **kwargs) -> ArrayType:
+    """roots of func(x)=y on the sorted samples x: sign changes, then bracketed refinement"""
+    x = np.asarray(x, dtype=float)
+    f = _call(func, x, y)
+    change = np.flatnonzero(f[:-1] * f[1:] < 0)
+    roots = bracket_roots(lambda v: _call(func, v, y), x[change], x[change + 1], f[change], f[change + 1], **kwargs)
+    return _dedupe(np.r_[roots[~np.isnan(roots)], x[f == 0.0]], 0.0)
+
+
+def find_roots(func, y: float = 0.0, x: ArrayType = None, refine: bool = None, xtol: float = 1.0e-12) -> ArrayType:
+    """Sorted roots of func(x) = y
+
+    Args:
+        func   : spline (PPoly/BSpline/UnivariateSpline), Expression/Function, or callable
+        y      : level
+        x      : sample points, used when func has no piecewise polynomial representation
+        refine : refine the piecewise polynomial roots on the exact func, default: for
+                 expressions defined by an operator (their polynomial is an interpolant)
+    """
+    ppoly = to_ppoly(func)
+
+    if ppoly is None:
+        if x is None:
+            domain = getattr(func, "domain", None)
+            x = domain.coordinates[0] if domain is not None else None
+        if x is None:
+            raise RuntimeError(f"Can not find roots of {type(func).__name__} without sample points!")
+        return sample_roots(func, x, y, xtol=xtol)
+
+    if ppoly.c.ndim != 2:
+        raise NotImplementedError(f"find_roots for vector valued ppoly {ppoly.c.shape}")
+
+    roots = ppoly_roots(ppoly.c, ppoly.x, y)
+
+    if refine is None:
+        refine = callable(getattr(func, "_op", None)) and not isinstance(func, (PPoly, BSpline, UnivariateSpline))
+
+    if refine and roots.size > 0:
+        # 在多项式根附近的小区间内, 对原始表达式做有界迭代
+        bp = ppoly.x
+        i = np.clip(np.searchsorted(bp, roots) - 1, 0, bp.size - 2)
+        delta = 0.5 * (bp[i + 1] - bp[i])
+        a = np.maximum(roots - delta, bp[0])
+        b = np.minimum(roots + delta, bp[-1])
+        f = lambda v: _call(func, v, y)
+        fa, fb = f(a), f(b)
+        ok = fa * fb <= 0
+        roots = roots.copy()
+        roots[ok] = bracket_roots(f, a[ok], b[ok], fa[ok], fb[ok], xtol=xtol)
+        roots = _dedupe(roots, xtol * (bp[-1] - bp[0]))
+
+    return roots
@@ -1,5 +1,24 @@
+""" 平滑 Smoothing of signals, batched along an axis of N-D arrays
+
+- smooth          : window convolution (flat, hanning, hamming, bartlett, blackman)
+- savgol          : Savitzky–Golay filter, the interior and edge coefficients are computed once
+                    per (window, order, deriv, delta) and applied to all signals together
+- moving_average  : running sum, O(1) per sample
+- moving_median   : sliding median
+- PenalizedSpline : Whittaker/P-spline smoother  min sum w (y-z)^2 + lam sum (D^d z)^2 , the
+                    banded system is Cholesky factorized once per sample grid and reused
+                    for every signal
+
+All kernels run in compiled loops of numpy/scipy (ndimage, LAPACK), signals are not iterated
+in Python.
+"""
+
+import functools
 import typing
 import numpy as np
+from scipy import ndimage, sparse
+from scipy.linalg import cho_solve_banded, cholesky_banded
+from scipy.signal import savgol_coeffs
 
 from spdm.utils.logger import logger
 from spdm.utils.type_hint import array_type
@@ -7,7 +26,7 @@ from spdm.numlib.interpolate import interpolate
 from spdm.core.expression import Expression
 
 
-def smooth(x, window_len=11, window="hanning"):
+def smooth(x, window_len=11, window="hanning", axis=-1):
     """smooth the data using a window with requested size.
 
     This method is based on the convolution of a scaled window with the signal.
@@ -41,10 +60,9 @@ def smooth(x, window_len=11, window="hanning"):
     @ref: https://scipy-cookbook.readthedocs.io/items/SignalSmooth.html
     """
 
-    if x.ndim != 1:
-        raise ValueError("smooth only accepts 1 dimension arrays.")
+    x = np.asarray(x)
 
-    if x.size < window_len:
+    if x.shape[axis] < window_len:
         raise ValueError("Input vector needs to be bigger than window size.")
 
     if window_len < 3:
@@ -53,17 +71,113 @@ def smooth(x, window_len=11, window="hanning"):
     if not window in ["flat", "hanning", "hamming", "bartlett", "blackman"]:
         raise ValueError("Window is on of 'flat', 'hanning', 'hamming', 'bartlett', 'blackman'")
 
-    s = np.r_[x[window_len - 1 : 0 : -1], x, x[-2 : -window_len - 1 : -1]]
-
     if window == "flat":  # moving average
         w = np.ones(window_len, "d")
     else:
-        w = eval("np." + window + "(window_len)")
+        w = getattr(np, window)(window_len)
+
+    # 镜像延拓 (不重复端点) 后卷积, 等价于 np.convolve(w/w.sum(), r_[reflect, x, reflect], "same")
+    return ndimage.correlate1d(np.asarray(x, dtype=float), w / w.sum(), axis=axis, mode="mirror")
+
+
+@functools.lru_cache(maxsize=64)
+def _savgol_kernel(window_len: int, order: int, deriv: int, delta: float) -> typing.Tuple[np.ndarray, ...]:
+    """(interior coefficients, left edge matrix, right edge matrix)"""
+    half = window_len // 2
+    coeff = [savgol_coeffs(window_len, order, deriv, delta, pos=p, use="dot") for p in range(window_len)]
+    return coeff[half], np.stack(coeff[:half]), np.stack(coeff[half + 1 :])
+
 
-    res = np.convolve(w / w.sum(), s, mode="same")[window_len - 1 : -window_len + 1]
+def savgol(y, window_len: int, order: int, deriv: int = 0, delta: float = 1.0, axis: int = -1, mode="interp"):
+    """Savitzky–Golay filter of y along axis, the same result as scipy.signal.savgol_filter
+
+    mode "interp": the edges are the values of the polynomial fitted to the first/last window,
+    other modes are passed to ndimage (mirror, nearest, wrap, constant)
+    """
+    if window_len % 2 == 0 or window_len <= order:
+        raise ValueError(f"window_len must be odd and larger than order! {window_len} {order}")
+    y = np.asarray(y, dtype=float)
+    n = y.shape[axis]
+    if mode == "interp" and n < window_len:
+        raise ValueError(f"Input needs to be bigger than window size {n} < {window_len}")
+
+    inner, left, right = _savgol_kernel(window_len, order, deriv, float(delta))
+    res = ndimage.correlate1d(y, inner, axis=axis, mode="mirror" if mode == "interp" else mode)
+
+    if mode == "interp":
+        half = window_len // 2
+        res = np.moveaxis(res, axis, -1)
+        yt = np.moveaxis(y, axis, -1)
+        res[..., :half] = yt[..., :window_len] @ left.T
+        res[..., n - half :] = yt[..., n - window_len :] @ right.T
+        res = np.moveaxis(res, -1, axis)
     return res
 
 
+def moving_average(y, window_len: int, axis: int = -1, mode="mirror"):
+    """centered moving average, running sum O(1) per sample"""
+    return ndimage.uniform_filter1d(np.asarray(y, dtype=float), window_len, axis=axis, mode=mode)
+
+
+def moving_median(y, window_len: int, axis: int = -1, mode="mirror"):
+    """centered moving median along axis"""
+    y = np.asarray(y, dtype=float)
+    return ndimage.median_filter(y, size=window_len, axes=[axis % y.ndim], mode=mode)
+
+
+def _difference_matrix(x: np.ndarray, d: int) -> sparse.csr_matrix:
+    """d-th divided differences (scaled by d!) on the sorted grid x, shape [n-d, n]"""
+    D = sparse.identity(x.size, format="csr")
+    for k in range(1, d + 1):
+        D = sparse.diags(k / (x[k:] - x[:-k])) @ (D[1:] - D[:-1])
+    return D
+
+
+class PenalizedSpline:
+    """Whittaker/P-spline smoother on the grid x
+
+    z = argmin  sum_i w_i (y_i - z_i)^2 + lam sum_j (D^d z)_j^2
+    where D^d is the d-th divided difference. (W + lam D^T D) is banded (bandwidth d) and
+    symmetric positive definite, it is factorized once and solved for all signals at once.
+    """
+
+    def __init__(self, x, lam: float, order: int = 2, w=None):
+        x = np.asarray(x, dtype=float)
+        if x.ndim != 1 or np.any(np.diff(x) <= 0):
+            raise ValueError("x must be 1D and strictly increasing")
+        if x.size <= order:
+            raise ValueError(f"Too few points {x.size} for order {order}")
+        self._n = x.size
+        self._w = np.ones(x.size) if w is None else np.asarray(w, dtype=float)
+
+        D = _difference_matrix(x, order)
+        A = (sparse.diags(self._w) + lam * (D.T @ D)).todia()
+        ab = np.zeros((order + 1, x.size))
+        for k in range(order + 1):  # upper form: ab[order-k, j] = A[j-k, j]
+            ab[order - k, k:] = A.diagonal(k)
+        self._factor = cholesky_banded(ab)
+
+    def __call__(self, y, axis: int = -1):
+        y = np.moveaxis(np.asarray(y, dtype=float), axis, 0)
+        if y.shape[0] != self._n:
+            raise ValueError(f"Shape mismatch {y.shape[0]}!={self._n}")
+        rhs = self._w[:, None] * y.reshape(self._n, -1)
+        z = cho_solve_banded((self._factor, False), rhs)
+        return np.moveaxis(z.reshape(y.shape), 0, axis)
+
+
+@functools.lru_cache(maxsize=32)
+def _penalized_spline(x: bytes, lam: float, order: int) -> PenalizedSpline:
+    return PenalizedSpline(np.frombuffer(x), lam, order)
+
+
+def penalized_spline(x, y, lam: float, order: int = 2, axis: int = -1, w=None):
+    """smooth y sampled at x along axis, the factorization is cached for unweighted calls"""
+    if w is not None:
+        return PenalizedSpline(x, lam, order, w)(y, axis)
+    return _penalized_spline(np.ascontiguousarray(x, dtype=float).tobytes(), float(lam), order)(y, axis)
+
+
 def smooth_1d(x, y, i_begin=0, i_end=None, **kwargs):
     dy = interpolate(x, y).derivative()(x)
     dy[i_begin:i_end] = smooth(dy[i_begin:i_end], **kwargs)
@@ -0,0 +1,367 @@
+""" 空间索引 Spatial indexing
+
+- BBoxTree : R-tree over axis aligned boxes, bulk loaded by Sort-Tile-Recursive (STR) packing.
+             Queries are vectorized over all points: the tree is descended level by level
+             with arrays of (point, node) candidate pairs.
+- SegmentIndex : ray/segment - polyline intersection, BBoxTree (BVH) over the wall segments.
+- PolygonIndex : point in polygon by winding number, edges bucketed into horizontal slabs.
+"""
+
+import functools
+import typing
+
+import numpy as np
+
+from spdm.utils.type_hint import ArrayType
+
+
+class BBoxTree:
+    """R-tree over n boxes [lo, hi]
+
+    Args:
+        lo, hi : shape [n, ndim]
+        fanout : maximum number of children per node
+    """
+
+    def __init__(self, lo: ArrayType, hi: ArrayType, fanout: int = 8) -> None:
+        lo = np.atleast_2d(np.asarray(lo, dtype=float))
+        hi = np.atleast_2d(np.asarray(hi, dtype=float))
+
+        if lo.shape != hi.shape:
+            raise ValueError(f"Shape mismatch {lo.shape} {hi.shape}")
+
+        self._ndim = lo.shape[1]
+        self._fanout = fanout
+        self._size = lo.shape[0]
+
+        order = self._str_order(0.5 * (lo + hi), fanout)
+
+        self._items = order  # leaf slot -> box index
+        self._lo = lo
+        self._hi = hi
+
+        # levels[0] is the leaf level; every level stores node boxes and the child range
+        levels = []
+        c_lo, c_hi = lo[order], hi[order]
+        while True:
+            n = c_lo.shape[0]
+            start = np.arange(0, n, fanout)
+            stop = np.minimum(start + fanout, n)
+            n_lo = np.minimum.reduceat(c_lo, start, axis=0)
+            n_hi = np.maximum.reduceat(c_hi, start, axis=0)
+            levels.append((n_lo, n_hi, start, stop))
+            if n_lo.shape[0] == 1:
+                break
+            c_lo, c_hi = n_lo, n_hi
+
+        self._levels = levels[::-1]  # root first
+
+    @staticmethod
+    def _str_order(center: ArrayType, fanout: int) -> ArrayType:
+        n, ndim = center.shape
+        n_leaf = int(np.ceil(n / fanout))
+        slices = int(np.ceil(n_leaf ** (1.0 / ndim)))
+
+        def _sort(idx: ArrayType, axis: int) -> ArrayType:
+            idx = idx[np.argsort(center[idx, axis], kind="stable")]
+            if axis == ndim - 1:
+                return idx
+            chunk = int(np.ceil(idx.size / slices))
+            return np.concatenate([_sort(idx[i : i + chunk], axis + 1) for i in range(0, idx.size, chunk)])
+
+        return _sort(np.arange(n), 0)
+
+    @property
+    def size(self) -> int:
+        return self._size
+
+    def _descend(self, n: int, test: typing.Callable[[ArrayType, ArrayType, ArrayType], ArrayType]):
+        """All (query, box) pairs passing test(query index, lo, hi) -> bool, for n queries"""
+        p_idx = np.arange(n)
+        n_idx = np.zeros_like(p_idx)
+
+        for n_lo, n_hi, start, stop in self._levels:
+            inside = test(p_idx, n_lo[n_idx], n_hi[n_idx])
+            p_idx, n_idx = p_idx[inside], n_idx[inside]
+            count = stop[n_idx] - start[n_idx]
+            p_idx = np.repeat(p_idx, count)
+            offset = np.arange(count.sum()) - np.repeat(np.cumsum(count) - count, count)
+            n_idx = np.repeat(start[n_idx], count) + offset
+
+        box = self._items[n_idx]
+        inside = test(p_idx, self._lo[box], self._hi[box])
+        return p_idx[inside], box[inside]
+
+    def _descend_points(self, points: ArrayType) -> typing.Tuple[ArrayType, ArrayType]:
+        return self._descend(points.shape[0], lambda p, lo, hi: np.all((points[p] >= lo) & (points[p] <= hi), axis=-1))
+
+    def query_rays(
+        self, origin: ArrayType, direction: ArrayType, t_min: float | ArrayType = 0.0, t_max: float | ArrayType = np.inf
+    ) -> typing.Tuple[ArrayType, ArrayType]:
+        """(ray index, box index) of every box hit by the rays  origin + t*direction, t in [t_min, t_max]"""
+        origin = np.atleast_2d(np.asarray(origin, dtype=float))
+        direction = np.atleast_2d(np.asarray(direction, dtype=float))
+        origin, direction = np.broadcast_arrays(origin, direction)
+        t_min = np.broadcast_to(np.asarray(t_min, dtype=float), origin.shape[:1])
+        t_max = np.broadcast_to(np.asarray(t_max, dtype=float), origin.shape[:1])
+        parallel = direction == 0.0
+        with np.errstate(divide="ignore"):
+            inv = 1.0 / np.where(parallel, 1.0, direction)
+
+        def _slab(r, lo, hi):
+            o, v, par = origin[r], inv[r], parallel[r]
+            t0, t1 = (lo - o) * v, (hi - o) * v
+            inside = (o >= lo) & (o <= hi)
+            near = np.where(par, np.where(inside, -np.inf, np.inf), np.minimum(t0, t1)).max(axis=-1)
+            far = np.where(par, np.where(inside, np.inf, -np.inf), np.maximum(t0, t1)).min(axis=-1)
+            return (near <= far) & (far >= t_min[r]) & (near <= t_max[r])
+
+        return self._descend(origin.shape[0], _slab)
+
+    def query_pairs(self, points: ArrayType) -> typing.Tuple[ArrayType, ArrayType]:
+        """(point index, box index) of every containing box. points.shape == [m, ndim]"""
+        return self._descend_points(np.atleast_2d(np.asarray(points, dtype=float)))
+
+    def locate(self, points: ArrayType) -> ArrayType:
+        """Index of the first (lowest index) box containing each point, -1 if none"""
+        points = np.atleast_2d(np.asarray(points, dtype=float))
+        p_idx, box = self._descend_points(points)
+        res = np.full(points.shape[0], self._size, dtype=int)
+        np.minimum.at(res, p_idx, box)
+        res[res == self._size] = -1
+        return res
+
+    def intersect(self, lo: ArrayType, hi: ArrayType) -> ArrayType:
+        """Indices of the boxes overlapping the box [lo, hi]"""
+        lo = np.asarray(lo, dtype=float)
+        hi = np.asarray(hi, dtype=float)
+        n_idx = np.zeros(1, dtype=int)
+        for n_lo, n_hi, start, stop in self._levels:
+            ok = np.all((n_lo[n_idx] <= hi) & (n_hi[n_idx] >= lo), axis=-1)
+            n_idx = n_idx[ok]
+            n_idx = np.concatenate([np.arange(b, e) for b, e in zip(start[n_idx], stop[n_idx])] or [n_idx[:0]])
+        box = self._items[n_idx]
+        ok = np.all((self._lo[box] <= hi) & (self._hi[box] >= lo), axis=-1)
+        return np.sort(box[ok])
+
+
+class SegmentIndex:
+    """Intersection of rays with polylines (walls, limiters) in 2D
+
+    The wall segments are kept in a BBoxTree (bounding volume hierarchy), candidate
+    (ray, segment) pairs come from a vectorized descent with the slab test.
+
+    Args:
+        vertices : [N, 2] polylines one after another
+        offsets  : [m+1]  polyline k is vertices[offsets[k]:offsets[k+1]], default: one polyline
+        closed   : close every polyline (append the segment last -> first)
+    """
+
+    def __init__(self, vertices: ArrayType, offsets: ArrayType = None, closed: bool = False, fanout: int = 8):
+        vertices = np.asarray(vertices, dtype=float)
+        if vertices.ndim != 2 or vertices.shape[1] != 2:
+            raise ValueError(f"Illegal vertices {vertices.shape}, should be [n,2]")
+        if offsets is None:
+            offsets = [0, vertices.shape[0]]
+        offsets = np.asarray(offsets, dtype=int)
+
+        nxt = np.arange(1, vertices.shape[0] + 1)
+        nxt[offsets[1:] - 1] = offsets[:-1] if closed else -1
+        start = np.flatnonzero(nxt >= 0)
+
+        # segment k : vertices[start[k]] -> vertices[nxt[start[k]]], numbered along the polylines
+        self._a = vertices[start]
+        self._b = vertices[nxt[start]]
+        self._vertex = start
+        self._tree = BBoxTree(np.minimum(self._a, self._b), np.maximum(self._a, self._b), fanout=fanout)
+
+    @property
+    def size(self) -> int:
+        return self._a.shape[0]
+
+    @property
+    def vertex(self) -> ArrayType:
+        """index of the first vertex of every segment"""
+        return self._vertex
+
+    def hits(
+        self, origin: ArrayType, direction: ArrayType, t_min: float | ArrayType = 0.0, t_max: float | ArrayType = np.inf
+    ) -> typing.Tuple[ArrayType, ArrayType, ArrayType]:
+        """All crossings of the rays origin + t*direction (t in [t_min, t_max]) with the segments
+
+        Returns:
+            ray, t, segment : sorted by ray then t; a crossing through a shared vertex is reported once
+        """
+        origin = np.atleast_2d(np.asarray(origin, dtype=float))
+        direction = np.atleast_2d(np.asarray(direction, dtype=float))
+        origin, direction = np.broadcast_arrays(origin, direction)
+        t_min = np.broadcast_to(np.asarray(t_min, dtype=float), origin.shape[:1])
+        t_max = np.broadcast_to(np.asarray(t_max, dtype=float), origin.shape[:1])
+
+        ray, seg = self._tree.query_rays(origin, direction, t_min, t_max)
+
+        d = direction[ray]
+        e = self._b[seg] - self._a[seg]
+        w = self._a[seg] - origin[ray]
+        denom = d[:, 0] * e[:, 1] - d[:, 1] * e[:, 0]
+        with np.errstate(divide="ignore", invalid="ignore"):
+            t = (w[:, 0] * e[:, 1] - w[:, 1] * e[:, 0]) / denom
+            u = (w[:, 0] * d[:, 1] - w[:, 1] * d[:, 0]) / denom
+        ok = (denom != 0.0) & (u >= 0.0) & (u <= 1.0) & (t >= t_min[ray]) & (t <= t_max[ray])
+        ray, t, seg = ray[ok], t[ok], seg[ok]
+
+        order = np.lexsort((seg, t, ray))
+        ray, t, seg = ray[order], t[order], seg[order]
+        dup = np.zeros(ray.size, dtype=bool)
+        dup[1:] = (ray[1:] == ray[:-1]) & np.isclose(t[1:], t[:-1], rtol=1.0e-12, atol=1.0e-14)
+        return ray[~dup], t[~dup], seg[~dup]
+
+    def intersect(
+        self, origin: ArrayType, direction: ArrayType, t_min: float | ArrayType = 0.0, t_max: float | ArrayType = np.inf
+    ) -> typing.Tuple[ArrayType, ArrayType, ArrayType, ArrayType]:
+        """First (entry) and last (exit) crossing of every ray
+
+        Returns:
+            t_in, t_out   : ray parameters, nan if the ray misses the walls
+            seg_in, seg_out : segment indices, -1 if missed
+        """
+        n = np.broadcast_shapes(np.shape(np.atleast_2d(origin)), np.shape(np.atleast_2d(direction)))[0]
+        ray, t, seg = self.hits(origin, direction, t_min, t_max)
+
+        t_in = np.full(n, np.nan)
+        t_out = np.full(n, np.nan)
+        seg_in = np.full(n, -1, dtype=int)
+        seg_out = np.full(n, -1, dtype=int)
+
+        if ray.size > 0:
+            first = np.flatnonzero(np.r_[True, ray[1:] != ray[:-1]])
+            last = np.r_[first[1:] - 1, ray.size - 1]
+            t_in[ray[first]], seg_in[ray[first]] = t[first], seg[first]
+            t_out[ray[last]], seg_out[ray[last]] = t[last], seg[last]
+
+        return t_in, t_out, seg_in, seg_out
+
+
+class PolygonIndex:
+    """Point in polygon test by winding number, for a polygon made of one or more rings
+
+    The edges are bucketed into horizontal slabs of equal height, a point only visits the
+    edges of its own slab (those that can cross the ray from the point towards +x).
+    Points are processed in blocks to bound the size of the (point, edge) pair arrays.
+
+    Args:
+        vertices : [N, 2], rings one after another; a ring is closed implicitly
+        offsets  : [m+1],  ring k is vertices[offsets[k]:offsets[k+1]], default: one ring
+        n_slab   : number of slabs, default ~ number of edges
+        rule     : "nonzero" or "evenodd"
+    """
+
+    def __init__(
+        self,
+        vertices: ArrayType,
+        offsets: ArrayType = None,
+        n_slab: int = None,
+        rule: str = "nonzero",
+        block: int = 1 << 20,
+    ) -> None:
+        vertices = np.asarray(vertices, dtype=float)
+        if vertices.ndim != 2 or vertices.shape[1] != 2:
+            raise ValueError(f"Illegal vertices {vertices.shape}, should be [n,2]")
+        if offsets is None:
+            offsets = [0, vertices.shape[0]]
+        offsets = np.asarray(offsets, dtype=int)
+
+        # 每个环的边 (i -> next(i)), 末点与首点重合的边长为零, 不影响结果
+        nxt = np.arange(1, vertices.shape[0] + 1)
+        nxt[offsets[1:] - 1] = offsets[:-1]
+        p0, p1 = vertices, vertices[nxt]
+        keep = p0[:, 1] != p1[:, 1]  # 水平边不与射线相交
+        self._p0, self._p1 = p0[keep], p1[keep]
+
+        self._lo = vertices.min(axis=0)
+        self._hi = vertices.max(axis=0)
+        self._rule = rule
+        self._block = block
+
+        n_edge = self._p0.shape[0]
+        self._n_slab = n_slab = max(1, n_edge if n_slab is None else n_slab)
+        height = (self._hi[1] - self._lo[1]) / n_slab or 1.0
+        self._height = height
+
+        y0 = np.minimum(self._p0[:, 1], self._p1[:, 1])
+        y1 = np.maximum(self._p0[:, 1], self._p1[:, 1])
+        s0 = np.clip(((y0 - self._lo[1]) // height).astype(int), 0, n_slab - 1)
+        s1 = np.clip(((y1 - self._lo[1]) // height).astype(int), 0, n_slab - 1)
+        count = s1 - s0 + 1
+        edge = np.repeat(np.arange(n_edge), count)
+        slab = np.repeat(s0, count) + np.arange(count.sum()) - np.repeat(np.cumsum(count) - count, count)
+
+        # CSR: slab -> edges
+        order = np.argsort(slab, kind="stable")
+        self._edges = edge[order]
+        self._start = np.searchsorted(slab[order], np.arange(n_slab + 1))
+
+    def winding(self, x: ArrayType, y: ArrayType) -> ArrayType:
+        """winding number of the polygon around the points, x,y are flat arrays"""
+        res = np.zeros(x.shape, dtype=int)
+        inside = (x >= self._lo[0]) & (x <= self._hi[0]) & (y >= self._lo[1]) & (y <= self._hi[1])
+        idx = np.flatnonzero(inside)
+        slab = np.clip(((y[idx] - self._lo[1]) // self._height).astype(int), 0, self._n_slab - 1)
+        count = self._start[slab + 1] - self._start[slab]
+
+        # 按块处理, 每块的 (点,边) 对数不超过 block
+        bounds = np.searchsorted(np.cumsum(count), np.arange(0, count.sum(), self._block), side="right")
+        for b, e in zip(bounds, [*bounds[1:], idx.size]):
+            c = count[b:e]
+            p = np.repeat(idx[b:e], c)
+            k = self._edges[np.repeat(self._start[slab[b:e]], c) + np.arange(c.sum()) - np.repeat(np.cumsum(c) - c, c)]
+            px, py = x[p], y[p]
+            (x0, y0), (x1, y1) = self._p0[k].T, self._p1[k].T
+            side = (x1 - x0) * (py - y0) - (px - x0) * (y1 - y0)
+            up = (y0 <= py) & (y1 > py) & (side > 0)
+            down = (y1 <= py) & (y0 > py) & (side < 0)
+            np.add.at(res, p[up], 1)
+            np.add.at(res, p[down], -1)
+        return res
+
+    def __call__(self, *x: ArrayType) -> bool | ArrayType:
+        """Boolean mask of the points inside; x is (x, y) or an array [..., 2]"""
+        if len(x) == 1:
+            x = np.moveaxis(np.asarray(x[0], dtype=float), -1, 0)
+        x, y = np.broadcast_arrays(*[np.asarray(v, dtype=float) for v in x])
+        w = self.winding(x.ravel(), y.ravel())
+        res = (w != 0) if self._rule == "nonzero" else (w % 2 == 1)
+        return bool(res[0]) if x.ndim == 0 else res.reshape(x.shape)
+
+
+@functools.lru_cache(maxsize=32)
+def _polygon_index(vertices: bytes, offsets: bytes, rule: str) -> PolygonIndex:
+    return PolygonIndex(
+        np.frombuffer(vertices).reshape(-1, 2),
+        None if len(offsets) == 0 else np.frombuffer(offsets, dtype=int),
+        rule=rule,
+    )
+
+
+def polygon_index(vertices: ArrayType, offsets: ArrayType = None, rule: str = "nonzero") -> PolygonIndex:
+    """Cached PolygonIndex"""
+    return _polygon_index(
+        np.ascontiguousarray(vertices, dtype=float).tobytes(),
+        b"" if offsets is None else np.ascontiguousarray(offsets, dtype=int).tobytes(),
+        rule,
+    )
+
+
+def points_in_polygon(vertices: ArrayType, *x: ArrayType, offsets: ArrayType = None, rule: str = "nonzero"):
+    """Boolean mask of the points x inside the polygon"""
+    return polygon_index(vertices, offsets, rule)(*x)
+
+
+@functools.lru_cache(maxsize=32)
+def _segment_index(vertices: bytes, closed: bool) -> SegmentIndex:
+    return SegmentIndex(np.frombuffer(vertices).reshape(-1, 2), closed=closed)
+
+
+def segment_index(vertices: ArrayType, closed: bool = False) -> SegmentIndex:
+    """Cached SegmentIndex of a single polyline"""
+    return _segment_index(np.ascontiguousarray(vertices, dtype=float).tobytes(), closed)
@@ -0,0 +1,231 @@
+""" 有限差分模板 Finite-difference stencils
+
+Weights are generated with Fornberg's algorithm, so uniform and non-uniform
+axes are handled alike. Near a non-periodic boundary the stencil is shifted
+inside the grid (one-sided closure) and keeps the same number of points.
+
+@ref: B. Fornberg, "Generation of finite difference formulas on arbitrarily spaced grids",
+      Math. Comp. 51 (1988) 699-706
+"""
+
+import functools
+import typing
+
+import numpy as np
+
+from spdm.utils.type_hint import ArrayType
+
+
+def fornberg_weights(z: float, x: ArrayType, m: int) -> ArrayType:
+    """Weights of the m-th derivative at z using the nodes x.
+
+    Returns:
+        c : shape [len(x)],  f^(m)(z) ~ sum(c*f(x))
+    """
+    n = len(x)
+    c = np.zeros((n, m + 1))
+    c1 = 1.0
+    c4 = x[0] - z
+    c[0, 0] = 1.0
+    for i in range(1, n):
+        mn = min(i, m)
+        c2 = 1.0
+        c5 = c4
+        c4 = x[i] - z
+        for j in range(i):
+            c3 = x[i] - x[j]
+            c2 = c2 * c3
+            if j == i - 1:
+                for k in range(mn, 0, -1):
+                    c[i, k] = c1 * (k * c[i - 1, k - 1] - c5 * c[i - 1, k]) / c2
+                c[i, 0] = -c1 * c5 * c[i - 1, 0] / c2
+            for k in range(mn, 0, -1):
+                c[j, k] = (c4 * c[j, k] - k * c[j, k - 1]) / c3
+            c[j, 0] = c4 * c[j, 0] / c3
+        c1 = c2
+    return c[:, m]
+
+
+class Stencil:
+    """1D finite-difference operator  d^order/dx^order  on the grid x
+
+    Args:
+        x       : grid points, monotonically increasing
+        order   : order of the derivative
+        accuracy: order of accuracy of the central stencil (even)
+        period  : period length of a periodic axis. x must not repeat the first point.
+
+    The operator is stored as `weights` [n, width] and `start` [n]; the derivative
+    at point i is  sum_k weights[i,k] * y[start[i]+k]  (indices taken modulo n if periodic).
+    """
+
+    def __init__(self, x: ArrayType, order: int = 1, accuracy: int = 2, period: float = None) -> None:
+        x = np.asarray(x, dtype=float)
+        n = x.size
+
+        half = (order + 1) // 2 - 1 + (accuracy + 1) // 2
+        width = 2 * half + 1
+
+        if width > n:
+            raise ValueError(f"Grid is too small for stencil: {n} points < width {width}")
+
+        self._order = order
+        self._n = n
+        self._width = width
+        self._period = period
+
+        h = np.diff(x)
+        self._uniform = np.allclose(h, h[0], rtol=1.0e-10, atol=0.0)
+
+        offset = np.arange(width)
+        if period is not None:
+            start = np.arange(n) - half
+            xx = np.concatenate([x[-half:] - period, x, x[:half] + period]) if half > 0 else x
+            nodes = xx[(start + half)[:, None] + offset[None, :]]
+        else:
+            start = np.clip(np.arange(n) - half, 0, n - width)
+            nodes = x[start[:, None] + offset[None, :]]
+
+        if self._uniform:
+            # only n_boundary+1 distinct stencils on a uniform grid
+            rel = (nodes - x[:, None]) / h[0]
+            w = {}
+            weights = np.empty((n, width))
+            for i in range(n):
+                key = int(round(rel[i, 0]))
+                if key not in w:
+                    w[key] = fornberg_weights(0.0, rel[i], order)
+                weights[i] = w[key]
+            weights /= h[0] ** order
+        else:
+            weights = np.asarray([fornberg_weights(x[i], nodes[i], order) for i in range(n)])
+
+        self._half = half
+        self._start = start
+        self._weights = weights
+
+    @property
+    def width(self) -> int:
+        return self._width
+
+    @property
+    def weights(self) -> ArrayType:
+        return self._weights
+
+    @property
+    def start(self) -> ArrayType:
+        return self._start
+
+    def apply(self, y: ArrayType, axis: int = 0, out: ArrayType = None, block: int = 1 << 16) -> ArrayType:
+        """Apply the stencil along `axis` of y.
+
+        The interior of a uniform grid is done by shifted slices (no gather), boundary rows by gather.
+        Leading axes are processed in blocks of about `block` elements so that the working set
+        stays in cache and no temporaries of the full size are created.
+        """
+        y = np.asarray(y)
+        if y.shape[axis] != self._n:
+            raise ValueError(f"Shape mismatch {y.shape}[{axis}] != {self._n}")
+
+        y = np.moveaxis(y, axis, -1)
+        if out is None:
+            out = np.empty(y.shape, dtype=np.result_type(y.dtype, float))
+            res = out
+            out = np.moveaxis(out, -1, axis)
+        else:
+            res = np.moveaxis(out, axis, -1)
+            if not res.flags.c_contiguous:
+                res = np.empty(res.shape, dtype=res.dtype)
+
+        lead = int(np.prod(y.shape[:-1], dtype=int))
+        y2 = y.reshape(lead, self._n)
+        r2 = res.reshape(lead, self._n)
+
+        rows = max(1, block // self._n)
+        tmp = np.empty((min(rows, lead), self._n), dtype=r2.dtype)
+
+        for b in range(0, lead, rows):
+            yb = y2[b : b + rows]
+            rb = r2[b : b + rows]
+            self._apply_2d(yb, rb, tmp[: yb.shape[0]])
+
+        if not np.shares_memory(res, out):
+            out[...] = np.moveaxis(res, -1, axis)
+        return out
+
+    def _apply_2d(self, y: ArrayType, res: ArrayType, tmp: ArrayType):
+        n, w, half = self._n, self._width, self._half
+
+        if self._uniform and self._period is None:
+            lo, hi = half, n - half
+            res[:, lo:hi] = 0.0
+            for k in range(w):
+                np.multiply(y[:, k : k + hi - lo], self._weights[lo, k], out=tmp[:, : hi - lo])
+                res[:, lo:hi] += tmp[:, : hi - lo]
+            edge = np.r_[0:lo, hi:n]
+        elif self._uniform:
+            # res[:, i] += w_k * y[:, (i + k - half) % n], 分为内部与回绕两段, 不复制 y
+            res[...] = 0.0
+            for k in range(w):
+                s = (k - half) % n
+                np.multiply(y[:, s:], self._weights[0, k], out=tmp[:, : n - s])
+                res[:, : n - s] += tmp[:, : n - s]
+                if s > 0:
+                    np.multiply(y[:, :s], self._weights[0, k], out=tmp[:, :s])
+                    res[:, n - s :] += tmp[:, :s]
+            return
+        else:
+            edge = np.arange(n)
+
+        if edge.size > 0:
+            idx = (self._start[edge, None] + np.arange(w)[None, :]) % n
+            res[:, edge] = np.einsum("rek,ek->re", y[:, idx], self._weights[edge])
+
+    def __call__(self, y: ArrayType, axis: int = 0, **kwargs) -> ArrayType:
+        return self.apply(y, axis=axis, **kwargs)
+
+
+@functools.lru_cache(maxsize=64)
+def _stencil(x: bytes, order: int, accuracy: int, period: float | None) -> Stencil:
+    return Stencil(np.frombuffer(x, dtype=float), order=order, accuracy=accuracy, period=period)
+
+
+def stencil(x: ArrayType, order: int = 1, accuracy: int = 2, period: float = None) -> Stencil:
+    """Cached Stencil for the grid x"""
+    return _stencil(np.ascontiguousarray(x, dtype=float).tobytes(), order, accuracy, period)
+
+
+def partial_derivative(
+    y: ArrayType,
+    *dims: ArrayType,
+    order: typing.Sequence[int],
+    accuracy: int = 2,
+    periods: typing.Sequence[float | None] = None,
+) -> ArrayType:
+    """Partial derivative of y on the rectilinear grid dims.
+
+    Mixed partials are obtained by applying the 1D stencils axis by axis.
+    A periodic axis may include the repeated end point (x[-1]==x[0]+period);
+    it is dropped for the stencil and restored afterwards.
+    """
+    if len(order) != len(dims):
+        raise ValueError(f"len(order) != ndim {order} {len(dims)}")
+
+    res = np.asarray(y, dtype=float)
+
+    for axis, (x, m) in enumerate(zip(dims, order)):
+        if m == 0:
+            continue
+
+        period = periods[axis] if periods is not None else None
+
+        if period is None:
+            res = stencil(x, m, accuracy).apply(res, axis=axis)
+        elif np.isclose(x[-1] - x[0], period):
+            sub = np.take(res, np.arange(x.size - 1), axis=axis)
+            sub = stencil(x[:-1], m, accuracy, period).apply(sub, axis=axis)
+            res = np.concatenate([sub, np.take(sub, [0], axis=axis)], axis=axis)
+        else:
+            res = stencil(x, m, accuracy, period).apply(res, axis=axis)
+
+    return res
@@ -10,6 +10,13 @@ if SP_DEBUG in (True, "true", "on"):
 
 SP_LABEL = os.environ.get("SP_LABEL", __package__[: __package__.find(".")])
 
+# 并行调度 (model.scheduler) 的缺省并发数 (1: 顺序执行, 0: 按 CPU 数) 与执行器 "thread" | "process"
+SP_MAX_WORKERS = int(os.environ.get("SP_MAX_WORKERS", 1)) or None
+SP_EXECUTOR = os.environ.get("SP_EXECUTOR", "thread")
+
+# Process 结果缓存 (model.result_store) 的磁盘目录
+SP_CACHE_DIR = os.environ.get("SP_CACHE_DIR", None)
+
 SP_MPI = None
 SP_MPI_RANK = 0
 SP_MPI_SIZE = 0
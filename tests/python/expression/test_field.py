@@ -5,6 +5,7 @@ import scipy.constants
 
 from spdm.core.expression import Variable
 from spdm.core.field import Field
+from spdm.mesh.mesh_rectilinear import RectilinearMesh
 from spdm.utils.logger import logger
 
 TWOPI = scipy.constants.pi * 2.0
@@ -75,6 +76,21 @@ class TestField(unittest.TestCase):
 
         self.assertTrue(np.allclose(np.mean(Z - 1), z.mean() - 1, rtol=1.0e-4))
 
+    def test_grad(self):
+        x = np.linspace(0, 1, 33)
+        y = np.linspace(0, 2, 41)
+        g_x, g_y = np.meshgrid(x, y, indexing="ij")
+        Z = Field(g_x**2 * g_y, mesh=RectilinearMesh(x, y))
+
+        dx, dy = Z.grad()
+        self.assertTrue(np.allclose(dx(g_x, g_y), 2 * g_x * g_y))
+        self.assertTrue(np.allclose(dy(g_x, g_y), g_x**2))
+
+        dxx, dxy, dyy = Z.grad(2)
+        self.assertTrue(np.allclose(dxx(g_x, g_y), 2 * g_y))
+        self.assertTrue(np.allclose(dxy(g_x, g_y), 2 * g_x))
+        self.assertTrue(np.allclose(dyy(g_x, g_y), 0))
+
 
 if __name__ == "__main__":
     unittest.main()
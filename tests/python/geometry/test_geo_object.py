@@ -3,7 +3,7 @@ import unittest
 from numpy.testing import assert_array_equal
 
 
-from spdm.core.geo_object import GeoObject
+from spdm.core.geo_object import GeoObject, BBox
 
 
 class TestGeoObject(unittest.TestCase):
@@ -32,6 +32,30 @@ class TestGeoObject(unittest.TestCase):
         self.assertEqual(p.z, 12)
         assert_array_equal(p.points, (10, 12))
 
+    def test_bbox_set_operation(self):
+        a = BBox([0, 0], [2, 2])
+        b = BBox([1, -1], [3, 2])
+
+        u = a.union(b)
+        assert_array_equal(u.origin, [0, -1])
+        assert_array_equal(u.dimensions, [4, 3])
+
+        c = a & b
+        assert_array_equal(c.origin, [1, 0])
+        assert_array_equal(c.dimensions, [1, 1])
+
+        self.assertIsNone(a.intersection(BBox([3, 3], [1, 1])))
+        self.assertTrue((a & BBox([2, 0], [1, 1])).is_degraded)
+
+    def test_bbox_equal(self):
+        a = BBox([0, 0], [2, 2])
+        self.assertEqual(a, BBox([0.0, 0.0], [2.0, 2.0 + 1.0e-12]))
+        self.assertNotEqual(a, BBox([0, 0], [2, 3]))
+        self.assertNotEqual(a, BBox([0, 0, 0], [2, 2, 2]))
+        self.assertNotEqual(a, None)
+        with self.assertRaises(TypeError):
+            hash(a)
+
 
 if __name__ == "__main__":
     unittest.main()
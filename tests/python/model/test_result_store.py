@@ -0,0 +1,110 @@
+import tempfile
+import unittest
+
+import numpy as np
+
+from spdm.core.sp_tree import SpTree
+from spdm.model.process import Process
+from spdm.model.result_store import ResultStore, fingerprint
+
+
+class Square(Process, SpTree):
+    calls = 0
+
+    class InPorts(Process.InPorts):
+        x: float
+
+    class OutPorts(Process.OutPorts):
+        y: float
+
+    def execute(self, x=None, **kwargs):
+        Square.calls += 1
+        return {"y": x * x}
+
+
+class Opaque:
+    def __init__(self, value):
+        self.value = value
+
+
+class Tagged(Opaque):
+    @property
+    def fingerprint(self) -> str:
+        return str(self.value)
+
+
+class TestResultStore(unittest.TestCase):
+    def setUp(self) -> None:
+        self.tmp = tempfile.TemporaryDirectory()
+
+    def tearDown(self) -> None:
+        self.tmp.cleanup()
+
+    def test_fingerprint(self):
+        a = np.arange(6.0).reshape(2, 3)
+        self.assertEqual(fingerprint({"a": a, "b": [1, "x"]}), fingerprint({"b": [1, "x"], "a": a.copy()}))
+        self.assertNotEqual(fingerprint(a), fingerprint(a.astype(np.float32)))
+        self.assertNotEqual(fingerprint(a), fingerprint(a.T))
+        self.assertNotEqual(fingerprint(1), fingerprint(1.0))
+        self.assertEqual(fingerprint({"b", "a"}), fingerprint({"a", "b"}))
+        with self.assertRaises(TypeError):
+            fingerprint(lambda x: x)
+        # 未知类型不缓存, 除非定义 fingerprint
+        with self.assertRaises(TypeError):
+            fingerprint(Opaque(1))
+        self.assertIsNone(ResultStore(False).key(Square(), {"x": Opaque(1)}))
+        self.assertEqual(fingerprint(Tagged(1)), fingerprint(Tagged(1)))
+        self.assertNotEqual(fingerprint(Tagged(1)), fingerprint(Tagged(2)))
+
+    def test_store(self):
+        store = ResultStore(self.tmp.name)
+        store.put("ab01", {"y": np.ones(3)})
+        self.assertTrue(np.all(store.get("ab01")["y"] == 1))
+        # 另一个 store (如另一个进程) 从磁盘读取
+        other = ResultStore(self.tmp.name, max_memory=0)
+        self.assertTrue(np.all(other.get("ab01")["y"] == 1))
+        self.assertIs(other.get("cd02", None), None)
+        self.assertFalse(store.put("cd02", lambda x: x))
+
+    def test_unwritable(self):
+        # 磁盘缓存不可用时退回内存缓存
+        blocker = f"{self.tmp.name}/file"
+        open(blocker, "w").close()
+        store = ResultStore(f"{blocker}/cache")
+        self.assertTrue(store.put("ab01", {"y": 1.0}))
+        self.assertEqual(store.get("ab01"), {"y": 1.0})
+
+    def test_eviction(self):
+        data = np.zeros(1000)
+        store = ResultStore(self.tmp.name, max_memory=20000, max_disk=30000)
+        for i in range(5):
+            store.put(f"{i:02d}", data)
+        self.assertLessEqual(sum(len(v) for v in store._memory.values()), 20000)
+        self.assertEqual(sorted(p.stem for p in store.cache_dir.glob("??/*.pkl")), ["02", "03", "04"])
+        self.assertTrue(np.all(store.get("04") == 0))
+        self.assertIs(ResultStore(self.tmp.name).get("00", None), None)
+
+    def test_process(self):
+        store = ResultStore(self.tmp.name)
+        Square.memoize = store
+        try:
+            Square.calls = 0
+            self.assertEqual(Square().refresh(x=3).y, 9)
+            self.assertEqual(Square().refresh(x=3).y, 9)
+            self.assertEqual(Square().refresh(x=4).y, 16)
+            self.assertEqual(Square.calls, 2)
+
+            Square.memoize = ResultStore(self.tmp.name)  # 新进程, 仅磁盘
+            self.assertEqual(Square().refresh(x=4).y, 16)
+            self.assertEqual(Square.calls, 2)
+
+            Square.cache_version = 1
+            self.assertEqual(Square().refresh(x=4).y, 16)
+            self.assertEqual(Square.calls, 3)
+        finally:
+            Square.memoize = False
+            Square.cache_version = 0
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,148 @@
+import threading
+import time
+import unittest
+
+from spdm.core.sp_tree import SpTree, annotation, sp_property
+from spdm.model.context import Context
+from spdm.model.process import Process
+from spdm.model.scheduler import Scheduler, port_graph
+
+# execute 的起止时间 (线程执行器)
+spans = {}
+
+
+class Double(Process, SpTree):
+    class InPorts(Process.InPorts):
+        x: float
+
+    class OutPorts(Process.OutPorts):
+        y: float
+
+    def execute(self, x=None, **kwargs):
+        start = time.perf_counter()
+        time.sleep(0.1)
+        spans["double"] = (start, time.perf_counter())
+        return {"y": 2 * x}
+
+
+class Shift(Process, SpTree):
+    class InPorts(Process.InPorts):
+        x: float
+
+    class OutPorts(Process.OutPorts):
+        w: float
+
+    def execute(self, x=None, **kwargs):
+        start = time.perf_counter()
+        time.sleep(0.1)
+        spans["shift"] = (start, time.perf_counter())
+        return {"w": x + 1}
+
+
+class Product(Process, SpTree):
+    class InPorts(Process.InPorts):
+        y: float
+        w: float
+
+    class OutPorts(Process.OutPorts):
+        z: float
+
+    def execute(self, y=None, w=None, **kwargs):
+        return {"z": y * w}
+
+
+class Chain(Context, SpTree):
+    product: Product
+    double: Double
+    shift: Shift
+    x: float = annotation(input=True)
+    z: float = annotation(output=True)
+
+
+def square(x):
+    return x * x
+
+
+class TestScheduler(unittest.TestCase):
+    def test_port_graph(self):
+        ctx = Chain({"product": {}, "double": {}, "shift": {}})
+        self.assertEqual(port_graph(dict(ctx.processes())), {"product": ("double", "shift"), "double": (), "shift": ()})
+
+    def test_sp_property_process(self):
+        # 无类型注解的 sp_property 也是 Context 中的 Process
+        class Tail(Context, SpTree):
+            double: Double
+            x: float = annotation(input=True)
+
+            @sp_property
+            def shift(self) -> Shift:
+                return {}
+
+        ctx = Tail({"double": {}})
+        self.assertEqual(sorted(k for k, _ in ctx.processes()), ["double", "shift"])
+        ctx.x = 3
+        ctx.refresh()
+        self.assertEqual(ctx.shift.out_ports.w, 4)
+
+    def test_priority(self):
+        graph = {"a": (), "b": (), "c": ("b",), "d": ("a", "c")}
+        scheduler = Scheduler(graph, cost={"a": 1, "b": 2, "c": 5, "d": 1})
+        self.assertEqual(scheduler.priority, {"a": 2, "b": 8, "c": 6, "d": 1})
+        self.assertEqual(scheduler.critical_path(), ["b", "c", "d"])
+        self.assertEqual(scheduler.order(), ["a", "b", "c", "d"])
+        with self.assertRaises(RuntimeError):
+            Scheduler({"a": ("b",), "b": ("a",)})
+
+    def test_run(self):
+        graph = {i: (() if i < 4 else (i - 4,)) for i in range(8)}
+        started = []
+        lock = threading.Lock()
+
+        def work(i):
+            with lock:
+                started.append(i)
+            time.sleep(0.05)
+            return i * i
+
+        for max_workers in [1, 4]:
+            started.clear()
+            res = Scheduler(graph, max_workers=max_workers).run(lambda i: (work, (i,)))
+            self.assertEqual(list(res.items()), [(i, i * i) for i in range(8)])
+            for i in range(4, 8):
+                self.assertLess(started.index(i - 4), started.index(i))
+
+        res = Scheduler({i: () for i in range(3)}, max_workers=2, executor="process").run(lambda i: (square, (i,)))
+        self.assertEqual(res, {0: 0, 1: 1, 2: 4})
+
+        with self.assertRaises(RuntimeError):
+            Scheduler({"a": ()}, max_workers=2).run(lambda k: (square, (None,)))
+
+    def test_context(self):
+        # 缺省顺序执行
+        spans.clear()
+        ctx = Chain({"product": {}, "double": {}, "shift": {}})
+        ctx.x = 3
+        self.assertEqual(ctx.refresh().z, 24)
+        self.assertLessEqual(spans["double"][1], spans["shift"][0])
+
+        # double, shift 并行
+        spans.clear()
+        ctx = Chain({"product": {}, "double": {}, "shift": {}})
+        ctx.max_workers = 2
+        ctx.x = 3
+        self.assertEqual(ctx.refresh().z, 24)
+        self.assertLess(max(s[0] for s in spans.values()), min(s[1] for s in spans.values()))
+
+    def test_context_process(self):
+        ctx = Chain({"product": {}, "double": {}, "shift": {}})
+        ctx.max_workers = 2
+        ctx.executor = "process"
+        ctx.x = 3
+        self.assertEqual(ctx.refresh().z, 24)
+        # 工作进程中的结果同步到 out ports
+        self.assertEqual(ctx.double.out_ports.y, 6)
+        self.assertEqual(ctx.shift.out_ports.w, 4)
+
+
+if __name__ == "__main__":
+    unittest.main()
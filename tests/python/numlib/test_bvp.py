@@ -0,0 +1,220 @@
+import unittest
+
+import numpy as np
+from scipy.integrate import solve_bvp as scipy_solve_bvp
+from scipy.sparse import coo_matrix
+
+from spdm.numlib.abd import ABDFactor
+from spdm.numlib.bvp import (
+    color_columns,
+    complex_step_bc_jac,
+    complex_step_fun_jac,
+    compute_jac_indices,
+    estimate_fun_jac,
+    interleave,
+    prepare_sys,
+    solve_bvp,
+    stacked_matmul,
+)
+from spdm.numlib.bvp_batch import solve_bvp_many
+
+
+def bratu(x, y):
+    return np.vstack((y[1], -np.exp(y[0])))
+
+
+def bratu_bc(ya, yb):
+    return np.array([ya[0], yb[0]])
+
+
+def mathieu(x, y, p):
+    return np.vstack((y[1], -(p[0] - 10 * np.cos(2 * x)) * y[0]))
+
+
+def mathieu_bc(ya, yb, p):
+    return np.array([ya[1], yb[1], ya[0] - 1])
+
+
+def chain(x, y, p):
+    f = np.empty(y.shape, dtype=np.result_type(y, p))
+    f[0] = y[1] * np.sin(x)
+    f[1:-1] = y[:-2] * y[2:] + p[0] * y[1:-1] ** 2
+    f[-1] = np.exp(y[-2])
+    return f
+
+
+def chain_jac(x, y, p):
+    n, m = y.shape
+    df_dy = np.zeros((n, n, m))
+    df_dp = np.zeros((n, 1, m))
+    df_dy[0, 1] = np.sin(x)
+    for i in range(1, n - 1):
+        df_dy[i, i - 1], df_dy[i, i], df_dy[i, i + 1] = y[i + 1], 2 * p[0] * y[i], y[i - 1]
+        df_dp[i, 0] = y[i] ** 2
+    df_dy[-1, -2] = np.exp(y[-2])
+    return df_dy, df_dp
+
+
+class TestJacobian(unittest.TestCase):
+    def setUp(self) -> None:
+        self.x = np.linspace(0, 1, 7)
+        self.y = np.random.default_rng(3).random((5, 7))
+        self.p = np.array([0.3])
+        self.sparsity = np.abs(chain_jac(self.x, self.y + 1, self.p)[0][..., -1]) > 0
+
+    def test_coloring(self):
+        groups = color_columns(self.sparsity)
+        self.assertEqual(len(groups), 3)
+        for g in groups:
+            self.assertTrue(np.all(self.sparsity[:, g].sum(axis=1) <= 1))
+
+    def test_complex_step(self):
+        df_dy, df_dp = chain_jac(self.x, self.y, self.p)
+        for sparsity in [None, self.sparsity]:
+            res_dy, res_dp = complex_step_fun_jac(chain, self.x, self.y, self.p, sparsity)
+            self.assertTrue(np.allclose(res_dy, df_dy, rtol=1.0e-14, atol=1.0e-14))
+            self.assertTrue(np.allclose(res_dp, df_dp, rtol=1.0e-14, atol=1.0e-14))
+        res_dy, _ = estimate_fun_jac(chain, self.x, self.y, self.p, sparsity=self.sparsity)
+        self.assertTrue(np.allclose(res_dy, df_dy, atol=1.0e-6))
+
+    def test_bc(self):
+        dya, dyb, dp = complex_step_bc_jac(mathieu_bc, np.array([1.0, 2.0]), np.array([3.0, 4.0]), np.array([5.0]))
+        self.assertTrue(np.allclose(dya, [[0, 1], [0, 0], [1, 0]]))
+        self.assertTrue(np.allclose(dyb, [[0, 0], [0, 1], [0, 0]]))
+        self.assertTrue(np.allclose(dp, 0))
+
+    def test_stacked_matmul(self):
+        rng = np.random.default_rng(4)
+        for n, k in [(2, 2), (3, 1), (6, 6)]:
+            a, b = rng.random((n, n, 11)), rng.random((n, k, 11))
+            expect = np.einsum("ijm,jkm->mik", a, b)
+            self.assertTrue(np.allclose(stacked_matmul(a.transpose(2, 0, 1), b.transpose(2, 0, 1)), expect))
+            self.assertTrue(np.allclose(stacked_matmul(np.moveaxis(a, -1, 0).copy(), np.moveaxis(b, -1, 0)), expect))
+
+    def test_sys_jac(self):
+        # 节点与中点交错, df/dy 一次遍历求得: 每列 (及参数) 一次 rhs 调用
+        calls = []
+
+        def fun(x, y, p):
+            calls.append(x)
+            return chain(x, y, p)
+
+        def bc_jac(ya, yb, p):
+            return np.zeros((6, 5)), np.zeros((6, 5)), np.zeros((6, 1))
+
+        h = np.diff(self.x)
+        col_fun, sys_jac = prepare_sys(5, 7, 1, fun, None, None, bc_jac, self.x, h)
+        _, sys_jac_exact = prepare_sys(5, 7, 1, fun, None, chain_jac, bc_jac, self.x, h)
+        col_res, y_middle, f, f_middle = col_fun(self.y, self.p)
+        calls.clear()
+        blocks = sys_jac(self.y, self.p, y_middle, f, f_middle, None)
+        self.assertEqual(len(calls), 5 + 1)
+        self.assertTrue(np.array_equal(calls[0], interleave(self.x, self.x[:-1] + 0.5 * h)))
+        expect = sys_jac_exact(self.y, self.p, y_middle, f, f_middle, None)
+        for res, exp in zip(blocks[:3], expect[:3]):
+            self.assertTrue(np.allclose(res, exp, atol=1.0e-6))
+
+
+class TestABD(unittest.TestCase):
+    def test_solve(self):
+        rng = np.random.default_rng(0)
+        for n, m, k in [(2, 2, 0), (2, 3, 1), (3, 10, 0), (4, 17, 2), (1, 64, 1)]:
+            a = rng.normal(size=(m - 1, n, n)) - 3 * np.eye(n)
+            c = rng.normal(size=(m - 1, n, n)) + 3 * np.eye(n)
+            p = rng.normal(size=(m - 1, n, k))
+            ba, bb, bp = rng.normal(size=(n + k, n)), rng.normal(size=(n + k, n)), rng.normal(size=(n + k, k))
+            i, j = compute_jac_indices(n, m, k)
+            values = np.hstack([a.ravel(), c.ravel(), ba.ravel(), bb.ravel(), p.ravel(), bp.ravel()])
+            jac = coo_matrix((values, (i, j)), shape=(n * m + k, n * m + k)).toarray()
+            rhs = rng.normal(size=n * m + k)
+            x = ABDFactor(a, c, p if k else None, ba, bb, bp if k else None).solve(rhs)
+            self.assertTrue(np.allclose(jac @ x, rhs), (n, m, k))
+
+    def test_singular(self):
+        a = np.zeros((3, 2, 2))
+        with self.assertRaises(RuntimeError):
+            ABDFactor(a, a, None, np.zeros((2, 2)), np.zeros((2, 2)), None)
+
+    def test_batch(self):
+        rng = np.random.default_rng(1)
+        n, m, k, nb = 2, 9, 1, 4
+        a = rng.normal(size=(nb, m - 1, n, n)) - 3 * np.eye(n)
+        c = rng.normal(size=(nb, m - 1, n, n)) + 3 * np.eye(n)
+        p = rng.normal(size=(nb, m - 1, n, k))
+        ba, bb, bp = rng.normal(size=(nb, n + k, n)), rng.normal(size=(nb, n + k, n)), rng.normal(size=(nb, n + k, k))
+        a[-1] = c[-1] = 0
+        rhs = rng.normal(size=(nb, n * m + k))
+        lu = ABDFactor(a, c, p, ba, bb, bp)
+        self.assertEqual(lu.singular.tolist(), [False] * (nb - 1) + [True])
+        x = lu.solve(rhs)
+        for i in range(nb - 1):
+            expect = ABDFactor(a[i], c[i], p[i], ba[i], bb[i], bp[i]).solve(rhs[i])
+            self.assertTrue(np.allclose(x[i], expect))
+
+
+class TestBVP(unittest.TestCase):
+    def test_bratu(self):
+        x = np.linspace(0, 1, 5)
+        y = np.zeros((2, 5))
+        expect = scipy_solve_bvp(bratu, bratu_bc, x, y)
+        for linear_solver in ["abd", "splu"]:
+            res = solve_bvp(bratu, bratu_bc, x, y, linear_solver=linear_solver)
+            self.assertEqual(res.status, 0)
+            self.assertTrue(np.allclose(res.sol(0.5), expect.sol(0.5), atol=1.0e-8))
+
+    def test_complex_step(self):
+        x = np.linspace(0, 1, 5)
+        y = np.zeros((2, 5))
+        expect = solve_bvp(bratu, bratu_bc, x, y)
+        for kwargs in [{"fun_jac": "complex_step", "bc_jac": "complex_step"}, {"jac_sparsity": [[0, 1], [1, 0]]}]:
+            res = solve_bvp(bratu, bratu_bc, x, y, **kwargs)
+            self.assertEqual(res.status, 0)
+            self.assertTrue(np.allclose(res.sol(0.5), expect.sol(0.5), atol=1.0e-8))
+        with self.assertRaises(ValueError):
+            solve_bvp(bratu, bratu_bc, x, y, fun_jac="autograd")
+
+    def test_parameter(self):
+        x = np.linspace(0, np.pi, 5)
+        y = np.zeros((2, 5))
+        y[0, 1], y[0, 3] = 1, -1
+        res = solve_bvp(mathieu, mathieu_bc, x, y, p=[6])
+        expect = solve_bvp(mathieu, mathieu_bc, x, y, p=[6], linear_solver="splu")
+        self.assertEqual(res.status, 0)
+        self.assertAlmostEqual(res.p[0], expect.p[0], places=8)
+        self.assertTrue(np.allclose(res.sol(res.x), expect.sol(res.x)))
+
+
+class TestBVPMany(unittest.TestCase):
+    def test_bratu(self):
+        lams = np.linspace(0.5, 3.0, 6)
+        x = np.linspace(0, 1, 5)
+        res = solve_bvp_many(
+            lambda x, y, a: np.vstack((y[1], -a[0] * np.exp(y[0]))),
+            lambda ya, yb, a: np.vstack((ya[0], yb[0])),
+            x,
+            np.zeros((lams.size, 2, x.size)),
+            args=lams[:, None],
+            tol=1.0e-5,
+        )
+        for lam, r in zip(lams, res):
+            expect = scipy_solve_bvp(
+                lambda x, y: np.vstack((y[1], -lam * np.exp(y[0]))), bratu_bc, x, np.zeros((2, 5)), tol=1.0e-5
+            )
+            self.assertEqual(r.status, 0)
+            self.assertTrue(np.allclose(r.x, expect.x))
+            self.assertTrue(np.allclose(r.sol(r.x), expect.sol(r.x), atol=1.0e-8))
+
+    def test_singular(self):
+        # 第二个问题的边界条件与 y 无关
+        res = solve_bvp_many(
+            lambda x, y, a: bratu(x, y),
+            lambda ya, yb, a: np.vstack((ya[0], yb[0])) * a[0],
+            np.linspace(0, 1, 5),
+            np.zeros((2, 2, 5)),
+            args=[[1.0], [0.0]],
+        )
+        self.assertEqual([r.status for r in res], [0, 2])
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,67 @@
+import unittest
+
+import numpy as np
+from skimage import measure
+
+from spdm.core.field import Field
+from spdm.geometry.curve import Curve
+from spdm.mesh.mesh_rectilinear import RectilinearMesh
+from spdm.numlib.contours import critical_points, find_contours, find_critical_points, marching_squares
+
+
+class TestContours(unittest.TestCase):
+    def setUp(self) -> None:
+        self.x = np.linspace(-2, 2, 129)
+        self.y = np.linspace(-2, 2, 129)
+        self.g_x, self.g_y = np.meshgrid(self.x, self.y, indexing="ij")
+
+    def test_levels(self):
+        z = self.g_x**2 + self.g_y**2 / 2.25
+        levels = np.linspace(0.01, 1.5, 50)
+
+        contours = marching_squares(z, levels, self.x, self.y)
+
+        self.assertTrue(all(len(c) == 1 for c in contours))
+        for level, (curve,) in zip(levels, contours):
+            self.assertTrue(np.allclose(curve[0], curve[-1]))  # closed
+            # crossings refined onto the bicubic interpolant (exact for a quadratic)
+            self.assertTrue(np.allclose(curve[:, 0] ** 2 + curve[:, 1] ** 2 / 2.25, level, atol=1.0e-12))
+
+    def test_topology(self):
+        z = np.sin(3 * self.g_x[::2, ::2]) * np.cos(3 * self.g_y[::2, ::2])
+        for level in [0.01, -0.02, 0.3]:
+            res = marching_squares(z, [level], refine=False)[0]
+            expected = measure.find_contours(z, level)
+            self.assertEqual(sorted(c.shape[0] for c in res), sorted(c.shape[0] for c in expected))
+
+    def test_open(self):
+        (curves,) = marching_squares(self.g_x, [0.5], self.x, self.y)
+        self.assertEqual(len(curves), 1)
+        self.assertTrue(np.allclose(curves[0][:, 0], 0.5))
+        self.assertTrue(np.allclose(sorted(curves[0][[0, -1], 1]), [-2, 2]))
+
+    def test_find_contours(self):
+        psi = Field(self.g_x**2 + self.g_y**2, mesh=RectilinearMesh(self.x, self.y))
+        res = list(find_contours(psi, [0.25, 1.0]))
+        self.assertEqual([v for v, _ in res], [0.25, 1.0])
+        self.assertTrue(all(isinstance(c, Curve) for _, c in res))
+
+    def test_critical_points(self):
+        r = np.linspace(1, 3, 65)
+        z = np.linspace(-1.5, 3, 97)
+        g_r, g_z = np.meshgrid(r, z, indexing="ij")
+        amplitude = np.linspace(0.25, 0.4, 8)
+
+        # O-point (2,0), X-point (2, 2/(3a))
+        psi = np.stack([(g_r - 2) ** 2 + g_z**2 - a * g_z**3 for a in amplitude])
+
+        for a, (opoints, xpoints) in zip(amplitude, critical_points(psi, r, z)):
+            self.assertTrue(np.allclose(opoints, [[2, 0, 0]], atol=1.0e-10))
+            self.assertTrue(np.allclose(xpoints[:, :2], [[2, 2 / (3 * a)]], atol=1.0e-8))
+
+        opoints, xpoints = find_critical_points(Field(psi[0], mesh=RectilinearMesh(r, z)))
+        self.assertAlmostEqual(xpoints[0].z, 2 / 0.75, places=8)
+
+
+if __name__ == "__main__":
+    unittest.main()
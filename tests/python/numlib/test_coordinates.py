@@ -0,0 +1,70 @@
+import unittest
+
+import numpy as np
+
+from spdm.numlib import coordinates
+from spdm.geometry.curve import Curve
+from spdm.geometry.line import Line
+from spdm.geometry.toroidal import ToroidalSurface
+from spdm.geometry.transform import Sweep
+from spdm.geometry.vector import Vector
+
+
+class TestCoordinates(unittest.TestCase):
+    def setUp(self) -> None:
+        rng = np.random.default_rng(1)
+        self.rpz = np.stack([1 + rng.random(50), rng.uniform(-np.pi, np.pi, 50), rng.normal(size=50)], axis=-1)
+
+    def test_points(self):
+        xyz = coordinates.cylindrical_to_cartesian(self.rpz)
+        self.assertTrue(np.allclose(xyz[:, 0], self.rpz[:, 0] * np.cos(self.rpz[:, 1])))
+        self.assertTrue(np.allclose(coordinates.cartesian_to_cylindrical(xyz), self.rpz))
+
+    def test_jacobian(self):
+        jac = coordinates.cylindrical_jacobian(self.rpz)
+        self.assertTrue(np.allclose(np.linalg.det(jac), self.rpz[:, 0]))
+        eps = 1.0e-6
+        for k in range(3):
+            d = np.zeros(3)
+            d[k] = eps
+            fd = (
+                coordinates.cylindrical_to_cartesian(self.rpz + d) - coordinates.cylindrical_to_cartesian(self.rpz - d)
+            ) / (2 * eps)
+            self.assertTrue(np.allclose(jac[..., k], fd, atol=1.0e-8))
+
+    def test_vector_tensor(self):
+        phi = self.rpz[:, 1]
+        v = np.random.default_rng(2).normal(size=(50, 3))
+        vc = coordinates.vector_to_cartesian(v, phi)
+        self.assertTrue(np.allclose(np.linalg.norm(vc, axis=-1), np.linalg.norm(v, axis=-1)))
+        self.assertTrue(np.allclose(coordinates.vector_to_cylindrical(vc, phi), v))
+        t = np.einsum("...i,...j->...ij", v, v)
+        self.assertTrue(np.allclose(coordinates.tensor_to_cartesian(t, phi), np.einsum("...i,...j->...ij", vc, vc)))
+        self.assertTrue(np.allclose(coordinates.tensor_to_cylindrical(coordinates.tensor_to_cartesian(t, phi), phi), t))
+        self.assertTrue(np.allclose(Vector(v).to_cartesian(phi), vc))
+        self.assertTrue(np.allclose(Vector(1.0, 0.0, 0.0).to_cartesian(np.pi / 2), [0, 1, 0]))
+
+    def test_sweep(self):
+        theta = np.linspace(0, 2 * np.pi, 33)
+        section = Curve(np.stack([2 + 0.5 * np.cos(theta), 0.5 * np.sin(theta)], axis=-1))
+        surface = ToroidalSurface(section, phi=16)
+        self.assertEqual(surface.points.shape, (33, 16, 3))
+        self.assertTrue(np.allclose(np.hypot(surface.points[..., 0], surface.points[..., 1]), section.points[:, :1]))
+        sweep = Sweep(section, Line([[0, 0, 0], [0, 0, 1]]), phi=16)
+        self.assertTrue(np.allclose(sweep.points, surface.points))
+        self.assertTrue(np.allclose(section.to_cartesian(surface.phi), surface.points))
+
+    def test_flux_jacobian(self):
+        rho = np.linspace(0.1, 0.5, 41)
+        theta = np.linspace(0, 2 * np.pi, 128, endpoint=False)
+        r = 2.0 + rho[:, None] * np.cos(theta)
+        z = rho[:, None] * np.sin(theta) + 0 * r
+        jac, sqrt_g, g = coordinates.flux_jacobian(r, z, rho, theta)
+        self.assertTrue(np.allclose(sqrt_g, -r * rho[:, None], rtol=1.0e-3))
+        self.assertTrue(np.allclose(g[..., 0, 0], 1.0, rtol=1.0e-3))
+        self.assertTrue(np.allclose(g[..., 1, 1], rho[:, None] ** 2, rtol=1.0e-3))
+        self.assertTrue(np.allclose(g[..., 2, 2], r**2))
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,64 @@
+import unittest
+
+import numpy as np
+
+from spdm.mesh.mesh_rectilinear import RectilinearMesh
+from spdm.numlib.elliptic import MU0, free_boundary_values, greens_function, solve_elliptic
+
+
+class TestElliptic(unittest.TestCase):
+    def test_grad_shafranov(self):
+        mesh = RectilinearMesh(np.linspace(1, 2, 65), np.linspace(-1, 1, 129))
+
+        def exact(r, z):
+            return r**4 / 8 + z**2  # Δ* = r^2 + 2
+
+        g_r, g_z = mesh.coordinates
+
+        for method in ["dst", "multigrid"]:
+            psi = solve_elliptic(mesh, lambda r, z: r**2 + 2, boundary=exact, operator="grad_shafranov", method=method)
+            self.assertLess(np.abs(psi.__array__() - exact(g_r, g_z)).max(), 1.0e-5)
+
+    def test_poisson(self):
+        x = np.linspace(0, 1, 65)
+        mesh = RectilinearMesh(x, x)
+
+        def exact(a, b):
+            return np.sin(np.pi * a) * np.sin(np.pi * b)
+
+        g_x, g_y = mesh.coordinates
+        f = -2 * np.pi**2 * exact(g_x, g_y)
+        u_dst = solve_elliptic(mesh, f, method="dst").__array__()
+        u_mg = solve_elliptic(mesh, f, method="multigrid").__array__()
+
+        self.assertLess(np.abs(u_dst - exact(g_x, g_y)).max(), 1.0e-3)
+        self.assertTrue(np.allclose(u_dst, u_mg, atol=1.0e-8))
+
+    def test_free_boundary(self):
+        r = np.linspace(1, 3, 65)
+        z = np.linspace(-1, 1, 65)
+        mesh = RectilinearMesh(r, z)
+        g_r, g_z = mesh.coordinates
+
+        j_phi = 1.0e6 * np.exp(-((g_r - 2) ** 2 + g_z**2) / 0.05)
+
+        psi = solve_elliptic(mesh, -MU0 * g_r * j_phi, boundary="free", operator="grad_shafranov")
+
+        area = np.outer(np.gradient(r), np.gradient(z))
+        expected = np.sum(greens_function(1.3, 0.5, g_r, g_z) * j_phi * area)
+        self.assertAlmostEqual(psi(1.3, 0.5) / expected, 1.0, places=3)
+
+    def test_free_boundary_edge_source(self):
+        # 源延伸到网格边界: 边界节点的源不计入, 边界值有限
+        x = np.linspace(0, 1, 9)
+        with np.errstate(all="raise"):
+            u = free_boundary_values(np.ones((9, 9)), x, x)
+        g_x, g_y = np.meshgrid(x[1:-1], x[1:-1], indexing="ij")
+        expected = np.sum(greens_function(0.0, 0.5, g_x, g_y, operator="poisson")) * (x[1] - x[0]) ** 2
+        self.assertAlmostEqual(u[0, 4], expected, places=12)
+        self.assertTrue(np.allclose(u[0, :], u[-1, ::-1]))
+        self.assertTrue(np.all(u[1:-1, 1:-1] == 0.0))
+
+
+if __name__ == "__main__":
+    unittest.main()
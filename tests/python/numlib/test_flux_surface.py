@@ -0,0 +1,73 @@
+import unittest
+
+import numpy as np
+
+from spdm.core.field import Field
+from spdm.mesh.mesh_rectilinear import RectilinearMesh
+from spdm.numlib.flux_surface import FluxSurfaceAverage, flux_surface_mesh
+
+KAPPA = 1.5
+
+
+class TestFluxSurface(unittest.TestCase):
+    def setUp(self) -> None:
+        self.R = np.linspace(1, 3, 129)
+        self.Z = np.linspace(-1.5, 1.5, 193)
+        g_r, g_z = np.meshgrid(self.R, self.Z, indexing="ij")
+        self.psi = (g_r - 2) ** 2 + (g_z / KAPPA) ** 2
+        self.psi_norm = np.linspace(0, 0.64, 17)
+
+    def _check_surfaces(self, mesh):
+        r, z = mesh.coordinates
+        self.assertEqual(tuple(mesh.shape), (17, 64))
+        self.assertTrue(np.allclose((r - 2) ** 2 + (z / KAPPA) ** 2, self.psi_norm[:, None], atol=1.0e-10))
+
+    def test_equal_arc(self):
+        mesh = flux_surface_mesh(
+            self.psi, self.R, self.Z, psi_norm=self.psi_norm, theta=64, o_point=(2.0, 0.0), psi_boundary=1.0
+        )
+        self._check_surfaces(mesh)
+
+        r, z = mesh.coordinates
+        dl = np.hypot(np.diff(r[-1], append=r[-1, 0]), np.diff(z[-1], append=z[-1, 0]))
+        self.assertLess(np.std(dl) / np.mean(dl), 1.0e-3)
+
+    def test_straight_field_line(self):
+        field = Field(self.psi, mesh=RectilinearMesh(self.R, self.Z))
+
+        mesh = flux_surface_mesh(
+            field,
+            psi_norm=self.psi_norm,
+            theta=64,
+            o_point=(2.0, 0.0),
+            psi_boundary=1.0,
+            parameterization="straight_field_line",
+            workers=2,
+        )
+        self._check_surfaces(mesh)
+
+        # d theta* ~ dl/(R|grad psi|) is the same for every cell
+        r, z = mesh.coordinates
+        r_c = np.append(r[-1], r[-1, 0])
+        z_c = np.append(z[-1], z[-1, 0])
+        r_m, z_m = 0.5 * (r_c[1:] + r_c[:-1]), 0.5 * (z_c[1:] + z_c[:-1])
+        grad = np.hypot(2 * (r_m - 2), 2 * z_m / KAPPA**2)
+        w = np.hypot(np.diff(r_c), np.diff(z_c)) / (r_m * grad)
+        self.assertLess(np.std(w) / np.mean(w), 1.0e-2)
+
+    def test_average(self):
+        fsa = FluxSurfaceAverage(self.psi, self.R, self.Z, psi_norm=self.psi_norm, o_point=(2.0, 0.0), psi_boundary=1.0)
+        a2 = self.psi_norm  # minor radius squared
+
+        self.assertTrue(np.allclose(fsa.area, np.pi * KAPPA * a2))
+        self.assertTrue(np.allclose(fsa.volume, 4 * np.pi**2 * KAPPA * a2))
+        self.assertTrue(np.allclose(fsa.dvolume_dpsi, 4 * np.pi**2 * KAPPA))
+
+        # dl/|grad psi| is uniform in the polar angle of an ellipse:  <R> = 2 + a^2/4
+        r_avg, one = fsa(lambda r, z: r, np.ones_like(fsa.grad_psi2))
+        self.assertTrue(np.allclose(r_avg, 2 + a2 / 4))
+        self.assertTrue(np.allclose(one, 1.0))
+
+
+if __name__ == "__main__":
+    unittest.main()
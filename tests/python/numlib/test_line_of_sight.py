@@ -0,0 +1,84 @@
+import unittest
+
+import numpy as np
+from numpy.testing import assert_allclose
+
+from spdm.core.field import Field
+from spdm.mesh.mesh_rectilinear import RectilinearMesh
+from spdm.mesh.mesh_curvilinear import CurvilinearMesh
+from spdm.numlib.line_of_sight import LineOfSight
+
+
+class TestLineOfSight(unittest.TestCase):
+    def setUp(self) -> None:
+        self.R = np.linspace(1.0, 3.0, 41)
+        self.Z = np.linspace(-1.5, 1.5, 61)
+        n = 50
+        self.zs = np.linspace(-1.2, 1.2, n)
+        # 斜弦
+        self.origin = np.stack([np.full(n, 0.5), self.zs - 0.3], axis=-1)
+        self.end = np.stack([np.full(n, 3.5), self.zs + 0.3], axis=-1)
+
+    def test_geometry_matrix(self):
+        # 双线性函数的积分是精确的
+        R, Z = np.meshgrid(self.R, self.Z, indexing="ij")
+        field = Field(2.0 * R + Z + R * Z, mesh=RectilinearMesh(self.R, self.Z))
+
+        los = LineOfSight(self.origin, self.end)
+        signal = los(field)
+
+        a, b = los.endpoints(lo=[1.0, -1.5], hi=[3.0, 1.5])
+        assert_allclose(a[:, 0], 1.0)
+        assert_allclose(b[:, 0], 3.0)
+
+        # 解析积分: 直线上 f 是 t 的二次函数, 用 Simpson 精确积分
+        t = np.linspace(0, 1, 3)
+        p = a[:, None, :] + t[None, :, None] * (b - a)[:, None, :]
+        f = 2.0 * p[..., 0] + p[..., 1] + p[..., 0] * p[..., 1]
+        expected = (f[:, 0] + 4 * f[:, 1] + f[:, 2]) / 6 * np.linalg.norm(b - a, axis=-1)
+        assert_allclose(signal, expected, rtol=1.0e-12)
+
+        self.assertIs(los.geometry_matrix(self.R, self.Z), los.geometry_matrix(self.R, self.Z))
+        self.assertEqual(los.geometry_matrix(self.R, self.Z).shape, (50, 41 * 61))
+
+    def test_curvilinear(self):
+        # 逻辑坐标 (网格序号) 与空间坐标不同, 不能用 dims 构造几何矩阵
+        R, Z = np.meshgrid(self.R, self.Z, indexing="ij")
+        points = np.stack([R + 0.1 * Z, Z], axis=-1)
+        mesh = CurvilinearMesh(np.arange(self.R.size, dtype=float), np.arange(self.Z.size, dtype=float), points=points)
+        field = Field(points[..., 0] + points[..., 1], mesh=mesh)
+
+        los = LineOfSight(self.origin, self.end, bbox=([1.0, -1.5], [3.0, 1.5]))
+        signal = los(field)
+        assert_allclose(signal, los(lambda x, y: field(x, y)), rtol=1.0e-12)
+        self.assertFalse(any(k[0] == "G" for k in los._cache))
+
+        # 不同的精度选项不取用缓存的采样点
+        coarse, _ = los.samples(field, key=mesh.fingerprint, rtol=1.0e-2)
+        fine, _ = los.samples(field, key=mesh.fingerprint, rtol=1.0e-8)
+        self.assertLess(coarse.shape[0], fine.shape[0])
+
+    def test_adaptive(self):
+        func = lambda x, y: np.exp(-((x - 2.0) ** 2 + y**2) / 0.05)
+        origin = np.stack([np.full(self.zs.size, 0.0), self.zs], axis=-1)
+        los = LineOfSight(origin, direction=[1.0, 0.0], bbox=([1.0, -1.5], [3.0, 1.5]))
+        signal = los(func, rtol=1.0e-8)
+        assert_allclose(signal, np.sqrt(np.pi * 0.05) * np.exp(-self.zs**2 / 0.05), rtol=1.0e-6, atol=1.0e-12)
+
+    def test_wall(self):
+        t = np.linspace(0, 2 * np.pi, 129)
+        wall = np.stack([2.0 + 0.8 * np.cos(t), 1.2 * np.sin(t)], axis=-1)
+        origin = np.stack([np.full(self.zs.size, 0.5), self.zs], axis=-1)
+        end = np.stack([np.full(self.zs.size, 3.5), self.zs], axis=-1)
+        los = LineOfSight(origin, end, wall=wall)
+
+        length = los.length(lo=[1.0, -1.5], hi=[3.0, 1.5])
+        assert_allclose(length, 1.6 * np.sqrt(1 - (self.zs / 1.2) ** 2), rtol=5.0e-3)
+
+        # 从壁内出发的射线止于壁
+        los = LineOfSight([[2.0, 0.0]], direction=[[1.0, 0.0]], wall=wall)
+        assert_allclose(los.length(), [0.8])
+
+
+if __name__ == "__main__":
+    unittest.main()
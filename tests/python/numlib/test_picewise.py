@@ -0,0 +1,81 @@
+import unittest
+
+import numpy as np
+from numpy.polynomial import Chebyshev, Laguerre, Legendre, Polynomial
+
+from spdm.numlib.picewise import Piecewise, PiecewiseIntervals, piecewise
+from spdm.numlib.polynomial import Polynomials
+
+
+class TestPiecewise(unittest.TestCase):
+    def setUp(self) -> None:
+        self.x = np.linspace(-1.0, 3.0, 101)
+
+    def expected(self, x):
+        return np.piecewise(
+            x,
+            [x < 0, (x >= 0) & (x < 1), (x >= 1) & (x < 2), (x >= 2) & (x < 2.5), x >= 2.5],
+            [0.5, lambda v: v + 2 * v**2, np.sin, lambda v: 1 + 2 * (v - 3), lambda v: 2 * v],
+        )
+
+    def test_breakpoints(self):
+        fun = Piecewise(
+            [
+                0.5,
+                Polynomial([0, 1, 2]),
+                np.sin,
+                Chebyshev([1, 2], domain=[2, 4]),
+                Polynomials([1, 1], kind="legendre", domain=[0, 1]),
+            ],
+            breakpoints=[0, 1, 2, 2.5],
+        )
+        self.assertTrue(np.allclose(fun(self.x), self.expected(self.x)))
+        self.assertAlmostEqual(fun(1.5), np.sin(1.5))
+        self.assertEqual(fun(self.x.reshape(-1, 1)).shape, (101, 1))
+
+    def test_away_from_origin(self):
+        # 各分支保留自己的 domain -> window 映射
+        rng = np.random.default_rng(0)
+        branches = [
+            Chebyshev(rng.standard_normal(12), domain=[100, 110]),
+            Legendre(rng.standard_normal(8), domain=[110, 120]),
+            Polynomials(rng.standard_normal(10), kind="chebyshev", domain=[120, 130]),
+            Laguerre(rng.standard_normal(5), domain=[130, 140]),
+        ]
+        x = np.linspace(100.0, 140.0, 401)[:-1]
+        fun = PiecewiseIntervals(branches, [100.0, 110.0, 120.0, 130.0, 140.0])
+        expected = np.piecewise(
+            x,
+            [x < 110, (x >= 110) & (x < 120), (x >= 120) & (x < 130), x >= 130],
+            [lambda v, f=f: f(v) for f in branches],
+        )
+        np.testing.assert_allclose(fun(x), expected, rtol=1.0e-12, atol=1.0e-12)
+
+    def test_branch_points_only(self):
+        called = []
+
+        def branch(v):
+            called.append(v.size)
+            return np.cos(v)
+
+        fun = PiecewiseIntervals([branch, np.exp, branch], [0.0, 1.0], right=True)
+        x = np.array([-1.0, 0.0, 0.5, 1.0, 2.0])
+        self.assertTrue(np.allclose(fun(x), [np.cos(-1), np.cos(0), np.exp(0.5), np.exp(1), np.cos(2)]))
+        self.assertEqual(sorted(called), [1, 2])
+
+    def test_bounded(self):
+        fun = PiecewiseIntervals([1.0, 2.0], [0.0, 1.0, 2.0])
+        res = fun(np.array([-1.0, 0.0, 1.5, 2.0]))
+        self.assertTrue(np.allclose(res[1:3], [1.0, 2.0]))
+        self.assertTrue(np.isnan(res[0]) and np.isnan(res[3]))
+        with self.assertRaises(ValueError):
+            PiecewiseIntervals([1.0, 2.0], [0.0, 1.0])
+
+    def test_conditions(self):
+        fun = piecewise([(np.sin, lambda v: v < 1), (np.cos, lambda v: v < 2), (0.0, lambda v: v >= 0)])
+        x = self.x
+        self.assertTrue(np.allclose(fun(x), np.where(x < 1, np.sin(x), np.where(x < 2, np.cos(x), 0.0))))
+
+
+if __name__ == "__main__":
+    unittest.main()
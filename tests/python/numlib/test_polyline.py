@@ -0,0 +1,60 @@
+import unittest
+
+import numpy as np
+from numpy.testing import assert_allclose
+from scipy.special import ellipe
+
+from spdm.numlib.polyline import Polylines, ragged
+from spdm.geometry.curve import Curve
+
+
+def ellipse(a, b, n, x0=0.0):
+    t = np.linspace(0, 2 * np.pi, n)
+    return np.stack([x0 + a * np.cos(t), b * np.sin(t)], axis=-1)
+
+
+class TestPolylines(unittest.TestCase):
+    def test_length(self):
+        curves = [ellipse(1.0, 1.0, 65), ellipse(1.0, 2.0, 129), np.stack([np.linspace(0, 1, 11)] * 2, axis=-1)]
+        lines = Polylines.from_list(curves)
+
+        assert_allclose(lines.closed, [True, True, False])
+        assert_allclose(lines.length, [2 * np.pi, 8 * ellipe(0.75), np.sqrt(2)], rtol=1.0e-5)
+        self.assertEqual(lines.cumulative_length.shape, (65 + 129 + 11,))
+        assert_allclose(lines.cumulative_length[lines.offsets[:-1]], 0.0)
+
+    def test_integral(self):
+        points, offsets = ragged([ellipse(1.0, 1.0, 65, x0=3.0), ellipse(0.5, 0.5, 33, x0=3.0)])
+        lines = Polylines(points, offsets)
+        # ∮ R dl = 2π r R0
+        assert_allclose(lines.integral(lambda x, y: x), [6 * np.pi, 3 * np.pi], rtol=1.0e-5)
+        assert_allclose(lines.integral(points[:, 0]), [6 * np.pi, 3 * np.pi], rtol=1.0e-5)
+
+    def test_resample(self):
+        # 非等距的圆, 等弧长重采样应回到等角度分布
+        t = np.linspace(0, 1, 129) ** 2 * 2 * np.pi
+        circle = np.stack([np.cos(t), np.sin(t)], axis=-1)
+        lines = Polylines.from_list([ellipse(1.0, 2.0, 129), circle])
+        res = lines.resample([64, 17])
+        self.assertEqual(res.offsets.tolist(), [0, 64, 81])
+        assert_allclose(res.points[0], res.points[63])
+        assert_allclose(res.points[64:], ellipse(1.0, 1.0, 17), atol=1.0e-6)
+
+
+class TestCurve(unittest.TestCase):
+    def test_measure(self):
+        c = Curve(ellipse(1.0, 2.0, 129, x0=3.0))
+        self.assertTrue(c.is_closed)
+        assert_allclose(c.measure, 8 * ellipe(0.75), rtol=1.0e-5)
+        assert_allclose(c.integral(lambda x, y: np.ones_like(x)), c.measure)
+
+    def test_remesh(self):
+        t = np.linspace(0, 1, 129) ** 2 * 2 * np.pi
+        c = Curve(np.stack([np.cos(t), np.sin(t)], axis=-1)).remesh(32)
+        self.assertEqual(c.points.shape, (32, 2))
+        assert_allclose(c.points, ellipse(1.0, 1.0, 32), atol=1.0e-6)
+        assert_allclose(c.dl, c.measure / 31, rtol=1.0e-4)
+
+
+if __name__ == "__main__":
+    unittest.main()
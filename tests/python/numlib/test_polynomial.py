@@ -0,0 +1,60 @@
+import unittest
+
+import numpy as np
+from numpy.polynomial import Chebyshev, Hermite, Laguerre, Legendre
+from numpy.testing import assert_allclose
+
+from spdm.numlib.polynomial import Polynomials, antiderivative, clenshaw, derivative, polyfit
+
+
+class TestPolynomial(unittest.TestCase):
+    def test_clenshaw(self):
+        rng = np.random.default_rng(0)
+        c = rng.normal(size=(8, 5))
+        x = np.linspace(1.0, 3.0, 11)
+        domain = (1.0, 3.0)
+        for kind, cls in (
+            ("chebyshev", Chebyshev),
+            ("legendre", Legendre),
+            ("laguerre", Laguerre),
+            ("hermite", Hermite),
+        ):
+            series = [cls(c[:, j], domain=domain) for j in range(5)]
+            assert_allclose(clenshaw(c, x, kind, domain), [s(x) for s in series], atol=1.0e-12, rtol=1.0e-12)
+            assert_allclose(
+                clenshaw(derivative(c, 2, kind, domain), x, kind, domain),
+                [s.deriv(2)(x) for s in series],
+                rtol=1.0e-10,
+                atol=1.0e-9,
+            )
+            assert_allclose(
+                clenshaw(antiderivative(c, 1, kind, domain), x, kind, domain),
+                [s.integ(lbnd=1.0)(x) for s in series],
+                rtol=1.0e-10,
+                atol=1.0e-10,
+            )
+
+    def test_fit(self):
+        x = np.linspace(0.0, 1.0, 51)
+        y = np.stack([np.exp(k * x) for k in range(1, 201)], axis=-1)
+        c = polyfit(x, y, 8, "chebyshev")
+        self.assertEqual(c.shape, (9, 200))
+        assert_allclose(c[:, 3], Chebyshev.fit(x, y[:, 3], 8).coef, rtol=1.0e-10, atol=1.0e-12)
+
+    def test_wrapper(self):
+        x = np.linspace(1.0, 3.0, 21)
+        y = np.stack([np.sin(k * x) for k in range(1, 4)], axis=-1)
+        p = Polynomials.fit(x, y, 12, kind="legendre")
+
+        self.assertEqual(p(np.array([1.5, 2.0])).shape, (3, 2))
+        assert_allclose(p(2.0), np.sin([2.0, 4.0, 6.0]), rtol=1.0e-6)
+        assert_allclose(p.d(2.0), [k * np.cos(2.0 * k) for k in range(1, 4)], rtol=1.0e-4)
+        assert_allclose(p.integral(), [(np.cos(k) - np.cos(3 * k)) / k for k in range(1, 4)], rtol=1.0e-6)
+
+        q = Polynomials([1.0, 2.0, 3.0])
+        self.assertEqual(q(0.5), 2.75)
+        self.assertEqual(q.integral(0.0, 1.0), 3.0)
+
+
+if __name__ == "__main__":
+    unittest.main()
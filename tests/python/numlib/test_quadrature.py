@@ -0,0 +1,70 @@
+import unittest
+
+import numpy as np
+from scipy import constants
+
+from spdm.core.expression import Expression
+from spdm.mesh.mesh_rectilinear import RectilinearMesh
+from spdm.mesh.mesh_ppoly import PPolyMesh
+from spdm.mesh.mesh_curvilinear import CurvilinearMesh
+from spdm.numlib.quadrature import integrate_gauss_kronrod, integrate_spline
+
+PI = constants.pi
+
+
+class TestQuadrature(unittest.TestCase):
+    def test_gauss_kronrod(self):
+        self.assertAlmostEqual(integrate_gauss_kronrod(np.exp, 0, 1), np.e - 1, places=12)
+        self.assertAlmostEqual(integrate_gauss_kronrod(np.exp, 1, 0), 1 - np.e, places=12)
+        self.assertAlmostEqual(Expression(np.cos).integral(0, PI / 2), 1.0, places=12)
+
+    def test_gauss_kronrod_limit(self):
+        # 不收敛的被积函数: 子区间总数不超过 limit
+        n_eval = []
+
+        def rough(x):
+            n_eval.append(x.size // 15)
+            return np.sin(1.0 / np.maximum(x, 1.0e-300)) * np.abs(x - 0.3) ** -0.4
+
+        value, error = integrate_gauss_kronrod(rough, 0, 1, limit=50, full_output=True)
+        self.assertLessEqual(sum(n_eval), 2 * 50)
+        self.assertAlmostEqual(value, 0.6499, delta=2 * error)
+
+    def test_spline(self):
+        x = np.linspace(0, 1, 11)
+        # cubic polynomial is reproduced exactly by the not-a-knot spline
+        self.assertAlmostEqual(integrate_spline(x**3, x), 0.25, places=12)
+
+    def test_rectilinear(self):
+        x = np.linspace(0, PI, 33)
+        y = np.linspace(0, 1, 17)
+
+        mesh = RectilinearMesh(x, y)
+
+        self.assertAlmostEqual(mesh.integrate(lambda a, b: np.sin(a) * b**2), 2 / 3, places=10)
+        self.assertAlmostEqual(mesh.antiderivative(lambda a, b: np.sin(a) * b**2)(PI, 1.0), 2.0, places=10)
+
+    def test_curvilinear(self):
+        # 逻辑坐标 (r, theta) 上的积分不是圆盘面积, 不能静默返回
+        r = np.linspace(0, 0.5, 9)
+        t = np.linspace(0, 2 * PI, 17)
+        g_r, g_t = np.meshgrid(r, t, indexing="ij")
+        mesh = CurvilinearMesh(r, t, points=np.stack([g_r * np.cos(g_t), g_r * np.sin(g_t)], axis=-1))
+
+        with self.assertRaises(NotImplementedError):
+            mesh.integrate(np.ones(mesh.shape))
+        with self.assertRaises(NotImplementedError):
+            mesh.antiderivative(lambda a, b: a)
+
+    def test_ppoly(self):
+        x = np.linspace(0, 1, 9)
+        y = np.linspace(0, 2, 5)
+        g_x, g_y = np.meshgrid(x, y, indexing="ij")
+
+        mesh = PPolyMesh(x, y)
+
+        self.assertAlmostEqual(mesh.integrate(g_x**2 * g_y), 2 / 3, places=12)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,83 @@
+import unittest
+
+import numpy as np
+
+from spdm.mesh.mesh_curvilinear import CurvilinearMesh
+from spdm.mesh.mesh_rectilinear import RectilinearMesh
+from spdm.numlib.regrid import regrid, regridder, _dual_cells
+
+
+def func(x, y):
+    return np.sin(3 * x) * np.cos(2 * y)
+
+
+class TestRegrid(unittest.TestCase):
+    def setUp(self) -> None:
+        self.source = RectilinearMesh(np.linspace(0, 1, 41), np.linspace(0, 2, 61))
+        self.target = RectilinearMesh(np.linspace(0, 1, 101), np.linspace(0, 2, 131))
+        self.value = func(*self.source.coordinates)
+        self.expect = func(*self.target.coordinates)
+
+    def test_interpolate(self):
+        linear = regrid(self.value, self.source, self.target, method="bilinear")
+        cubic = regrid(self.value, self.source, self.target, method="bicubic")
+        self.assertLess(np.abs(linear - self.expect).max(), 2.0e-3)
+        self.assertLess(np.abs(cubic - self.expect).max(), 1.0e-4)
+
+    def test_conservative(self):
+        res = regrid(self.value, self.source, self.target, method="conservative")
+
+        def volume(mesh):
+            return np.multiply.outer(*[np.diff(_dual_cells(d)) for d in mesh.dims])
+
+        self.assertAlmostEqual(np.sum(res * volume(self.target)), np.sum(self.value * volume(self.source)), places=12)
+
+    def test_conservative_partial(self):
+        # 部分超出源网格的目标单元取 fill_value, 而不是被缩小的值
+        target = RectilinearMesh(np.linspace(-0.5, 1.5, 21), np.linspace(0, 2, 11))
+        res = regrid(np.ones(self.source.shape), self.source, target, method="conservative")
+        x = target.dims[0]
+        inside = (x - 0.05 >= 0) & (x + 0.05 <= 1)
+        self.assertTrue(np.allclose(res[inside], 1.0, rtol=1.0e-14))
+        self.assertTrue(np.all(np.isnan(res[~inside])))
+
+    def test_cache_and_stack(self):
+        op = regridder(self.source, self.target)
+        self.assertIs(op, regridder(RectilinearMesh(*self.source.dims), self.target))
+
+        res = op(np.stack([self.value, 2 * self.value]))
+        self.assertEqual(res.shape, (2, *self.target.shape))
+        self.assertTrue(np.allclose(res[1], 2 * op(self.value)))
+
+    def test_tensor_grid(self):
+        # CurvilinearMesh 的子类同样按空间坐标 points 插值
+        class Sheared(CurvilinearMesh):
+            pass
+
+        u, v = np.linspace(0, 1, 21), np.linspace(0, 1, 11)
+        g_u, g_v = np.meshgrid(u, v, indexing="ij")
+        points = np.stack([g_u + 0.5 * g_v, g_v], axis=-1)
+        mesh = Sheared(u, v, points=points)
+        self.assertTrue(self.source.is_tensor_grid)
+        self.assertFalse(mesh.is_tensor_grid)
+
+        target = RectilinearMesh(np.linspace(0.6, 0.9, 4), np.linspace(0.2, 0.8, 4))
+        res = regrid(points[..., 0] + points[..., 1], mesh, target)
+        self.assertTrue(np.allclose(res, sum(target.coordinates)))
+
+    def test_fingerprint(self):
+        points = np.random.default_rng(0).random((4, 6, 2))
+        mesh = CurvilinearMesh(np.arange(4.0), np.arange(6.0), points=points)
+        same = CurvilinearMesh(np.arange(4.0), np.arange(6.0), points=points.copy())
+        # 展平后相同, 形状不同
+        other = CurvilinearMesh(np.arange(6.0), np.arange(4.0), points=points.reshape(6, 4, 2))
+        self.assertEqual(mesh.fingerprint, same.fingerprint)
+        self.assertNotEqual(mesh.fingerprint, other.fingerprint)
+        self.assertNotEqual(
+            RectilinearMesh(np.arange(3.0), np.arange(3.0, 5.0)).fingerprint,
+            RectilinearMesh(np.arange(2.0), np.arange(2.0, 5.0)).fingerprint,
+        )
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,31 @@
+import unittest
+
+import numpy as np
+from scipy.interpolate import PchipInterpolator
+
+from spdm.numlib.remap import ProfileRemap, remap_profiles
+
+
+class TestRemap(unittest.TestCase):
+    def setUp(self) -> None:
+        psi_norm = np.linspace(0, 1, 51)
+        self.rho = np.sqrt(psi_norm) * (1 + 0.1 * psi_norm)
+        self.x = np.linspace(0, self.rho[-1], 77)
+        self.y = np.cumsum(np.random.default_rng(0).random((100, 51)), axis=1)
+
+    def test_linear(self):
+        res = remap_profiles(self.y, self.rho, self.x, method="linear")
+        self.assertTrue(np.allclose(res, np.stack([np.interp(self.x, self.rho, v) for v in self.y])))
+
+    def test_pchip(self):
+        res = ProfileRemap(self.rho, self.x, method="pchip")(self.y)
+        self.assertTrue(np.allclose(res, PchipInterpolator(self.rho, self.y, axis=1)(self.x)))
+        self.assertTrue(np.all(np.diff(res, axis=1) >= 0))
+
+    def test_extrapolate(self):
+        res = ProfileRemap(self.rho, [-1.0, 0.5, 2.0])(self.y[0])
+        self.assertTrue(np.isnan(res[0]) and np.isnan(res[2]) and not np.isnan(res[1]))
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,43 @@
+import unittest
+
+import numpy as np
+from numpy.testing import assert_allclose
+from scipy.interpolate import CubicSpline, InterpolatedUnivariateSpline
+
+from spdm.core.expression import Expression
+from spdm.core.function import Function
+from spdm.numlib.roots import bracket_roots, find_roots, ppoly_roots, sample_roots
+
+
+class TestRoots(unittest.TestCase):
+    def test_ppoly_roots(self):
+        x = np.linspace(0, 10, 41)
+        spl = CubicSpline(x, (x - 2.0) * (x - 5.0) * (x - 7.5))
+        assert_allclose(ppoly_roots(spl.c, spl.x), [2.0, 5.0, 7.5], atol=1.0e-12)
+        assert_allclose(ppoly_roots(spl.c, spl.x, y=-10.0), spl.solve(-10.0, extrapolate=False), atol=1.0e-10)
+
+        # 二重根, 线性段, 恒为零的区间
+        assert_allclose(find_roots(CubicSpline(x, (x - 3.0) ** 2)), [3.0], atol=1.0e-6)
+        assert_allclose(find_roots(InterpolatedUnivariateSpline(x, x - 4.2, k=1)), [4.2])
+        self.assertEqual(find_roots(CubicSpline(x, np.zeros_like(x))).size, 0)
+
+    def test_bracket_roots(self):
+        k = np.arange(1, 200)
+        res = bracket_roots(lambda v: np.cos(v), (k - 0.9) * np.pi, (k - 0.1) * np.pi)
+        assert_allclose(res, (k - 0.5) * np.pi, rtol=1.0e-10)
+        assert_allclose(sample_roots(np.tanh, np.linspace(-1, 2, 4)), [0.0])
+
+    def test_function(self):
+        x = np.linspace(0, 10, 101)
+        q = Function(x, 1.0 + 0.05 * x**2)  # safety factor like profile
+        assert_allclose(list(q.find_roots(2.0)), [np.sqrt(20.0)], rtol=1.0e-8)
+        assert_allclose(list((q * q).find_roots(4.0)), [np.sqrt(20.0)], rtol=1.0e-8)
+
+    def test_expression(self):
+        # 非多项式表达式: 无 ppoly 时用采样 + 有界迭代
+        f = Expression(np.sin)
+        assert_allclose(find_roots(f, 0.5, x=np.linspace(0, 3, 7)), np.arcsin(0.5) + [0, 2 * np.pi / 3], rtol=1e-10)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,44 @@
+import unittest
+
+import numpy as np
+from scipy.signal import savgol_filter
+
+from spdm.numlib.smooth import moving_average, moving_median, penalized_spline, savgol, smooth
+
+
+class TestSmooth(unittest.TestCase):
+    def setUp(self) -> None:
+        rng = np.random.default_rng(0)
+        self.x = np.linspace(0, 2 * np.pi, 200)
+        self.y = np.sin(self.x)[None, :] + 0.05 * rng.standard_normal((8, 200))
+
+    def test_smooth_axis(self):
+        res = smooth(self.y, 11)
+        self.assertEqual(res.shape, self.y.shape)
+        self.assertTrue(np.allclose(res[3], smooth(self.y[3], 11)))
+        self.assertTrue(np.allclose(smooth(self.y.T, 11, axis=0), res.T))
+
+    def test_savgol(self):
+        for deriv in [0, 1, 2]:
+            res = savgol(self.y, 15, 3, deriv=deriv, delta=self.x[1])
+            expect = savgol_filter(self.y, 15, 3, deriv=deriv, delta=self.x[1])
+            self.assertTrue(np.allclose(res, expect))
+        self.assertTrue(np.allclose(savgol(self.y.T, 15, 3, axis=0), savgol_filter(self.y.T, 15, 3, axis=0)))
+
+    def test_moving(self):
+        avg = moving_average(self.y, 5)
+        med = moving_median(self.y, 5)
+        self.assertTrue(np.allclose(avg[:, 10], self.y[:, 8:13].mean(axis=1)))
+        self.assertTrue(np.allclose(med[:, 10], np.median(self.y[:, 8:13], axis=1)))
+
+    def test_penalized_spline(self):
+        res = penalized_spline(self.x, self.y, 1.0e-3)
+        self.assertEqual(res.shape, self.y.shape)
+        self.assertLess(np.abs(res - np.sin(self.x)).max(), 0.05)
+        line = 2 * self.x + 1
+        self.assertTrue(np.allclose(penalized_spline(self.x, line, 1.0e3), line))
+        self.assertTrue(np.allclose(penalized_spline(self.x, self.y.T, 1.0e-3, axis=0), res.T))
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,133 @@
+import unittest
+
+import numpy as np
+
+from spdm.core.domain import MultiDomains
+from spdm.mesh.mesh_curvilinear import CurvilinearMesh
+from spdm.mesh.mesh_rectilinear import RectilinearMesh
+from spdm.numlib.spatial import BBoxTree, PolygonIndex, SegmentIndex
+from spdm.geometry.curve import Curve
+from spdm.geometry.line import Segment
+from spdm.geometry.polyline import Polyline
+
+
+class TestSpatial(unittest.TestCase):
+    def test_bbox_tree(self):
+        rng = np.random.default_rng(0)
+        lo = rng.uniform(0, 10, size=(200, 2))
+        hi = lo + rng.uniform(0.1, 1.0, size=(200, 2))
+        points = rng.uniform(0, 11, size=(1000, 2))
+
+        tree = BBoxTree(lo, hi, fanout=4)
+
+        inside = np.all((points[:, None, :] >= lo) & (points[:, None, :] <= hi), axis=-1)
+        expected = np.where(inside.any(axis=1), np.argmax(inside, axis=1), -1)
+
+        self.assertTrue(np.all(tree.locate(points) == expected))
+
+        overlap = np.flatnonzero(np.all((lo <= [5, 5]) & (hi >= [4, 4]), axis=-1))
+        self.assertTrue(np.all(tree.intersect([4, 4], [5, 5]) == overlap))
+
+    def test_multi_domains(self):
+        m0 = RectilinearMesh(np.linspace(0, 1, 11), np.linspace(0, 1, 11))
+        m1 = RectilinearMesh(np.linspace(1, 2, 11), np.linspace(0, 1, 11))
+
+        domain = MultiDomains(sub_domains=[m0, m1])
+
+        x = np.array([0.5, 1.5, 2.5, 1.0])
+        y = np.array([0.5, 0.5, 0.5, 0.2])
+
+        self.assertTrue(np.all(domain.locate(x, y) == [0, 1, -1, 0]))
+
+        res = domain.eval(lambda a, b: a + 2 * b, x, y)
+        self.assertTrue(np.allclose(res[[0, 1, 3]], (x + 2 * y)[[0, 1, 3]]))
+        self.assertTrue(np.isnan(res[2]))
+
+    def test_multi_domains_curved(self):
+        # 两个相邻的环扇区, 包围盒重叠
+        r = np.linspace(1, 2, 6)
+        blocks = []
+        for t0, t1 in [(0, 2 * np.pi / 3), (2 * np.pi / 3, 4 * np.pi / 3)]:
+            t = np.linspace(t0, t1, 41)
+            g_r, g_t = np.meshgrid(r, t, indexing="ij")
+            points = np.stack([g_r * np.cos(g_t), g_r * np.sin(g_t)], axis=-1)
+            blocks.append(CurvilinearMesh(r, t, points=points))
+        domain = MultiDomains(sub_domains=blocks)
+
+        rho = np.array([1.5, 1.5, 1.5, 0.5, 1.5])
+        theta = np.array([2.0, 2.2, 0.3, 2.0, 4.5])
+        x, y = rho * np.cos(theta), rho * np.sin(theta)
+        self.assertTrue(np.all(domain.block_tree.locate(np.stack([x, y], axis=-1))[:2] == 0))
+        self.assertTrue(np.all(domain.locate(x, y) == [0, 1, 0, -1, -1]))
+
+    def test_polygon_index(self):
+        # 星形 (非凸) 外环 + 反向的方形孔
+        t = np.linspace(0, 2 * np.pi, 11)[:-1]
+        r = np.where(np.arange(10) % 2 == 0, 2.0, 0.8)
+        star = np.stack([r * np.cos(t), r * np.sin(t)], axis=-1)
+        hole = np.array([[-0.2, -0.2], [-0.2, 0.2], [0.2, 0.2], [0.2, -0.2]])
+        index = PolygonIndex(np.concatenate([star, hole]), [0, 10, 14], n_slab=7)
+
+        rng = np.random.default_rng(1)
+        x, y = rng.uniform(-2.5, 2.5, size=(2, 300, 200))
+
+        def _inside(poly, x, y):
+            res = np.zeros(x.shape, dtype=bool)
+            for (x0, y0), (x1, y1) in zip(poly, np.roll(poly, -1, axis=0)):
+                cross = ((y0 > y) != (y1 > y)) & (x < (x1 - x0) * (y - y0) / (y1 - y0 + 1.0e-300) + x0)
+                res ^= cross
+            return res
+
+        expected = _inside(star, x, y) & ~_inside(hole, x, y)
+        np.testing.assert_array_equal(index(x, y), expected)
+        np.testing.assert_array_equal(index(np.stack([x, y], axis=-1)), expected)
+        self.assertFalse(index(0.0, 0.0))
+        self.assertTrue(index(1.0, 0.1))
+
+    def test_mesh_mask(self):
+        t = np.linspace(0, 2 * np.pi, 65)
+        lcfs = Curve(np.stack([1.5 + 0.5 * np.cos(t), 0.8 * np.sin(t)], axis=-1))
+        mesh = RectilinearMesh(np.linspace(0.8, 2.2, 8), np.linspace(-1, 1, 9), boundary=lcfs)
+        R, Z = np.meshgrid(np.linspace(0.8, 2.2, 50), np.linspace(-1, 1, 60), indexing="ij")
+        mask = mesh.mask(R, Z)
+        self.assertEqual(mask.shape, R.shape)
+        np.testing.assert_array_equal(mask, lcfs.enclose(R, Z))
+        inner = ((R - 1.5) / 0.5) ** 2 + (Z / 0.8) ** 2
+        self.assertTrue(np.all(mask[inner < 0.95]))
+        self.assertFalse(np.any(mask[inner > 1.05]))
+
+    def test_segment_index(self):
+        rng = np.random.default_rng(2)
+        t = np.linspace(0, 2 * np.pi, 41)[:-1]
+        wall = np.stack([(1.0 + 0.3 * np.cos(3 * t)) * np.cos(t), (1.0 + 0.3 * np.cos(3 * t)) * np.sin(t)], axis=-1)
+        index = SegmentIndex(wall, closed=True, fanout=4)
+
+        origin = rng.uniform(-0.3, 0.3, size=(500, 2))
+        phi = rng.uniform(0, 2 * np.pi, size=500)
+        direction = np.stack([np.cos(phi), np.sin(phi)], axis=-1)
+
+        # brute force over all segments
+        a, b = wall, np.roll(wall, -1, axis=0)
+        e = b - a
+        w = a[None] - origin[:, None]
+        denom = direction[:, None, 0] * e[None, :, 1] - direction[:, None, 1] * e[None, :, 0]
+        tt = (w[..., 0] * e[None, :, 1] - w[..., 1] * e[None, :, 0]) / denom
+        uu = (w[..., 0] * direction[:, None, 1] - w[..., 1] * direction[:, None, 0]) / denom
+        tt = np.where((uu >= 0) & (uu <= 1) & (tt >= 0), tt, np.inf)
+
+        t_in, t_out, seg_in, seg_out = index.intersect(origin, direction)
+        np.testing.assert_allclose(t_in, tt.min(axis=1))
+        np.testing.assert_array_equal(seg_in, np.argmin(tt, axis=1))
+        self.assertTrue(np.all(t_out >= t_in))
+
+        # 从内部出发的射线穿过闭合壁的次数为奇数
+        ray, _, _ = index.hits(origin, direction)
+        self.assertTrue(np.all(np.bincount(ray, minlength=500) % 2 == 1))
+
+        # Segment 只取 t in [0,1]
+        t_in, t_out, seg_in, _ = Polyline(wall).intersect([Segment(np.array([[0.0, 0.0], [0.5, 0.0]]))])
+        self.assertTrue(np.isnan(t_in[0]) and seg_in[0] == -1)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,56 @@
+import unittest
+
+import numpy as np
+from scipy import constants
+
+from spdm.numlib.stencil import partial_derivative, stencil
+from spdm.mesh.mesh_rectilinear import RectilinearMesh
+
+TWOPI = constants.pi * 2.0
+
+
+class TestStencil(unittest.TestCase):
+    def setUp(self) -> None:
+        self.x = np.linspace(0, TWOPI, 129)
+        self.y = np.linspace(0, 1, 65) ** 1.5  # non-uniform
+        self.g_x, self.g_y = np.meshgrid(self.x, self.y, indexing="ij")
+        self.z = np.sin(self.g_x) * self.g_y**3
+
+    def test_order(self):
+        err = [
+            np.abs(
+                partial_derivative(self.z, self.x, self.y, order=(1, 0), accuracy=acc) - np.cos(self.g_x) * self.g_y**3
+            ).max()
+            for acc in (2, 4, 6)
+        ]
+        self.assertTrue(err[0] > err[1] > err[2])
+        self.assertLess(err[2], 1.0e-7)
+
+    def test_mixed(self):
+        dz = partial_derivative(self.z, self.x, self.y, order=(1, 1), accuracy=4)
+        self.assertTrue(np.allclose(dz, np.cos(self.g_x) * 3 * self.g_y**2, atol=1.0e-4))
+
+    def test_periodic(self):
+        dz = partial_derivative(self.z, self.x, self.y, order=(2, 0), accuracy=4, periods=[TWOPI, None])
+        self.assertTrue(np.allclose(dz, -self.z, atol=1.0e-6))
+
+    def test_periodic_apply(self):
+        # 回绕切片与 np.roll 的参考结果一致
+        x = np.linspace(0, TWOPI, 16, endpoint=False)
+        op = stencil(x, 1, 6, TWOPI)
+        y = np.random.default_rng(1).random((3, 16))
+        half = op.width // 2
+        expect = sum(op.weights[0, k] * np.roll(y, half - k, axis=-1) for k in range(op.width))
+        self.assertTrue(np.allclose(op.apply(y, axis=-1), expect))
+        out = np.empty((16, 3))
+        self.assertIs(op.apply(y.T, axis=0, out=out), out)
+        self.assertTrue(np.allclose(out, expect.T))
+
+    def test_mesh(self):
+        mesh = RectilinearMesh(self.x, self.y)
+        dz = mesh.partial_derivative((0, 1), self.z, accuracy=4)
+        self.assertTrue(np.allclose(dz(self.g_x, self.g_y), np.sin(self.g_x) * 3 * self.g_y**2, atol=1.0e-6))
+
+
+if __name__ == "__main__":
+    unittest.main()